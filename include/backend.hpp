@@ -25,4 +25,11 @@ namespace Window {
 	bool IsNewFrameAvailable();
 	void Render(const ImVec4& clear_color);
 	void Shutdown();
+
+	// RGBA textures for ImGui::Image, used from the UI thread only
+	ImTextureID CreateTexture(int width, int height);
+	void UpdateTexture(
+		ImTextureID texture, int x, int y, int width, int height,
+		const void* rgba);
+	void DestroyTexture(ImTextureID texture);
 };	// namespace Window
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg/batch.hpp"
+
+struct Profile;
+
+// Applies a saved graph to many files in the background
+class BatchWindow {
+	const Profile* profile;
+
+	std::string graph;
+	std::string inputs;
+	std::string output = "{dir}/rendered/{stem}.mkv";
+	int workers = 0;
+
+	std::thread worker;
+	std::atomic_bool running = false;
+	std::atomic_bool cancel = false;
+	std::mutex mutex;
+	std::vector<BatchResult> results;
+	size_t total = 0;
+
+	void start();
+	void drawResults();
+
+   public:
+	bool isOpen = false;
+
+	explicit BatchWindow(const Profile& p) : profile(&p) {}
+	BatchWindow(const BatchWindow&) = delete;
+	BatchWindow& operator=(const BatchWindow&) = delete;
+	~BatchWindow();
+
+	// Graph used when none is picked yet
+	void suggestGraph(const std::filesystem::path& path);
+	void draw();
+};
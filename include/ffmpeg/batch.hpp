@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ffmpeg/filter_graph.hpp"
+
+struct Profile;
+class Runner;
+
+struct BatchJob {
+	std::filesystem::path input;
+	std::filesystem::path output;
+	double duration = 0;  // probed when 0, longest jobs run first
+};
+
+struct BatchResult {
+	BatchJob job;
+	FilterGraphError error;
+	double seconds = 0;
+};
+
+struct BatchOptions {
+	std::filesystem::path graph;
+	std::optional<int> node;  // saved id of the node to render, else the
+							  // only end of the graph
+	unsigned workers = 0;	  // 0 sizes the pool to the machine
+};
+
+using BatchCallback = std::function<void(const BatchResult&)>;
+
+// Files matching pattern. A directory gives every file in it, otherwise the
+// last part of the path may use * and ?
+std::vector<std::filesystem::path> expandInputs(
+	const std::filesystem::path& pattern);
+
+// Output path for input from a template using {dir}, {stem}, {name}, {ext}
+// and {index}, eg "{dir}/out/{stem}.mkv". Empty for a bad template.
+std::filesystem::path batchOutput(
+	const std::string& pattern, const std::filesystem::path& input,
+	size_t index);
+
+// Jobs for the files ffprobe finds streams in, with outputs from the
+// template and durations filled in. Stray files like notes next to the
+// clips are left out and the index counts only the rest. Probes every file,
+// so keep it off the UI thread. Nothing for a bad template.
+std::optional<std::vector<BatchJob>> batchJobs(
+	const Runner& runner, const std::vector<std::filesystem::path>& files,
+	const std::string& pattern);
+
+// Renders the graph once per job, with the file of every input node
+// replaced by the input of the job. Jobs run on a pool of worker threads,
+// longest first, so a long file doesn't start last and hold up the end.
+// onDone is called as each job finishes, one call at a time. Setting
+// cancel stops the running jobs and skips the rest.
+std::vector<BatchResult> runBatch(
+	const Profile& profile, const BatchOptions& opts,
+	std::vector<BatchJob> jobs, const BatchCallback& onDone = nullptr,
+	const std::atomic_bool* cancel = nullptr);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ffmpeg/runner.hpp"
+
+// Measurements of one run, as reported by ffmpeg -benchmark
+struct BenchmarkRun {
+	double wall = 0;   // seconds
+	double utime = 0;  // seconds
+	double stime = 0;  // seconds
+	double maxRss = 0;	// KiB
+	double fps = 0;	 // last fps of the progress stream
+};
+
+struct BenchmarkStats {
+	double mean = 0;
+	double median = 0;
+	double p95 = 0;
+	double stddev = 0;
+};
+
+struct BenchmarkResult {
+	std::string date;	 // UTC, ISO 8601
+	std::string ffmpeg;	 // first line of ffmpeg -version
+	std::vector<BenchmarkRun> runs;
+	BenchmarkStats wall, utime, stime, maxRss, fps;
+};
+
+// Repetitions of the editor's "Benchmark this node"
+constexpr unsigned BENCHMARK_REPETITIONS = 5;
+
+[[nodiscard]] BenchmarkStats summarize(std::vector<double> values);
+
+// Reads the bench: lines and progress stream out of the log of one run
+[[nodiscard]] BenchmarkRun parseBenchmark(std::string_view log);
+
+// Runs cmd into a null sink once to warm up and then repetitions times.
+// duration > 0 limits each run to that many seconds of output.
+[[nodiscard]] std::pair<int, std::string> runBenchmark(
+	const Runner& runner, Command cmd, unsigned repetitions,
+	BenchmarkResult& result, double duration = 0,
+	const std::atomic_bool* cancel = nullptr);
+
+// Appends result to the history of the graph in dir/<fingerprint>.json
+bool saveBenchmark(
+	const std::filesystem::path& dir, std::uint64_t fingerprint,
+	const BenchmarkResult& result);
+
+[[nodiscard]] std::vector<BenchmarkResult> loadBenchmarks(
+	const std::filesystem::path& dir, std::uint64_t fingerprint);
+
+// Table of the stats, one measure per line
+[[nodiscard]] std::string formatBenchmark(const BenchmarkResult& result);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "ffmpeg/filter_node.hpp"
+
+// Vertex ids at the other end of a vertex's edges. Nearly every vertex of
+// a graph has one or two, so up to INLINE of them are kept in place and
+// only longer lists, outputs feeding many inputs, go to the heap. At 24
+// bytes it is no larger than a std::vector, so a list of them stays one
+// flat block.
+class EdgeList {
+   public:
+	static constexpr std::uint32_t INLINE = 4;
+
+   private:
+	std::uint32_t count = 0;
+	std::uint32_t capacity = INLINE;
+	union {
+		IdBaseType local[INLINE];
+		IdBaseType* heap;
+	};
+
+	[[nodiscard]] bool spilled() const { return capacity > INLINE; }
+
+	void release() {
+		if (spilled()) { delete[] heap; }
+		capacity = INLINE;
+	}
+
+	void take(EdgeList& other) {
+		if (other.spilled()) {
+			heap = other.heap;
+		} else {
+			std::copy(other.local, other.local + other.count, local);
+		}
+		count = other.count;
+		capacity = other.capacity;
+		other.count = 0;
+		other.capacity = INLINE;
+	}
+
+   public:
+	using value_type = IdBaseType;
+	using iterator = IdBaseType*;
+	using const_iterator = const IdBaseType*;
+
+	EdgeList() {}
+	EdgeList(const EdgeList& other) {
+		reserve(other.count);
+		std::copy(other.begin(), other.end(), begin());
+		count = other.count;
+	}
+	EdgeList(EdgeList&& other) noexcept { take(other); }
+	EdgeList& operator=(const EdgeList& other) {
+		if (this == &other) { return *this; }
+		count = 0;
+		reserve(other.count);
+		std::copy(other.begin(), other.end(), begin());
+		count = other.count;
+		return *this;
+	}
+	EdgeList& operator=(EdgeList&& other) noexcept {
+		if (this == &other) { return *this; }
+		release();
+		take(other);
+		return *this;
+	}
+	~EdgeList() { release(); }
+
+	[[nodiscard]] IdBaseType* data() { return spilled() ? heap : local; }
+	[[nodiscard]] const IdBaseType* data() const {
+		return spilled() ? heap : local;
+	}
+	[[nodiscard]] iterator begin() { return data(); }
+	[[nodiscard]] iterator end() { return data() + count; }
+	[[nodiscard]] const_iterator begin() const { return data(); }
+	[[nodiscard]] const_iterator end() const { return data() + count; }
+	[[nodiscard]] size_t size() const { return count; }
+	[[nodiscard]] bool empty() const { return count == 0; }
+	IdBaseType& operator[](size_t i) { return data()[i]; }
+	const IdBaseType& operator[](size_t i) const { return data()[i]; }
+
+	void reserve(size_t n) {
+		if (n <= capacity) { return; }
+		auto* grown = new IdBaseType[n];
+		std::copy(begin(), end(), grown);
+		release();
+		heap = grown;
+		capacity = std::uint32_t(n);
+	}
+
+	void push_back(IdBaseType id) {
+		if (count == capacity) { reserve(size_t(capacity) * 2); }
+		data()[count++] = id;
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		auto* b = begin();
+		auto* f = b + (first - b);
+		auto* e = std::move(b + (last - b), end(), f);
+		count = std::uint32_t(e - b);
+		return f;
+	}
+
+	void clear() { count = 0; }
+};
@@ -1,8 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <map>
+#include <optional>
+#include <set>
 #include <vector>
 
+#include "ffmpeg/benchmark.hpp"
+#include "ffmpeg/edge_list.hpp"
+#include "ffmpeg/proxy_cache.hpp"
+#include "ffmpeg/runner.hpp"
 #include "filter_node.hpp"
 #include "pref.hpp"
 
@@ -24,33 +34,114 @@ using OutputSocketCallback =
 
 struct GraphState {
 	bool changed = false;
-	std::vector<bool> valid;
-	std::vector<bool> isSocket;
-	std::vector<bool> isInput;
+	// A byte a flag rather than a bit, every step of a traversal reads them
+	std::vector<std::uint8_t> valid;
+	std::vector<std::uint8_t> isSocket;
+	std::vector<std::uint8_t> isInput;
 	std::vector<size_t> vertIdToNodeIndex;
 	std::vector<size_t> vertIdToSocketIndex;
-	std::vector<std::vector<size_t>> adjList;
-	std::vector<std::vector<size_t>> revAdjList;
+	std::vector<EdgeList> adjList;
+	std::vector<EdgeList> revAdjList;
+	// Moved on each time a vertex is reused and part of its ids, so ids
+	// kept past a delete never name what took the vertex's place. A vertex
+	// out of generations isn't reused till compact.
+	std::vector<std::uint16_t> generation;
+	std::uint16_t firstGeneration = 0;	// of vertices added at the end
+	std::vector<IdBaseType> freeVertices;  // deleted, reused first
+};
+
+struct PreviewOptions {
+	double scale = 1;	// applied to the resolution of every input
+	int maxHeight = 0;	// 0 means no limit
+	double maxFps = 0;	// 0 means no limit
+	bool useProxies = false;
+	bool useCache = false;	// read cached subgraph outputs when available
+	// Map only the first output of this type, the rest goes to sinks
+	std::optional<SocketType> singleOutput;
+	// Vertex ids of nodes to emit thumbnails of instead of the graph's
+	// outputs, see FilterGraph::thumbnails
+	std::set<IdBaseType> thumbnails;
+	// Vertex ids of nodes previewed together instead of the graph's
+	// outputs, see FilterGraph::playTogether. Their first video and audio
+	// outputs are mapped in this order.
+	std::vector<IdBaseType> together;
+	bool mosaic = false;  // stack the videos of together into one
 };
 
 enum class FilterGraphErrorCode {
 	PLAYER_NO_ERROR,
 	PLAYER_MISSING_INPUT,
-	PLAYER_RUNTIME
+	PLAYER_RUNTIME,
+	PLAYER_UNSUPPORTED
 };
 struct FilterGraphError {
 	FilterGraphErrorCode code;
 	std::string message;
+	NodeId node = INVALID_NODE;	 // node ffmpeg blamed, if it named one
+};
+
+// Share of a node in the cost of the graph, see FilterGraph::profileCosts
+struct NodeCost {
+	double cpu = 0;		   // seconds of utime + stime added by the node
+	double prefixCpu = 0;  // seconds for the graph till the node
+	double fps = 0;		   // throughput of the graph till the node
+	double fpsDrop = 0;	   // fps lost against the slowest input
 };
 
 class FilterGraph {
 	std::vector<FilterNode> nodes;
+	std::vector<size_t> freeNodes;	// indices into nodes of deleted ones
 	GraphState state;
 	const Profile* profile;
 
+	// Runs of profileCosts by the fingerprint of the node they end at, so
+	// only edited parts of the graph are measured again
+	std::map<std::uint64_t, BenchmarkRun> costRuns;
+	std::map<IdBaseType, NodeCost> costs;
+	std::uint64_t revision = 0;	 // bumped on every edit
+	// Proxy keys of input nodes by vertex id, for proxyState. Making one
+	// reads the file's metadata, so they're kept till the next edit.
+	mutable std::map<IdBaseType, std::optional<std::string>> proxyKeys;
+	mutable std::uint64_t proxyKeysRevision = ~0ULL;
+
+	// Fingerprints of id and every node upstream of it, by vertex id
+	[[nodiscard]] std::map<IdBaseType, std::uint64_t> fingerprints(
+		const NodeId& id, const PreviewOptions& preview) const;
+
+	// Queues renders of the subgraphs feeding id into the render cache
+	void requestCache(const NodeId& id, const PreviewOptions& preview) const;
+
+	// Uses the thread settings found by tune, if any
+	void applyTuning(Command& cmd, const NodeId& id) const;
+
+	// Hash of each node with an output of type and every input linked,
+	// and of salt, by node id
+	[[nodiscard]] std::map<IdBaseType, std::uint64_t> outputKeys(
+		SocketType type, double salt) const;
+
+	// Generated inputs can differ from the real ones, so a failed validate
+	// is only advice: the real run decides, and if it fails too the node
+	// found by validate is blamed for it
+	FilterGraphError blame(
+		FilterGraphError err, const FilterGraphError& checked) const;
+	// First failure of validate over ids
+	FilterGraphError validateAll(const std::vector<NodeId>& ids) const;
+	// Emits every node of ids to be played together
+	FilterGraphError emitTogether(
+		Command& cmd, const std::vector<NodeId>& ids,
+		PreviewOptions preview) const;
+	// Shared ends of play and stream and their together variants
+	FilterGraphError playCommand(
+		const Preference& pref, const Command& cmd, const Segment& window,
+		const std::atomic_bool* cancel) const;
+	FilterGraphError streamCommand(
+		const Command& cmd, FrameRing& ring, const Segment& window,
+		const std::atomic_bool* cancel) const;
+
    public:
 	FilterGraph(const Profile& p) : profile(&p) {}
 
+	// INVALID_NODE once the graph is out of vertex ids, 32768 of them
 	NodeId addNode(const Filter& filter);
 	void deleteNode(NodeId id);
 	void deleteLink(LinkId id);
@@ -66,19 +157,146 @@ class FilterGraph {
 
 	void iterateLinks(const EdgeIterCallback& cb) const;
 
+	// Nodes with outputs, none of which are linked to anything but output
+	// nodes
+	[[nodiscard]] std::vector<NodeId> ends() const;
+	// What to render for id: an output node writes what the node linked to
+	// it gives, INVALID_NODE if none is. Other nodes are their own target.
+	[[nodiscard]] NodeId renderTarget(const NodeId& id) const;
+	// Filename of an output node linked to id, empty if there is none
+	[[nodiscard]] std::filesystem::path outputFile(const NodeId& id) const;
+
 	void inputSockets(NodeId u, const InputSocketCallback& cb) const;
 	void outputSockets(NodeId u, const OutputSocketCallback& cb) const;
 
 	[[nodiscard]] const FilterNode& getNode(NodeId id) const;
 	FilterNode& getNode(NodeId id);
 
+	// False for ids of deleted nodes and sockets, even once reused
+	[[nodiscard]] bool valid(NodeId id) const;
+	// Vertices in use or waiting for reuse, what compact shrinks
+	[[nodiscard]] size_t vertexCount() const { return state.valid.size(); }
+	// Drops deleted vertices and nodes, numbering the rest densely in
+	// their order. Returns the new id of every node and socket by its old
+	// one. Old ids are all invalid afterwards, except once in about a
+	// thousand compactions, when generations run out and start over: ids
+	// not moved through the returned map may then name another node.
+	std::map<int, NodeId> compact();
+
 	[[nodiscard]] const std::vector<Filter>& allFilters() const;
 
+	// State of the preview proxy for an input node. Inputs without one
+	// ask for it, caching may have been turned on since they were loaded.
+	[[nodiscard]] ProxyState proxyState(const NodeId& id) const;
+
 	void clear();
 
+	bool save(const std::filesystem::path& file);
+	// ids, if given, maps the node ids saved in file to the loaded ones
+	bool load(
+		const std::filesystem::path& file,
+		std::map<int, NodeId>* ids = nullptr);
+
+	// Builds the ffmpeg inputs, filter_complex and output maps needed to
+	// evaluate the graph till node id
+	FilterGraphError emit(
+		Command& cmd, const NodeId& id = INVALID_NODE,
+		const PreviewOptions& preview = {}) const;
+
+	// Merkle style hash over the filter, options and input files of id and
+	// the fingerprints of its inputs. Equal fingerprints give equal output.
+	[[nodiscard]] std::uint64_t fingerprint(
+		const NodeId& id, const PreviewOptions& preview = {}) const;
+
+	// Runs a frame of the graph till id on generated inputs, see Validator.
+	// Play and render do this first to name the node when they fail.
+	[[nodiscard]] FilterGraphError validate(const NodeId& id) const;
+
+	// Previews only the window of the inputs, seeking on the input side.
+	// Setting cancel stops ffmpeg and closes the player.
 	FilterGraphError play(
-		const Preference& pref, const NodeId& id = INVALID_NODE);
+		const Preference& pref, const NodeId& id = INVALID_NODE,
+		const Segment& window = {0, 0},
+		const std::atomic_bool* cancel = nullptr);
+
+	// Like play, but streams the first video output into ring to be shown
+	// in the editor, see Runner::stream. Only works with a local ffmpeg,
+	// see canStream.
+	[[nodiscard]] bool canStream() const;
+	FilterGraphError stream(
+		const Preference& pref, FrameRing& ring,
+		const NodeId& id = INVALID_NODE, const Segment& window = {0, 0},
+		const std::atomic_bool* cancel = nullptr);
+
+	// Plays the nodes in ids in a single ffmpeg run, so what they share
+	// upstream is decoded and filtered once. Their videos are tiled into a
+	// mosaic with pref.previewMosaic, otherwise each is a stream of its own
+	// the player can switch to.
+	FilterGraphError playTogether(
+		const Preference& pref, const std::vector<NodeId>& ids,
+		const Segment& window = {0, 0},
+		const std::atomic_bool* cancel = nullptr);
+	// Like playTogether, streaming the mosaic into ring
+	FilterGraphError streamTogether(
+		const Preference& pref, FrameRing& ring, const std::vector<NodeId>& ids,
+		const Segment& window = {0, 0},
+		const std::atomic_bool* cancel = nullptr);
+
+	// Renders to dest by splitting the inputs into keyframe aligned time
+	// segments and processing them in parallel. segments = 0 picks the count
+	// from available cores. More than one segment needs every node to work
+	// frame by frame
+	FilterGraphError render(
+		const std::filesystem::path& dest, const NodeId& id = INVALID_NODE,
+		unsigned segments = 0,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Times a short sample of the graph till id with a few thread settings
+	// and keeps the fastest for later plays and renders of the same graph
+	FilterGraphError tune(
+		const NodeId& id, const std::atomic_bool* cancel = nullptr) const;
+
+	// Runs the graph till id into a null sink repeatedly and appends the
+	// statistics to the history of its fingerprint, in appDir/benchmarks
+	FilterGraphError benchmark(
+		const NodeId& id, unsigned repetitions, BenchmarkResult& result,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Benchmarks a short sample of the graph till each node upstream of id,
+	// in topological order, and charges every node the CPU time its run
+	// adds over the nodes feeding it and the fps it loses against its
+	// slowest input. Costs are dropped on any edit of the graph.
+	FilterGraphError profileCosts(
+		const NodeId& id, const std::atomic_bool* cancel = nullptr);
+	// Keeps the runs profiled on other, a copy of this graph, and its costs
+	// if neither graph was edited since the copy
+	void takeCosts(const FilterGraph& other);
+	[[nodiscard]] const NodeCost* cost(const NodeId& id) const;
+	// Largest cpu of the profiled nodes, to scale the others by
+	[[nodiscard]] double maxCost() const;
+
+	// Keys into profile's ThumbnailCache by node id, for the nodes that can
+	// have a thumbnail at time: those with a video output and every input
+	// linked
+	[[nodiscard]] std::map<IdBaseType, std::uint64_t> thumbnailKeys(
+		double time) const;
+	// Renders the missing thumbnails at time, all in a single ffmpeg run.
+	// Each video output asked for is split, one branch scaled to a
+	// thumbnail and the other fed on to its consumers.
+	FilterGraphError thumbnails(
+		double time, const std::atomic_bool* cancel = nullptr) const;
+
+	// Keys into profile's WaveformCache by node id, for the nodes with an
+	// audio output and every input linked
+	[[nodiscard]] std::map<IdBaseType, std::uint64_t> waveformKeys() const;
+	// Reads all of the first audio output of every node of keys missing a
+	// waveform, one ffmpeg run per node
+	FilterGraphError waveforms(
+		const std::map<IdBaseType, std::uint64_t>& keys,
+		const std::atomic_bool* cancel = nullptr) const;
 
+	// Changes on every edit, unlike changed it isn't reset by saving
+	[[nodiscard]] std::uint64_t getRevision() const { return revision; }
 	[[nodiscard]] bool changed() const { return state.changed; }
 	void resetChanged() { state.changed = false; }
 };
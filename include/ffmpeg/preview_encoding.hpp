@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ffmpeg/runner.hpp"
+
+// Codecs previews are encoded with before the player opens them. The
+// encode stands between the filters and the first frame on screen, so
+// all but the default favour speed over size and keep audio as PCM.
+enum PreviewEncoding {
+	EncodingAuto = 0,  // the fastest, see EncodingChooser
+	EncodingUtvideo,   // lossless and intra only
+	EncodingMjpeg,	   // intra only
+	EncodingX264,	   // ultrafast, zerolatency leaves out the lookahead
+	EncodingDefault,   // ffmpeg's choice for matroska, usually x264 medium
+	ENCODING_COUNT
+};
+
+struct EncodingProfile {
+	const char* name;
+	std::vector<std::string> args;	// output options
+	double sizeFactor;	// rough preview bytes per input byte
+};
+
+// Profile of encoding, EncodingAuto has none
+[[nodiscard]] const EncodingProfile& encodingProfile(int encoding);
+
+struct EncodingTiming {
+	int encoding;
+	double firstFrame;	// seconds, < 0 if the encoding failed
+	std::string error;
+};
+
+// Times every encoding but EncodingAuto on cmd till its first frame
+[[nodiscard]] std::vector<EncodingTiming> compareEncodings(
+	const Runner& runner, const Command& cmd,
+	const std::atomic_bool* cancel = nullptr);
+
+// Resolves EncodingAuto. The encodings are compared on a generated 1080p
+// source the first time one is asked for, which takes a second or so.
+class EncodingChooser {
+	std::mutex mutex;
+	std::optional<int> fastest;
+
+   public:
+	// Used when nothing could be measured, eg with remote workers or an
+	// ffmpeg built without x264. Every build can encode with it.
+	static constexpr int FALLBACK = EncodingDefault;
+
+	// A cancelled measurement isn't kept, the next call starts over
+	[[nodiscard]] int choose(
+		const Runner& runner, const std::atomic_bool* cancel = nullptr);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ffmpeg/runner.hpp"
+#include "file_cache.hpp"
+
+// Finished previews, keyed by the command producing them, so replaying an
+// unchanged graph opens the earlier file. Previews still being written are
+// named after the process writing them and files left by processes that no
+// longer run are removed on construction.
+class PreviewStore {
+	std::mutex mutex;
+	FileCache cache;
+
+   public:
+	static constexpr std::uintmax_t DEFAULT_BUDGET = 2048ULL * 1024 * 1024;
+
+	// root is the temp directory shared by every run of the editor
+	PreviewStore(const std::filesystem::path& root, std::uintmax_t budget);
+
+	// Identifies the output of cmd over window, inputs are identified by
+	// path, size and modification time
+	[[nodiscard]] static std::string key(
+		const Command& cmd, const Segment& window);
+
+	// Marks the preview as recently used
+	[[nodiscard]] std::optional<std::filesystem::path> find(
+		std::string_view key) const;
+
+	// Unique path to write the preview for key to
+	[[nodiscard]] std::filesystem::path reserve(std::string_view key) const;
+	bool insert(std::string_view key, const std::filesystem::path& file);
+
+	void setBudget(std::uintmax_t bytes);
+};
+
+// Removes files and directories in root left by runs that crashed
+void scavengeTempFiles(const std::filesystem::path& root);
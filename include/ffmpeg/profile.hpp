@@ -1,16 +1,36 @@
 #pragma once
 
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "ffmpeg/filter.hpp"
+#include "ffmpeg/preview_encoding.hpp"
+#include "ffmpeg/preview_store.hpp"
+#include "ffmpeg/proxy_cache.hpp"
+#include "ffmpeg/render_cache.hpp"
 #include "ffmpeg/runner.hpp"
+#include "ffmpeg/thread_tuner.hpp"
+#include "ffmpeg/thumbnail_cache.hpp"
+#include "ffmpeg/validator.hpp"
+#include "ffmpeg/waveform.hpp"
 
 struct Profile {
 	std::vector<Filter> filters;
 	Runner runner;
+	std::shared_ptr<ProxyCache> proxies;	// may be null
+	std::shared_ptr<RenderCache> renders;	// may be null
+	std::shared_ptr<ThreadTuner> tuner;		// may be null
+	std::shared_ptr<PreviewStore> previews;	// may be null
+	std::shared_ptr<Validator> validator;	// may be null
+	std::shared_ptr<ThumbnailCache> thumbnails;	// may be null
+	std::shared_ptr<WaveformCache> waveforms;	// may be null
+	std::shared_ptr<EncodingChooser> encodings;	// may be null
 
 	Profile(Runner r) : runner(std::move(r)) {}
 };
 
-Profile GetProfile();
+// ffmpeg runs through backend, on this machine by default
+Profile GetProfile(
+	std::shared_ptr<RunnerBackend> backend = std::make_shared<LocalBackend>(),
+	const JobLimits& limits = {});
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "ffmpeg/runner.hpp"
+#include "file_cache.hpp"
+
+// TooLarge proxies were made but don't fit the cache budget
+enum class ProxyState { None, Pending, Ready, Failed, TooLarge };
+
+// Transcodes inputs into small intra-only proxies on a low priority
+// background thread. Proxies are keyed by path, size and modification time
+// so an edited original gets a new proxy.
+class ProxyCache {
+	Runner runner;
+	FileCache cache;
+	bool enabled = false;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::filesystem::path> queue;
+	std::map<std::string, ProxyState> states;
+	std::atomic_bool stop = false;
+	std::thread worker;
+
+	void work();
+	ProxyState transcode(
+		const std::filesystem::path& input, const std::string& key);
+
+   public:
+	// Height of generated proxies
+	static constexpr int HEIGHT = 540;
+
+	ProxyCache(Runner r, std::filesystem::path dir);
+	ProxyCache(const ProxyCache&) = delete;
+	ProxyCache& operator=(const ProxyCache&) = delete;
+	~ProxyCache();
+
+	void configure(bool enable, std::uintmax_t budget);
+
+	// Name of the proxy of input, nothing if input isn't a file. Reads the
+	// metadata of input, callers asking often should keep it.
+	[[nodiscard]] static std::optional<std::string> proxyKey(
+		const std::filesystem::path& input);
+
+	// Queues a proxy for input if caching is enabled
+	void request(const std::filesystem::path& input);
+	void request(const std::filesystem::path& input, const std::string& key);
+
+	[[nodiscard]] ProxyState state(const std::string& key);
+	[[nodiscard]] std::optional<std::filesystem::path> find(
+		const std::filesystem::path& input);
+};
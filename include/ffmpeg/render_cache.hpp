@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "ffmpeg/runner.hpp"
+#include "file_cache.hpp"
+
+// Rendered outputs of subgraphs, addressed by the fingerprint of the node
+// producing them. Every output socket of the node is a stream of the cached
+// file, in socket order. Renders run one at a time on a low priority
+// background thread and only enter the cache once complete.
+class RenderCache {
+	Runner runner;
+	FileCache cache;
+	bool enabled = false;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::pair<std::string, Command>> queue;
+	std::set<std::string> pending;
+	std::atomic_bool stop = false;
+	std::thread worker;
+
+	void work();
+
+   public:
+	RenderCache(Runner r, std::filesystem::path dir);
+	RenderCache(const RenderCache&) = delete;
+	RenderCache& operator=(const RenderCache&) = delete;
+	~RenderCache();
+
+	void configure(bool enable, std::uintmax_t budget);
+	[[nodiscard]] bool isEnabled();
+
+	// Queues cmd to be rendered losslessly unless it is cached already
+	void request(std::uint64_t fingerprint, Command cmd);
+
+	[[nodiscard]] std::optional<std::filesystem::path> find(
+		std::uint64_t fingerprint);
+};
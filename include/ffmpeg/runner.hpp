@@ -1,28 +1,112 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
-using LineScannerCallback = std::function<bool(std::string_view line)>;
+#include "ffmpeg/runner_backend.hpp"
 
 struct Stream {
 	int index;
 	std::string name;
 	std::string type;
+	int width = 0;
+	int height = 0;
+	double fps = 0;
+	std::string pixelFormat;  // eg yuv420p, empty if unknown
+	int sampleRate = 0;
+	int channels = 0;
+	std::string channelLayout;	// eg 5.1(side), empty if unknown
 };
 
 struct MediaInfo {
 	std::vector<Stream> streams;
+	double duration = 0;
 };
 
+// Thread counts passed to ffmpeg, 0 leaves the choice to ffmpeg
+struct ThreadConfig {
+	int threads = 0;  // per decoder and encoder
+	int filterThreads = 0;
+	int filterComplexThreads = 0;
+
+	bool operator==(const ThreadConfig&) const = default;
+};
+
+struct Command {
+	std::vector<std::string> inputs;
+	std::string filter;
+	std::vector<std::string> outputs;
+	std::vector<std::string> encoder;	// output options, eg codecs
+	ThreadConfig threads;
+	// Output labels of filters generating frames, like testsrc or sine.
+	// Their time starts at 0 whatever part of the inputs is read.
+	std::vector<std::string> videoSources, audioSources;
+};
+
+struct Segment {
+	double start;
+	double duration;  // <= 0 means till the end of input
+};
+
+// Limits for every ffmpeg job, 0 disables one. A job over a limit is
+// asked to quit, then terminated and at last killed.
+struct JobLimits {
+	double timeout = 0;		  // seconds of wall clock time
+	double stallTimeout = 60;  // seconds without a new frame
+};
+
+class FrameRing;
+class PreviewStore;
+
+struct PlayOptions {
+	PreviewStore* store = nullptr;	// keeps complete previews if set
+	// Bytes of RAM previews may use at once, Linux only. Previews
+	// expected to be larger are written to disk.
+	std::uintmax_t memoryBudget = 0;
+	// Expected preview bytes per input byte, given by the encoder
+	double sizeFactor = 1;
+	// Once set, ffmpeg is asked to quit and the player is closed
+	const std::atomic_bool* cancel = nullptr;
+};
+
+// Shared by every run of the editor, see PreviewStore
+std::filesystem::path tempDirectory();
+
 class Runner {
 	std::filesystem::path path;
+	std::shared_ptr<RunnerBackend> backend;
+	JobLimits limits;
+
+	[[nodiscard]] std::unique_ptr<RunnerJob> start(
+		std::vector<std::string> args, bool lowPriority = false) const;
+	// Runs args, which write to stdout, passing what they write to cb till
+	// it returns false. Only works with a local ffmpeg, workers can't pass
+	// on binary output.
+	[[nodiscard]] std::pair<int, std::string> readOutput(
+		const std::vector<std::string>& args,
+		const std::function<bool(std::string_view)>& cb,
+		const std::atomic_bool* cancel) const;
 
    public:
-	Runner() : path("ffmpeg") {}
-	Runner(std::filesystem::path p) : path(std::move(p)) {}
+	Runner() : Runner("ffmpeg") {}
+	Runner(
+		std::filesystem::path p,
+		std::shared_ptr<RunnerBackend> b = std::make_shared<LocalBackend>())
+		: path(std::move(p)), backend(std::move(b)) {}
+
+	// Applies to jobs started afterwards, copies made later keep them
+	void setLimits(const JobLimits& l) { limits = l; }
+	// Kills every job being cancelled or stopped from then on right away,
+	// of all runners, instead of asking ffmpeg to quit first. For exiting
+	// without waiting on jobs nobody needs any more.
+	static void shutdown();
+	// Whether ffmpeg runs on this machine, which reading its output needs
+	[[nodiscard]] bool isLocal() const { return backend->isLocal(); }
 	[[nodiscard]] int lineScanner(
 		std::vector<std::string> args, const LineScannerCallback& cb,
 		bool readStdErr = false) const;
@@ -32,5 +116,63 @@ class Runner {
 		const std::vector<std::string>& outputs,
 		const std::string& player) const;
 
+	// Only the window of every input is processed. With a store, complete
+	// previews are kept and an unchanged command replays the kept file.
+	[[nodiscard]] std::pair<int, std::string> play(
+		const Command& cmd, const std::string& player,
+		const Segment& window = {0, 0}, const PlayOptions& options = {}) const;
+
+	// Streams the first output of cmd, which must be video, into ring as
+	// rgba frames of its size, paced to play in real time. Runs till the
+	// window ends, ring is closed or cancel is set, then closes ring.
+	[[nodiscard]] std::pair<int, std::string> stream(
+		const Command& cmd, FrameRing& ring, const Segment& window = {0, 0},
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Reads all of the first output of cmd, which must be audio, as
+	// interleaved float samples. cb gets them piece by piece as fast as
+	// ffmpeg decodes, till it returns false.
+	[[nodiscard]] std::pair<int, std::string> readAudio(
+		const Command& cmd, int rate, int channels,
+		const std::function<bool(const float*, size_t)>& cb,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Seconds till ffmpeg muxes the first frame of cmd, encoded with its
+	// encoder options into matroska, then stops it. Like stream, needs
+	// ffmpeg on this machine.
+	[[nodiscard]] std::pair<int, std::string> firstFrame(
+		const Command& cmd, double& seconds,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Renders each segment in a separate ffmpeg process at once and joins
+	// the results with the concat demuxer
+	[[nodiscard]] std::pair<int, std::string> render(
+		const Command& cmd, const std::vector<Segment>& segments,
+		const std::filesystem::path& dest,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Runs cmd over the whole of its inputs into dest
+	[[nodiscard]] std::pair<int, std::string> encode(
+		const Command& cmd, const std::filesystem::path& dest,
+		const std::atomic_bool* cancel = nullptr,
+		bool lowPriority = false) const;
+
+	// Takes the first frame at time of every output of cmd, each of which
+	// must be rgba of bytes per frame, in one ffmpeg run. Outputs without
+	// a frame soon after time give an empty image.
+	[[nodiscard]] std::pair<int, std::string> thumbnails(
+		const Command& cmd, double time, size_t bytes,
+		std::vector<std::vector<std::uint8_t>>& images,
+		const std::atomic_bool* cancel = nullptr) const;
+
+	// Runs ffmpeg to completion, or until cancel is set or a limit is hit.
+	// ffmpeg is stopped gently first, so dest stays playable.
+	[[nodiscard]] std::pair<int, std::string> run(
+		std::vector<std::string> args,
+		const std::atomic_bool* cancel = nullptr,
+		bool lowPriority = false) const;
+
 	[[nodiscard]] MediaInfo getInfo(const std::filesystem::path& p) const;
+	[[nodiscard]] std::vector<double> getKeyframes(
+		const std::filesystem::path& p) const;
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using LineScannerCallback = std::function<bool(std::string_view line)>;
+
+// Ways to stop a job, gentlest first. ffmpeg finishes its outputs on Quit
+// and Terminate, so what it wrote so far stays playable.
+enum class StopLevel {
+	Quit,		// q on stdin
+	Terminate,	// SIGTERM, TerminateProcess on Windows
+	Kill,		// SIGKILL
+};
+
+// A process started by a RunnerBackend. isRunning, stop and terminate may
+// be called from any thread.
+class RunnerJob {
+   public:
+	virtual ~RunnerJob() = default;	 // terminates the process if running
+
+	[[nodiscard]] virtual bool isRunning() = 0;
+	virtual void stop(StopLevel level) = 0;
+	void terminate() { stop(StopLevel::Kill); }
+
+	// Calls cb with every line of stdout, or stderr, till it returns false
+	// or the stream ends
+	virtual void readLines(const LineScannerCallback& cb, bool readStdErr) = 0;
+	// Same for stdout as it arrives, in pieces of any size. Unlike lines
+	// these can be binary.
+	virtual void readChunks(
+		const std::function<bool(std::string_view)>& cb) = 0;
+
+	// Rest of the stream, blocks till it ends
+	virtual std::string readStdOut() = 0;
+	virtual std::string readStdErr() = 0;
+
+	// Waits for the process to exit and returns the exit code
+	virtual int finish() = 0;
+};
+
+// Where Runner starts ffmpeg and ffprobe
+class RunnerBackend {
+   public:
+	virtual ~RunnerBackend() = default;
+
+	// args[0] is the program. Returns nullptr if it can't be started.
+	[[nodiscard]] virtual std::unique_ptr<RunnerJob> start(
+		const std::vector<std::string>& args, bool lowPriority = false) = 0;
+
+	// Processes run on this machine and inherit open files
+	[[nodiscard]] virtual bool isLocal() const { return false; }
+};
+
+// Spawns processes on this machine
+class LocalBackend : public RunnerBackend {
+   public:
+	[[nodiscard]] std::unique_ptr<RunnerJob> start(
+		const std::vector<std::string>& args,
+		bool lowPriority = false) override;
+
+	[[nodiscard]] bool isLocal() const override { return true; }
+
+	// Held while starting processes. Whoever makes a file inheritable
+	// holds it till that is undone, so no other process gets the file.
+	[[nodiscard]] static std::recursive_mutex& spawnMutex();
+};
+
+// Shared secret of the workers, FFMPEG_NODE_EDITOR_TOKEN in the
+// environment. Empty if unset.
+[[nodiscard]] std::string workerToken();
+
+// Runs processes on worker daemons, see Worker. Paths in the arguments
+// are used as is, so inputs and outputs must be reachable from the workers
+// at the same paths.
+class RemoteBackend : public RunnerBackend {
+	std::vector<std::string> addresses;
+	std::atomic_uint next = 0;
+	std::string token;
+
+   public:
+	// Comma separated worker addresses, jobs go to them in turn
+	explicit RemoteBackend(
+		std::string_view workers, std::string secret = workerToken());
+
+	[[nodiscard]] std::unique_ptr<RunnerJob> start(
+		const std::vector<std::string>& args,
+		bool lowPriority = false) override;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "ffmpeg/runner.hpp"
+
+// Finds the fastest thread settings for a graph by running a short sample
+// of it with a few candidates. Results are kept per graph fingerprint and
+// core count, so a graph tuned on one machine isn't reused on another.
+// Plays and renders in the background look results up meanwhile.
+class ThreadTuner {
+	std::filesystem::path file;
+	mutable std::mutex mutex;
+	std::map<std::string, ThreadConfig> best;
+
+   public:
+	// Seconds of the inputs run for each measurement
+	static constexpr auto SAMPLE_DURATION = 5;
+	static constexpr auto RUNS = 2;
+
+	explicit ThreadTuner(std::filesystem::path storage);
+
+	[[nodiscard]] std::optional<ThreadConfig> find(
+		std::uint64_t fingerprint) const;
+
+	// Measures cmd with every candidate into a null sink and stores the
+	// fastest
+	[[nodiscard]] std::pair<int, std::string> tune(
+		const Runner& runner, Command cmd, std::uint64_t fingerprint,
+		const std::atomic_bool* cancel = nullptr);
+
+	bool load();
+	bool save() const;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Node thumbnails in memory, keyed by node fingerprint and time. Images
+// are rgba of WIDTH x HEIGHT, an empty one marks a node that gave no
+// frame, so it isn't asked for again. The least recently stored are
+// dropped past CAPACITY.
+class ThumbnailCache {
+	using Image = std::vector<std::uint8_t>;
+	struct Entry {
+		Image image;
+		std::list<std::uint64_t>::iterator position;
+	};
+
+	mutable std::mutex mutex;
+	std::list<std::uint64_t> order;	 // oldest first
+	std::map<std::uint64_t, Entry> images;
+
+   public:
+	static constexpr int WIDTH = 96;
+	static constexpr int HEIGHT = 54;
+	static constexpr size_t BYTES = size_t(WIDTH) * HEIGHT * 4;
+	static constexpr size_t CAPACITY = 1024;
+
+	[[nodiscard]] bool contains(std::uint64_t key) const;
+	[[nodiscard]] std::optional<Image> find(std::uint64_t key) const;
+	void insert(std::uint64_t key, Image image);
+};
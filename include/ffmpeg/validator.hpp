@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ffmpeg/runner.hpp"
+
+struct Validation {
+	int status = 0;
+	std::string message;
+	int instance = 0;  // number in the label of the filter blamed, 0 if none
+};
+
+// Checks a graph by running a frame of it into a null sink, with inputs
+// swapped for generated sources of the same streams. Wrong option values
+// and mismatched pads show up in a moment instead of after a play or
+// render has started. Results are kept per graph fingerprint, which the
+// node ids in the labels are not part of.
+class Validator {
+	mutable std::mutex mutex;
+	std::map<std::uint64_t, Validation> results;
+
+   public:
+	// Results kept before the oldest are dropped
+	static constexpr size_t CACHE_SIZE = 256;
+
+	[[nodiscard]] Validation validate(
+		const Runner& runner, const Command& cmd, std::uint64_t fingerprint);
+};
+
+// lavfi graph with one short source per stream of info, in stream order.
+// Empty if a stream can't be generated, eg subtitles.
+std::string nullSource(const MediaInfo& info);
+
+// N of the first "[name@nameN @ 0x...]" context in an ffmpeg log, which
+// addNodeToFilterGraph labels every filter with. 0 if there is none.
+int blamedInstance(std::string_view log);
+
+// N of every "name@nameN" label in filter, in order. Graphs with the same
+// fingerprint differ only in these.
+std::vector<int> labelInstances(std::string_view filter);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Extremes and loudness of a run of samples
+struct Peak {
+	float min = 0;
+	float max = 0;
+	float rms = 0;
+};
+
+// Peaks of interleaved audio at zoom levels, each half the resolution of
+// the one before. Level 0 has a peak per block of samples. The block
+// doubles whenever level 0 would outgrow MAX_PEAKS, so hours of audio
+// take no more memory than minutes.
+class Waveform {
+	std::vector<std::vector<Peak>> levels{1};  // level 0 always exists
+	size_t block = MIN_BLOCK;  // samples per peak of level 0
+	std::uint64_t samples = 0;
+
+	// Reduction of the block being filled
+	float partialMin = 0, partialMax = 0;
+	double partialSquares = 0;
+	size_t partialCount = 0;
+
+	void push(const Peak& p);
+
+   public:
+	// Audio is read at this rate and channel count, plenty for a strip a
+	// few hundred pixels wide
+	static constexpr int RATE = 16000;
+	static constexpr int CHANNELS = 2;
+	static constexpr size_t MIN_BLOCK = 256;  // a multiple of CHANNELS
+	static constexpr size_t MAX_PEAKS = 16 * 1024;
+
+	void append(const float* data, size_t count);
+	// Flushes the last block and builds the coarser levels
+	void finish();
+
+	[[nodiscard]] size_t getLevels() const { return levels.size(); }
+	[[nodiscard]] const std::vector<Peak>& level(size_t i) const {
+		return levels[i];
+	}
+	[[nodiscard]] size_t getBlock() const { return block; }
+	[[nodiscard]] std::uint64_t getSamples() const { return samples; }
+
+	// count peaks spanning all of the audio, from the coarsest level that
+	// still has count of them
+	[[nodiscard]] std::vector<Peak> columns(size_t count) const;
+};
+
+// Finished waveforms keyed by node fingerprint. An empty waveform marks a
+// node that gave no audio, so it isn't asked for again. The least
+// recently stored are dropped past CAPACITY.
+class WaveformCache {
+	struct Entry {
+		std::shared_ptr<const Waveform> waveform;
+		std::list<std::uint64_t>::iterator position;
+	};
+
+	mutable std::mutex mutex;
+	std::list<std::uint64_t> order;	 // oldest first
+	std::map<std::uint64_t, Entry> waveforms;
+
+   public:
+	static constexpr size_t CAPACITY = 64;
+
+	[[nodiscard]] bool contains(std::uint64_t key) const;
+	[[nodiscard]] std::shared_ptr<const Waveform> find(
+		std::uint64_t key) const;
+	void insert(std::uint64_t key, Waveform waveform);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg/runner.hpp"
+#include "ffmpeg/runner_backend.hpp"
+#include "stream_socket.hpp"
+
+// What a Worker lets its clients do
+struct WorkerOptions {
+	std::set<std::string> programs{"ffmpeg", "ffprobe"};  // as args[0]
+	// Inputs are read from these and outputDirs
+	std::vector<std::filesystem::path> inputDirs;
+	std::vector<std::filesystem::path> outputDirs{tempDirectory()};
+	// Sent by clients with every job, see workerToken. Without one any
+	// client is served, so listening on every interface needs one.
+	std::string token;
+};
+
+// Runs jobs for RemoteBackend clients, one connection per job. The client
+// sends {"token": text, "args": [...], "low_priority": bool} on a line and
+// gets back {"stdout": text} and {"stderr": text} lines while the job
+// runs, then a final {"exit": code}. Meanwhile {"stop": level} lines, a
+// StopLevel, stop the job gently. Closing the connection early kills the
+// job. Only jobs shaped like the editor's are run: ffprobe on one input,
+// or ffmpeg reading from the allowed dirs and writing to stdout or
+// outputDirs.
+class Worker {
+	std::shared_ptr<RunnerBackend> backend;
+	WorkerOptions options;
+	StreamSocket listener;
+
+	std::mutex mutex;
+	std::list<std::shared_ptr<StreamSocket>> clients;
+	std::list<std::thread> threads;
+	std::vector<std::thread::id> finished;	// threads left to join
+	bool stopped = false;
+
+	void handle(const std::shared_ptr<StreamSocket>& client);
+	void reap();  // joins finished threads, needs mutex
+
+   public:
+	explicit Worker(
+		std::shared_ptr<RunnerBackend> b, WorkerOptions o = {})
+		: backend(std::move(b)), options(std::move(o)) {}
+	Worker(const Worker&) = delete;
+	Worker& operator=(const Worker&) = delete;
+	~Worker() { stop(); }
+
+	// False if it can't, or address is every interface ("*:port") and
+	// there is no token
+	[[nodiscard]] bool listen(std::string_view address);
+
+	// Accepts clients till stop is called, each on its own thread
+	void serve();
+
+	// Disconnects every client, which kills their jobs
+	void stop();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+// A directory of files limited to a byte budget. Entries are evicted least
+// recently used first, using the modification time to track use. Files
+// ending in ".part" are still being written and are left alone.
+class FileCache {
+	std::filesystem::path dir;
+	std::uintmax_t budget;
+
+	// Evicts down to budget, never removing keep
+	void evict(const std::filesystem::path& keep);
+
+   public:
+	FileCache(std::filesystem::path directory, std::uintmax_t budget);
+
+	[[nodiscard]] const std::filesystem::path& directory() const {
+		return dir;
+	}
+	[[nodiscard]] std::filesystem::path path(std::string_view key) const {
+		return dir / key;
+	}
+
+	[[nodiscard]] bool contains(std::string_view key) const;
+
+	// Marks the entry as recently used
+	[[nodiscard]] std::optional<std::filesystem::path> find(
+		std::string_view key) const;
+
+	[[nodiscard]] bool fits(std::uintmax_t bytes) const {
+		return bytes <= budget;
+	}
+
+	// Moves file into the cache and evicts other entries above budget.
+	// Files larger than the whole budget are removed instead.
+	bool insert(std::string_view key, const std::filesystem::path& file);
+
+	void setBudget(std::uintmax_t bytes);
+	void evict();
+
+	[[nodiscard]] std::uintmax_t size() const;
+};
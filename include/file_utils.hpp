@@ -10,6 +10,7 @@ std::optional<std::filesystem::path> openFile();
 std::optional<std::filesystem::path> saveFile(std::string_view fileType);
 
 void showErrorMessage(std::string const&, std::string const&);
+void showInfoMessage(std::string const&, std::string const&);
 
 int showActionDialog(
 	std::string const& title, std::string const& text,
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Fixed number of preallocated RGBA frames passed from one producer
+// thread to one consumer. A producer finding every slot full waits, which
+// in turn stops it reading ffmpeg's pipe. The consumer only wants the
+// newest frame and drops any older ones.
+class FrameRing {
+	mutable std::mutex mutex;
+	std::condition_variable space;
+	const int width, height;
+	const size_t frameBytes, slots;
+	std::vector<std::uint8_t> storage;
+	size_t read = 0;   // oldest published slot
+	size_t count = 0;  // published slots, plus the one being consumed
+	bool closed = false;
+	std::uint64_t published = 0, dropped = 0;
+
+   public:
+	static constexpr size_t DEFAULT_SLOTS = 4;
+
+	FrameRing(int w, int h, size_t s = DEFAULT_SLOTS);
+
+	[[nodiscard]] int getWidth() const { return width; }
+	[[nodiscard]] int getHeight() const { return height; }
+	[[nodiscard]] size_t getFrameBytes() const { return frameBytes; }
+
+	// Empties and reopens the ring, keeping its memory
+	void reset();
+
+	// Slot to write the next frame to, waits while all of them are full.
+	// nullptr once the ring is closed or cancel is set.
+	[[nodiscard]] std::uint8_t* acquire(
+		const std::atomic_bool* cancel = nullptr);
+	// Hands the acquired slot to the consumer
+	void publish();
+	// No more frames will come, wakes a waiting producer. Published frames
+	// can still be consumed.
+	void close();
+
+	// Calls cb with the newest published frame, if any, unlocked so the
+	// producer can go on meanwhile. Returns whether cb was called.
+	bool consume(const std::function<void(const std::uint8_t*)>& cb);
+
+	[[nodiscard]] bool isClosed() const;
+	[[nodiscard]] std::uint64_t getPublished() const;
+	[[nodiscard]] std::uint64_t getDropped() const;
+};
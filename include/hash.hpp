@@ -0,0 +1,54 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// 64 bit FNV-1a, used for cache keys and fingerprints
+class Hasher {
+	static constexpr std::uint64_t OFFSET = 14695981039346656037ULL;
+	static constexpr std::uint64_t PRIME = 1099511628211ULL;
+	std::uint64_t state = OFFSET;
+
+	void mix(const void* data, size_t size) {
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			state = (state ^ bytes[i]) * PRIME;
+		}
+	}
+
+   public:
+	Hasher& add(std::string_view data) {
+		// Length prefix, so ("ab", "c") and ("a", "bc") differ
+		const auto size = data.size();
+		mix(&size, sizeof(size));
+		mix(data.data(), data.size());
+		return *this;
+	}
+
+	template <typename T>
+		requires std::is_arithmetic_v<T>
+	Hasher& add(const T& value) {
+		mix(&value, sizeof(value));
+		return *this;
+	}
+
+	// Identifies a file by path, size and modification time, so an edited
+	// file hashes differently
+	Hasher& addFile(const std::filesystem::path& file) {
+		namespace fs = std::filesystem;
+		std::error_code err;
+		add(fs::absolute(file, err).string());
+		add(fs::file_size(file, err));
+		return add(fs::last_write_time(file, err).time_since_epoch().count());
+	}
+
+	[[nodiscard]] std::uint64_t value() const { return state; }
+	[[nodiscard]] std::string hex() const {
+		return fmt::format("{:016x}", state);
+	}
+};
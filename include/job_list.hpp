@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <string>
+
+#include "ffmpeg/filter_graph.hpp"
+
+// Plays and renders started from an editor. Each runs on a thread of its
+// own, so the editor stays usable and can cancel them.
+class JobList {
+	struct Job {
+		std::string name;
+		NodeId node;
+		std::chrono::steady_clock::time_point started;
+		bool report = true;
+		std::atomic_bool cancel = false;
+		std::future<FilterGraphError> result;
+	};
+	std::list<Job> jobs;
+
+   public:
+	using Task = std::function<FilterGraphError(const std::atomic_bool*)>;
+
+	JobList() = default;
+	JobList(JobList&&) = default;
+	JobList& operator=(JobList&&) = default;
+	// Cancels every job and waits for them, see Runner::shutdown to not
+	// wait long
+	~JobList();
+
+	// task must not refer to the graph being edited, give it a copy.
+	// Results of background work nobody waits for need no report.
+	void start(
+		std::string name, const NodeId& node, Task task, bool report = true);
+	void cancel(const NodeId& node);
+	void cancelAll();
+	// Follows the node ids of FilterGraph::compact, jobs of nodes not in
+	// ids are left without one
+	void remap(const std::map<int, NodeId>& ids);
+
+	[[nodiscard]] bool empty() const { return jobs.empty(); }
+	// Name of the first job running for node, nullptr if there is none
+	[[nodiscard]] const std::string* running(const NodeId& node) const;
+
+	// Drops finished jobs, results of jobs not cancelled go to report
+	void collect(const std::function<void(const FilterGraphError&)>& report);
+
+	// Table of the jobs with a cancel button each
+	void draw();
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Keeps the last capacity bytes of a log in a ring, plus the first few
+// lines that look like errors. In ffmpeg output those usually name the
+// cause of whatever follows, and they would be pushed out of the tail
+// first.
+class LogBuffer {
+	mutable std::mutex mutex;
+	std::vector<char> ring;
+	size_t begin = 0;  // oldest byte in ring
+	size_t size = 0;
+	std::uintmax_t total = 0;	 // bytes appended
+	std::uintmax_t dropped = 0;	 // bytes pushed out of ring
+
+	// Error lines with the offset of their end in the log
+	std::vector<std::pair<std::uintmax_t, std::string>> errors;
+	std::string line;  // start of the current line
+
+	void scanLines(std::string_view data);
+
+   public:
+	static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+	static constexpr size_t ERROR_LINES = 8;
+	static constexpr size_t LINE_LIMIT = 1024;	// longer lines are cut
+
+	explicit LogBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+	void append(std::string_view data);
+	void clear();
+	[[nodiscard]] bool empty() const;
+
+	// Calls cb with the log in order: the error lines pushed out of the
+	// ring, then the ring in one or two pieces. The log stays locked
+	// meanwhile, so the pieces can be used without copying.
+	void read(const std::function<void(std::string_view)>& cb) const;
+	[[nodiscard]] std::string str() const;
+};
+
+// Stderr of every child process, as shown in the log window
+LogBuffer& processLog();
+// Adds output to processLog under the command line that wrote it
+void logProcess(const std::vector<std::string>& args, std::string_view output);
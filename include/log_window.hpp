@@ -0,0 +1,14 @@
+#pragma once
+
+class LogBuffer;
+
+// Shows a log as it grows, scrolled to the end unless the user scrolls up
+class LogWindow {
+	LogBuffer* log;
+
+   public:
+	bool isOpen = false;
+
+	explicit LogWindow(LogBuffer& l) : log(&l) {}
+	void draw();
+};
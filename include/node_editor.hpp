@@ -5,14 +5,25 @@
 #include <imgui.h>
 #include <imnodes.h>
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <memory>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "ffmpeg/filter_graph.hpp"
+#include "job_list.hpp"
 #include "pref.hpp"
+#include "preview_panel.hpp"
+#include "thumbnail_atlas.hpp"
 
 struct FilterNode;
 struct Profile;
+class WaveformCache;
 
 struct Popup {
 	std::string_view type;
@@ -24,17 +35,59 @@ struct Popup {
 	ImVec2 position;
 };
 
+// Left by a job for the editor to finish on the UI thread: apply, if the
+// job set one, runs once done is set
+struct JobOutcome {
+	std::function<void(FilterGraph&)> apply;
+	std::atomic_bool done = false;
+};
+
 class NodeEditor {
 	FilterGraph g;
 	std::shared_ptr<ImNodesEditorContext> context;
+	JobList jobs;
+	std::vector<std::shared_ptr<JobOutcome>> outcomes;
+	// Background work, each list runs one job at most
+	JobList thumbnailJobs, waveformJobs;
+	std::shared_ptr<const WaveformCache> waveformCache;
 
 	bool searchStarted = false;
 	ImGuiTextFilter searchFilter;
 
 	NodeId selectedNodeId = INVALID_NODE;
+	// Blamed by the last job that failed, outlined till a job succeeds
+	NodeId failedNodeId = INVALID_NODE;
+
+	// Part of the inputs used by preview, as entered by the user
+	std::string previewStart;
+	std::string previewDuration;
+	[[nodiscard]] Segment previewWindow() const;
+
+	// Thumbnail keys by node id, and the graph revision and time they were
+	// last asked for
+	std::map<IdBaseType, std::uint64_t> thumbnailKeys;
+	std::pair<std::uint64_t, double> thumbnailRequest{~0ULL, -1};
+	void refreshThumbnails(const Preference& pref);
 
-	void drawNode(const Style& style, const FilterNode& node, const NodeId& id);
-	void handleEdits(const Preference& pref);
+	// Waveform keys by node id, and the graph revision they were last
+	// asked for
+	std::map<IdBaseType, std::uint64_t> waveformKeys;
+	std::uint64_t waveformRevision = ~0ULL;
+	// Nodes drawn in view this frame, those read by the running job and
+	// every key a job was started for
+	std::set<IdBaseType> visibleWaveforms;
+	std::map<IdBaseType, std::uint64_t> waveformsQueued;
+	std::set<std::uint64_t> waveformsAsked;
+	void refreshWaveforms(const Preference& pref);
+
+	// Set by compact, done once this frame's nodes have their positions
+	bool compactRequested = false;
+	void compactGraph();
+
+	void drawNode(
+		const Preference& pref, const FilterNode& node, const NodeId& id,
+		ThumbnailAtlas* atlas);
+	void handleEdits(const Preference& pref, PreviewPanel& panel);
 
 	std::string name;
 	std::filesystem::path path;
@@ -46,11 +99,17 @@ class NodeEditor {
 	[[nodiscard]] std::string getName() const;
 	[[nodiscard]] const std::filesystem::path& getPath() const { return path; };
 	void setPath(std::filesystem::path& p) { path = p; };
-	void draw(const Preference& pref, bool& focused);
+	void draw(
+		const Preference& pref, ThumbnailAtlas& atlas, PreviewPanel& panel,
+		bool& focused);
 
 	[[nodiscard]] bool isClosed() const { return !isOpen; }
 	void close();
 
+	// Drops the deleted nodes kept by the graph on the next draw, see
+	// FilterGraph::compact
+	void compact() { compactRequested = true; }
+
 	[[nodiscard]] bool hasChanges() const { return g.changed(); }
 	bool save();
 	bool load(const std::filesystem::path& path);
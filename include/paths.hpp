@@ -0,0 +1,13 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+struct Paths {
+	std::filesystem::path appDir;
+	std::filesystem::path prefs;
+	std::string iniFile;
+	Paths();
+};
+
+const Paths path;
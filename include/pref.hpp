@@ -1,9 +1,11 @@
 #pragma once
 
-#include <imgui.h>
-
+#include <cstdint>
 #include <filesystem>
 #include <map>
+#include <string>
+
+#include "paths.hpp"
 
 enum class StyleColor {
 	NodeHeader = 0,
@@ -15,26 +17,43 @@ enum class StyleColor {
 	SubtitleSocket
 };
 
+// Colors are ImU32, spelled out so headless code can use Preference
+// without imgui
 struct Style {
-	std::map<StyleColor, ImU32> colors;
+	std::map<StyleColor, std::uint32_t> colors;
 	int colorPicker;
 	Style();
 };
 
-struct Paths {
-	std::filesystem::path appDir;
-	std::filesystem::path prefs;
-	std::string iniFile;
-	Paths();
+enum PreviewQuality {
+	PreviewFull = 0,
+	PreviewHalf,
+	PreviewQuarter,
+	PreviewCustom,
 };
 
-const Paths path;
-
 struct Preference {
 	Style style;
 	std::filesystem::path font;
 	int fontSize;
 	std::string player;
+	bool playInEditor = true;	// stream previews into PreviewPanel
+	bool previewMosaic = true;	// tile nodes played together
+	int previewQuality = PreviewFull;
+	int previewEncoding = 0;	// PreviewEncoding, 0 picks the fastest
+	int previewHeight;	// used with PreviewCustom
+	float previewFps;	// 0 keeps the source frame rate
+	bool useProxies = false;
+	int proxyCacheSize;	 // in MiB
+	bool cacheIntermediates = false;
+	int renderCacheSize;  // in MiB
+	int previewCacheSize;	// in MiB
+	int previewMemory = 0;	// in MiB, previews this small stay in RAM
+	bool showThumbnails = false;	// of every node, at the preview start
+	bool showWaveforms = false;	// of every node with an audio output
+	std::string workers;	// comma separated worker addresses, empty is local
+	int jobTimeout = 0;		// seconds an ffmpeg job may run, 0 is no limit
+	int stallTimeout = 60;	// seconds without a new frame, 0 is no limit
 	bool unsaved = false;
 
 	bool isOpen = false;
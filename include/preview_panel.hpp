@@ -0,0 +1,43 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "scope_window.hpp"
+#include "texture_functions.hpp"
+
+class FrameRing;
+
+// Shows previews streamed by FilterGraph::stream. The newest frame is
+// uploaded to a texture once per UI frame. Rings are pooled, a stream
+// still winding down keeps its ring till it lets go of it.
+class PreviewPanel {
+	TextureFunctions functions;
+	ImTextureID texture{};
+	bool created = false;
+	bool hasFrame = false;
+	std::vector<std::shared_ptr<FrameRing>> pool;
+	std::shared_ptr<FrameRing> current;
+	std::string title;
+	ScopeWindow scopes;
+
+	void stop();
+
+   public:
+	static constexpr int WIDTH = 640;
+	static constexpr int HEIGHT = 360;
+
+	bool isOpen = false;
+
+	explicit PreviewPanel(TextureFunctions f);
+	PreviewPanel(const PreviewPanel&) = delete;
+	PreviewPanel& operator=(const PreviewPanel&) = delete;
+	~PreviewPanel();
+
+	// Stops what is shown and gives a ring for the stream of name
+	std::shared_ptr<FrameRing> open(std::string name);
+	void draw();
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+
+#include "scopes.hpp"
+#include "texture_functions.hpp"
+
+// Histogram, waveform and vectorscope of the frames PreviewPanel shows.
+// They are computed by a ScopeWorker, so a slow frame never holds up
+// the UI, it only makes the scopes lag.
+class ScopeWindow {
+	TextureFunctions functions;
+	ImTextureID waveformTexture{}, vectorTexture{};
+	bool created = false;
+	bool hasData = false;
+	ScopeWorker worker;
+	ScopeData data;
+
+	void upload();
+	void drawHistogram();
+
+   public:
+	bool isOpen = false;
+
+	explicit ScopeWindow(TextureFunctions f);
+	ScopeWindow(const ScopeWindow&) = delete;
+	ScopeWindow& operator=(const ScopeWindow&) = delete;
+	~ScopeWindow();
+
+	// Passes a frame on to the worker, unless the window is closed
+	void submit(const std::uint8_t* rgba, int width, int height);
+	void draw();
+};
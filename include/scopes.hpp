@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Video scopes of an RGBA frame, in BT.709 with full range levels
+struct ScopeData {
+	static constexpr int LEVELS = 256;
+	static constexpr int WAVEFORM_COLUMNS = 256;
+	static constexpr int VECTOR_SIZE = 128;	// chroma plane, 2 levels a cell
+	// Rows looked at are spread so no more than this many pixels are
+	static constexpr size_t MAX_SAMPLES = 64 * 1024;
+
+	enum Channel { Luma = 0, Red, Green, Blue, CHANNELS };
+	// Images to make, a window showing one scope needs only that one
+	enum Images : unsigned { NoImages = 0, WaveformImage = 1, VectorImage = 2 };
+	static constexpr unsigned ALL_IMAGES = WaveformImage | VectorImage;
+
+	int width = 0, height = 0;	// of the active picture
+	int rowStep = 1;			// one row in rowStep is counted
+	std::uint64_t samples = 0;	// pixels counted
+	std::array<std::array<std::uint32_t, LEVELS>, CHANNELS> histogram{};
+	// Luma level counts per column, row 0 is level 255. Sampling keeps
+	// them under 64K, and half the size keeps the table in cache.
+	std::vector<std::uint16_t> waveform;
+	// Counts on the Cb (x) Cr (y) plane, row 0 is Cr 255
+	std::vector<std::uint32_t> vectorscope;
+
+	// waveform and vectorscope as images, brighter where counts are higher.
+	// Empty unless asked for.
+	std::vector<std::uint8_t> waveformImage, vectorImage;
+};
+
+// Fills out from a width x height RGBA frame, reusing its memory. Rows
+// and columns with alpha 0 all through are left out, those are the bars
+// letterboxing a preview.
+void computeScopes(
+	const std::uint8_t* rgba, int width, int height, ScopeData& out,
+	unsigned images = ScopeData::ALL_IMAGES);
+
+// Computes scopes on a thread of its own. Frames submitted while one is
+// being computed replace each other, only the newest is looked at.
+class ScopeWorker {
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<std::uint8_t> frame;
+	int width = 0, height = 0;
+	unsigned images = ScopeData::ALL_IMAGES;
+	bool pending = false;
+	bool redo = false;	// images changed, the last frame is done again
+	bool stopping = false;
+	ScopeData computed;
+	bool ready = false;
+	std::thread thread;
+
+	void run();
+
+   public:
+	ScopeWorker();
+	ScopeWorker(const ScopeWorker&) = delete;
+	ScopeWorker& operator=(const ScopeWorker&) = delete;
+	~ScopeWorker();
+
+	// Copies the frame, so it can be reused once this returns
+	void submit(const std::uint8_t* rgba, int w, int h);
+	// Images made from now on, see ScopeData::Images. The last frame is
+	// done again, so a paused preview gets them too.
+	void show(unsigned wanted);
+	// Swaps the newest scopes into out, false if none came since last time
+	bool take(ScopeData& out);
+};
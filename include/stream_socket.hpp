@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Blocking stream socket speaking newline separated messages. Addresses
+// are "unix:/path/to/socket", "tcp:host:port" or just "host:port". A
+// missing host is loopback, "*" listens on every interface.
+class StreamSocket {
+	std::intptr_t fd = -1;
+	std::string buffer;	 // read but not yet returned by readLine
+
+	explicit StreamSocket(std::intptr_t handle) : fd(handle) {}
+
+   public:
+	StreamSocket() = default;
+	StreamSocket(const StreamSocket&) = delete;
+	StreamSocket& operator=(const StreamSocket&) = delete;
+	StreamSocket(StreamSocket&& other) noexcept;
+	StreamSocket& operator=(StreamSocket&& other) noexcept;
+	~StreamSocket() { close(); }
+
+	// Both return an invalid socket on failure
+	[[nodiscard]] static StreamSocket connect(std::string_view address);
+	[[nodiscard]] static StreamSocket listen(std::string_view address);
+
+	[[nodiscard]] StreamSocket accept() const;
+	[[nodiscard]] bool valid() const { return fd != -1; }
+
+	// Longest line readLine takes by default
+	static constexpr size_t LINE_LIMIT = 1024 * 1024;
+
+	bool send(std::string_view data) const;
+	// Without the trailing newline, false once the peer is gone. A peer
+	// sending a longer line than limit is disconnected.
+	bool readLine(std::string& line, size_t limit = LINE_LIMIT);
+
+	// Wakes up threads blocked on the socket, eg in accept or readLine
+	void shutdown() const;
+	void close();
+};
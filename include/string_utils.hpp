@@ -109,6 +109,12 @@ namespace str {
 		return std::equal(a.begin(), a.end(), b.begin(), b.end());
 	}
 
+	// Parses [[HH:]MM:]SS[.m...] into seconds
+	bool stotime(std::string_view str, double& seconds);
+
+	// Shell style pattern, * matches any run of characters and ? any one
+	bool wildcard(std::string_view pattern, std::string_view txt);
+
 	bool match(
 		std::string_view txt, const std::regex& re,
 		std::initializer_list<std::reference_wrapper<std::string_view>> dest);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <functional>
+
+// RGBA textures of the window backend, see Window::CreateTexture. Passed
+// around as functions, so their users run in tests without a window.
+struct TextureFunctions {
+	std::function<ImTextureID(int width, int height)> create;
+	std::function<void(
+		ImTextureID, int x, int y, int width, int height, const void*)>
+		update;
+	std::function<void(ImTextureID)> destroy;
+};
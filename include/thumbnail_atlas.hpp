@@ -0,0 +1,49 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "texture_functions.hpp"
+
+class ThumbnailCache;
+
+// Node thumbnails of every editor packed into a single texture, so drawing
+// them takes no texture switches. Thumbnails are uploaded from the cache
+// on first use, a full atlas reuses the slot drawn least recently.
+class ThumbnailAtlas {
+   public:
+	struct Region {
+		ImTextureID texture;
+		ImVec2 uv0, uv1;
+	};
+
+	static constexpr int SIZE = 1024;  // of the square texture
+
+	ThumbnailAtlas(const ThumbnailCache* c, TextureFunctions f);
+	ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+	ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+	~ThumbnailAtlas();
+
+	// Region holding the thumbnail of key, nullopt if the cache has none
+	[[nodiscard]] std::optional<Region> find(std::uint64_t key);
+
+   private:
+	struct Slot {
+		std::uint64_t key = 0;
+		std::uint64_t used = 0;	 // value of tick when last drawn
+	};
+
+	const ThumbnailCache* cache;
+	TextureFunctions functions;
+	ImTextureID texture{};
+	bool created = false;
+	std::vector<Slot> slots;
+	std::map<std::uint64_t, size_t> index;	// key to slot
+	std::uint64_t tick = 0;
+
+	[[nodiscard]] Region region(size_t slot) const;
+};
@@ -98,6 +98,32 @@ namespace Window {
 		glfwSwapBuffers(window);
 	}
 
+	ImTextureID CreateTexture(int width, int height) {
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexImage2D(
+			GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, nullptr);
+		return (ImTextureID)(intptr_t)texture;
+	}
+
+	void UpdateTexture(
+		ImTextureID texture, int x, int y, int width, int height,
+		const void* rgba) {
+		glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)texture);
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+			rgba);
+	}
+
+	void DestroyTexture(ImTextureID texture) {
+		auto id = (GLuint)(intptr_t)texture;
+		glDeleteTextures(1, &id);
+	}
+
 	void Shutdown() {
 		ImGui_ImplOpenGL3_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -72,6 +72,10 @@ namespace Window {
 	bool g_SwapChainOccluded = false;
 	HANDLE g_hSwapChainWaitableObject = nullptr;
 
+	// Slot 0 of the SRV heap holds the font, textures take the others
+	constexpr int MAX_TEXTURES = 15;
+	std::array<ID3D12Resource*, MAX_TEXTURES> g_textures = {};
+
 	std::array<ID3D12Resource*, NUM_BACK_BUFFERS> g_mainRenderTargetResource;
 	std::array<D3D12_CPU_DESCRIPTOR_HANDLE, NUM_BACK_BUFFERS>
 		g_mainRenderTargetDescriptor;
@@ -200,6 +204,174 @@ namespace Window {
 		frameCtx->FenceValue = fenceValue;
 	}
 
+	// Blocks till the GPU is done with everything queued so far
+	void WaitForGpu() {
+		const auto fenceValue = ++g_fenceLastSignaledValue;
+		g_pd3dCommandQueue->Signal(g_fence, fenceValue);
+		if (g_fence->GetCompletedValue() >= fenceValue) { return; }
+		g_fence->SetEventOnCompletion(fenceValue, g_fenceEvent);
+		WaitForSingleObject(g_fenceEvent, INFINITE);
+	}
+
+	UINT64 TextureOffset(int slot) {
+		const auto increment = g_pd3dDevice->GetDescriptorHandleIncrementSize(
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		return UINT64(slot + 1) * increment;
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE TextureCpuHandle(int slot) {
+		auto handle = g_pd3dSrvDescHeap->GetCPUDescriptorHandleForHeapStart();
+		handle.ptr += TextureOffset(slot);
+		return handle;
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE TextureGpuHandle(int slot) {
+		auto handle = g_pd3dSrvDescHeap->GetGPUDescriptorHandleForHeapStart();
+		handle.ptr += TextureOffset(slot);
+		return handle;
+	}
+
+	int TextureSlot(ImTextureID texture) {
+		for (auto i = 0; i < MAX_TEXTURES; ++i) {
+			if (g_textures[i] != nullptr &&
+				(ImTextureID)TextureGpuHandle(i).ptr == texture) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	ImTextureID CreateTexture(int width, int height) {
+		auto slot = 0;
+		while (slot < MAX_TEXTURES && g_textures[slot] != nullptr) { slot++; }
+		if (slot == MAX_TEXTURES) {
+			SPDLOG_ERROR("out of texture slots");
+			return ImTextureID{};
+		}
+
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_DEFAULT;
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = width;
+		desc.Height = height;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		ID3D12Resource* texture = nullptr;
+		if (g_pd3dDevice->CreateCommittedResource(
+				&props, D3D12_HEAP_FLAG_NONE, &desc,
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr,
+				IID_PPV_ARGS(&texture)) != S_OK) {
+			return ImTextureID{};
+		}
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srv = {};
+		srv.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srv.Texture2D.MipLevels = 1;
+		srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		g_pd3dDevice->CreateShaderResourceView(
+			texture, &srv, TextureCpuHandle(slot));
+		g_textures[slot] = texture;
+		return (ImTextureID)TextureGpuHandle(slot).ptr;
+	}
+
+	// Copies through an upload buffer and waits for the copy, updates are
+	// small and rare
+	void UpdateTexture(
+		ImTextureID texture, int x, int y, int width, int height,
+		const void* rgba) {
+		const auto slot = TextureSlot(texture);
+		if (slot < 0) { return; }
+		auto* resource = g_textures[slot];
+
+		const UINT rowSize = width * 4;
+		const UINT pitch = (rowSize + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) &
+						   ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_UPLOAD;
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = UINT64(pitch) * height;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.SampleDesc.Count = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ID3D12Resource* upload = nullptr;
+		if (g_pd3dDevice->CreateCommittedResource(
+				&props, D3D12_HEAP_FLAG_NONE, &desc,
+				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+				IID_PPV_ARGS(&upload)) != S_OK) {
+			return;
+		}
+		void* mapped = nullptr;
+		upload->Map(0, nullptr, &mapped);
+		for (auto row = 0; row < height; ++row) {
+			memcpy(
+				static_cast<char*>(mapped) + UINT64(row) * pitch,
+				static_cast<const char*>(rgba) + UINT64(row) * rowSize,
+				rowSize);
+		}
+		upload->Unmap(0, nullptr);
+
+		D3D12_TEXTURE_COPY_LOCATION src = {};
+		src.pResource = upload;
+		src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		src.PlacedFootprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		src.PlacedFootprint.Footprint.Width = width;
+		src.PlacedFootprint.Footprint.Height = height;
+		src.PlacedFootprint.Footprint.Depth = 1;
+		src.PlacedFootprint.Footprint.RowPitch = pitch;
+		D3D12_TEXTURE_COPY_LOCATION dst = {};
+		dst.pResource = resource;
+		dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		dst.SubresourceIndex = 0;
+
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Transition.pResource = resource;
+		barrier.Transition.Subresource =
+			D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+		ID3D12CommandAllocator* allocator = nullptr;
+		ID3D12GraphicsCommandList* list = nullptr;
+		if (g_pd3dDevice->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)) ==
+				S_OK &&
+			g_pd3dDevice->CreateCommandList(
+				0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator, nullptr,
+				IID_PPV_ARGS(&list)) == S_OK) {
+			barrier.Transition.StateBefore =
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+			list->ResourceBarrier(1, &barrier);
+			list->CopyTextureRegion(&dst, x, y, 0, &src, nullptr);
+			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+			barrier.Transition.StateAfter =
+				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+			list->ResourceBarrier(1, &barrier);
+			list->Close();
+			g_pd3dCommandQueue->ExecuteCommandLists(
+				1, (ID3D12CommandList* const*)&list);
+			WaitForGpu();
+		}
+		if (list != nullptr) { list->Release(); }
+		if (allocator != nullptr) { allocator->Release(); }
+		upload->Release();
+	}
+
+	void DestroyTexture(ImTextureID texture) {
+		const auto slot = TextureSlot(texture);
+		if (slot < 0) { return; }
+		WaitForGpu();
+		g_textures[slot]->Release();
+		g_textures[slot] = nullptr;
+	}
+
 	void Shutdown() {
 		WaitForLastSubmittedFrame();
 
@@ -288,7 +460,7 @@ namespace Window {
 		{
 			D3D12_DESCRIPTOR_HEAP_DESC desc = {};
 			desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-			desc.NumDescriptors = 1;
+			desc.NumDescriptors = 1 + MAX_TEXTURES;
 			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 			if (g_pd3dDevice->CreateDescriptorHeap(
 					&desc, IID_PPV_ARGS(&g_pd3dSrvDescHeap)) != S_OK) {
@@ -0,0 +1,153 @@
+#include "batch_window.hpp"
+
+#include <fmt/format.h>
+#include <imgui.h>
+#include <imgui_stdlib.h>
+
+#include <utility>
+
+#include "ffmpeg/profile.hpp"
+#include "imgui_extras.hpp"
+#include "util.hpp"
+
+BatchWindow::~BatchWindow() {
+	cancel = true;
+	if (worker.joinable()) { worker.join(); }
+}
+
+void BatchWindow::suggestGraph(const std::filesystem::path& path) {
+	if (graph.empty()) { graph = path.string(); }
+}
+
+void BatchWindow::start() {
+	if (worker.joinable()) { worker.join(); }
+
+	{
+		std::lock_guard lock(mutex);
+		results.clear();
+		total = 0;
+	}
+	auto files = expandInputs(inputs);
+	if (files.empty()) { return; }
+
+	cancel = false;
+	running = true;
+	BatchOptions opts{graph, std::nullopt, static_cast<unsigned>(workers)};
+	worker = std::thread([this, opts, files = std::move(files),
+						  pattern = output]() {
+		// Probing each file to skip what isn't media takes a while too
+		auto jobs = batchJobs(profile->runner, files, pattern)
+						.value_or(std::vector<BatchJob>{});
+		{
+			std::lock_guard lock(mutex);
+			total = jobs.size();
+		}
+		(void)runBatch(
+			*profile, opts, std::move(jobs),
+			[this](const BatchResult& r) {
+				std::lock_guard lock(mutex);
+				results.push_back(r);
+			},
+			&cancel);
+		running = false;
+	});
+}
+
+void BatchWindow::drawResults() {
+	using namespace ImGui;
+	std::lock_guard lock(mutex);
+	if (total == 0) { return; }
+
+	ProgressBar(
+		float(results.size()) / float(total), ImVec2(-1, 0),
+		fmt::format("{} / {}", results.size(), total).c_str());
+
+	if (!BeginTable(
+			"results", 4,
+			ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable |
+				ImGuiTableFlags_ScrollY)) {
+		return;
+	}
+	TableSetupColumn("Status");
+	TableSetupColumn("Time");
+	TableSetupColumn("Input");
+	TableSetupColumn("Output");
+	TableHeadersRow();
+	for (const auto& r : results) {
+		const auto ok = r.error.code == FilterGraphErrorCode::PLAYER_NO_ERROR;
+		TableNextRow();
+		TableNextColumn();
+		TextUnformatted(ok ? "ok" : "failed");
+		if (!ok) { SetItemTooltip("%s", r.error.message.c_str()); }
+		TableNextColumn();
+		Text(fmt::format("{:.2f}s", r.seconds));
+		TableNextColumn();
+		Text(r.job.input.string());
+		TableNextColumn();
+		Text(r.job.output.string());
+	}
+	EndTable();
+}
+
+void BatchWindow::draw() {
+	if (!isOpen) { return; }
+	using namespace ImGui;
+	if (Begin("Batch", &isOpen)) {
+		const auto width = GetContentRegionAvail().x * 0.7f;
+		BeginDisabled(running);
+		{
+			BeginHorizontal(&graph);
+			TextUnformatted("Graph");
+			Spring();
+			InputFile("##graph", graph, width);
+			EndHorizontal();
+		}
+		{
+			BeginHorizontal(&inputs);
+			TextUnformatted("Inputs");
+			if (BeginItemTooltip()) {
+				TextUnformatted("a directory or a pattern like clips/*.mov");
+				EndTooltip();
+			}
+			Spring();
+			SetNextItemWidth(width);
+			InputText("##inputs", &inputs);
+			EndHorizontal();
+		}
+		{
+			BeginHorizontal(&output);
+			TextUnformatted("Output");
+			if (BeginItemTooltip()) {
+				TextUnformatted(
+					"template using {dir}, {stem}, {name}, {ext} and {index}");
+				EndTooltip();
+			}
+			Spring();
+			SetNextItemWidth(width);
+			InputText("##output", &output);
+			EndHorizontal();
+		}
+		{
+			BeginHorizontal(&workers);
+			TextUnformatted("Parallel Files");
+			if (BeginItemTooltip()) {
+				TextUnformatted("0 picks from the number of cores");
+				EndTooltip();
+			}
+			Spring();
+			SetNextItemWidth(width);
+			DragInt("##workers", &workers, 0.1f, 0, 256);
+			EndHorizontal();
+		}
+		EndDisabled();
+
+		if (running) {
+			if (Button("Cancel")) { cancel = true; }
+		} else if (Button("Start")) {
+			start();
+		}
+
+		drawResults();
+	}
+	End();
+}
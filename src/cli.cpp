@@ -0,0 +1,357 @@
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ffmpeg/batch.hpp"
+#include "ffmpeg/benchmark.hpp"
+#include "ffmpeg/filter_graph.hpp"
+#include "ffmpeg/preview_encoding.hpp"
+#include "ffmpeg/profile.hpp"
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace {
+	enum ExitCode {
+		ExitSuccess = 0,
+		ExitUsage,
+		ExitLoad,
+		ExitGraph,
+		ExitRender,
+	};
+
+	constexpr auto USAGE = R"(usage: {} <graph.json> [options]
+
+Renders a graph saved by ffmpeg_node_editor
+
+options:
+  -o <path>        output file, defaults to the filename of the output node
+                   the rendered node is linked to
+  -n <id>          node to render till, needed if the graph has many ends
+  -i <id>=<path>   replace the file of input node id, can be repeated
+  -s <count>       segments rendered in parallel, 0 picks from cores
+                   (default 1)
+  -B <count>       benchmark the node instead of rendering, running it count
+                   times into a null sink after a warm up run. Results are
+                   added to the history of the graph fingerprint
+  -E <count>       time the preview encodings on the node instead of
+                   rendering, printing the median seconds to the first
+                   frame of count runs each
+  -t <seconds>     stop ffmpeg jobs running longer than this. Jobs without
+                   a new frame for 60 seconds are always stopped
+  -w <addresses>   run ffmpeg on ffmpeg_node_editor_worker daemons, comma
+                   separated, eg unix:/tmp/w1.sock,localhost:7000. Files
+                   must be at the same paths for the workers
+
+batch options:
+  -b <pattern>     render once per file matching pattern, a directory or a
+                   path ending in a * and ? pattern. Every input node reads
+                   the file and -o becomes a template using {{dir}}, {{stem}},
+                   {{name}}, {{ext}} and {{index}}. Can't be used with -i
+  -j <count>       files rendered at once, 0 picks from cores (default 0)
+)";
+
+	struct Options {
+		std::filesystem::path graph;
+		std::filesystem::path output;
+		std::optional<int> node;
+		std::map<int, std::string> inputs;
+		unsigned segments = 1;
+		std::filesystem::path batch;
+		unsigned workers = 0;
+		std::string remote;
+		unsigned repetitions = 0;  // benchmark if set
+		unsigned encodingRuns = 0;	// compare preview encodings if set
+		double timeout = 0;
+	};
+
+	bool parseArgs(int argc, char** argv, Options& opts) {
+		for (auto i = 1; i < argc; ++i) {
+			const std::string_view arg = argv[i];
+			if (arg.size() != 2 || arg[0] != '-') {
+				if (!opts.graph.empty()) { return false; }
+				opts.graph = arg;
+				continue;
+			}
+			if (i + 1 == argc) { return false; }
+			const std::string_view value = argv[++i];
+			switch (arg[1]) {
+				case 'o':
+					opts.output = value;
+					break;
+				case 'n': {
+					int id = 0;
+					if (!str::stoi(value, id)) { return false; }
+					opts.node = id;
+					break;
+				}
+				case 'i': {
+					auto eq = value.find('=');
+					int id = 0;
+					if (eq == std::string_view::npos ||
+						!str::stoi(value.substr(0, eq), id)) {
+						return false;
+					}
+					opts.inputs[id] = value.substr(eq + 1);
+					break;
+				}
+				case 's':
+					if (!str::stoi(value, opts.segments)) { return false; }
+					break;
+				case 'b':
+					opts.batch = value;
+					break;
+				case 'j':
+					if (!str::stoi(value, opts.workers)) { return false; }
+					break;
+				case 't':
+					if (!str::stod(value, opts.timeout) || opts.timeout < 0) {
+						return false;
+					}
+					break;
+				case 'w':
+					opts.remote = value;
+					break;
+				case 'E':
+					if (!str::stoi(value, opts.encodingRuns) ||
+						opts.encodingRuns == 0) {
+						return false;
+					}
+					break;
+				case 'B':
+					if (!str::stoi(value, opts.repetitions) ||
+						opts.repetitions == 0) {
+						return false;
+					}
+					break;
+				default:
+					return false;
+			}
+		}
+		return !opts.graph.empty();
+	}
+
+	std::filesystem::path findOutput(const FilterGraph& g, NodeId target) {
+		if (auto file = g.outputFile(target); !file.empty()) { return file; }
+		// An output node linked to nothing stands for the whole graph, if
+		// there is only one
+		std::vector<std::string> files;
+		g.iterateNodes([&](const FilterNode& node, const NodeId& id) {
+			if (node.base().name != OUTPUT_FILTER_NAME) { return; }
+			if (g.renderTarget(id) != INVALID_NODE) { return; }
+			if (auto itr = node.option.find(0); itr != node.option.end()) {
+				files.push_back(itr->second);
+			}
+		});
+		return files.size() == 1 ? files[0] : "";
+	}
+
+	Profile loadProfile(const Options& opts) {
+		JobLimits limits;
+		limits.timeout = opts.timeout;
+		if (opts.remote.empty()) {
+			return GetProfile(std::make_shared<LocalBackend>(), limits);
+		}
+		return GetProfile(std::make_shared<RemoteBackend>(opts.remote), limits);
+	}
+
+	int timeEncodings(
+		const Profile& profile, const Command& cmd, unsigned runs) {
+		std::map<int, std::vector<double>> seconds;
+		std::map<int, std::string> errors;
+		for (auto i = 0U; i < runs; ++i) {
+			for (const auto& t : compareEncodings(profile.runner, cmd)) {
+				if (t.firstFrame < 0) {
+					errors[t.encoding] = t.error;
+				} else {
+					seconds[t.encoding].push_back(t.firstFrame);
+				}
+			}
+		}
+		fmt::print("{:<20} {:>12}\n", "encoding", "first frame");
+		for (auto e = EncodingAuto + 1; e < ENCODING_COUNT; ++e) {
+			const auto* name = encodingProfile(e).name;
+			auto& s = seconds[e];
+			if (s.empty()) {
+				fmt::print(
+					"{:<20} {:>12}  {}\n", name, "failed",
+					str::strip(errors[e]));
+				continue;
+			}
+			std::sort(s.begin(), s.end());
+			fmt::print("{:<20} {:>11.3f}s\n", name, s[s.size() / 2]);
+		}
+		return ExitSuccess;
+	}
+
+	int render(const Options& opts) {
+		const auto profile = loadProfile(opts);
+		FilterGraph g(profile);
+		std::map<int, NodeId> ids;
+		if (!g.load(opts.graph, &ids)) {
+			fmt::print(stderr, "Unable to load {}\n", opts.graph.string());
+			return ExitLoad;
+		}
+
+		for (const auto& [savedId, file] : opts.inputs) {
+			auto itr = ids.find(savedId);
+			if (itr == ids.end() ||
+				g.getNode(itr->second).base().name != INPUT_FILTER_NAME) {
+				fmt::print(stderr, "{} is not an input node\n", savedId);
+				return ExitUsage;
+			}
+			g.getNode(itr->second).option[0] = file;
+			g.optHook(itr->second, 0, file);
+		}
+
+		NodeId target = INVALID_NODE;
+		if (opts.node.has_value()) {
+			auto itr = ids.find(opts.node.value());
+			if (itr == ids.end()) {
+				fmt::print(stderr, "No node with id {}\n", opts.node.value());
+				return ExitUsage;
+			}
+			target = g.renderTarget(itr->second);
+			if (target == INVALID_NODE) {
+				fmt::print(
+					stderr, "Nothing is linked to output node {}\n",
+					opts.node.value());
+				return ExitUsage;
+			}
+		} else if (auto ends = g.ends(); ends.size() == 1) {
+			target = ends[0];
+		} else {
+			std::vector<int> saved;
+			for (const auto& [savedId, id] : ids) {
+				if (contains(ends, id)) { saved.push_back(savedId); }
+			}
+			fmt::print(
+				stderr, "Graph has {} ends ({}), pick one with -n\n",
+				ends.size(), fmt::join(saved, ", "));
+			return ExitUsage;
+		}
+
+		if (opts.encodingRuns > 0) {
+			Command cmd;
+			auto err = g.emit(cmd, target);
+			if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				fmt::print(stderr, "{}\n", err.message);
+				return ExitGraph;
+			}
+			return timeEncodings(profile, cmd, opts.encodingRuns);
+		}
+
+		if (opts.repetitions > 0) {
+			BenchmarkResult result;
+			auto err = g.benchmark(target, opts.repetitions, result);
+			if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				fmt::print(stderr, "{}\n", err.message);
+				return err.code == FilterGraphErrorCode::PLAYER_RUNTIME
+						   ? ExitRender
+						   : ExitGraph;
+			}
+			fmt::print("{}", formatBenchmark(result));
+			return ExitSuccess;
+		}
+
+		auto output = opts.output.empty() ? findOutput(g, target) : opts.output;
+		if (output.empty()) {
+			fmt::print(stderr, "No output given, use -o\n");
+			return ExitUsage;
+		}
+
+		auto err = g.render(output, target, opts.segments);
+		switch (err.code) {
+			case FilterGraphErrorCode::PLAYER_NO_ERROR:
+				return ExitSuccess;
+			case FilterGraphErrorCode::PLAYER_MISSING_INPUT:
+			case FilterGraphErrorCode::PLAYER_UNSUPPORTED:
+				fmt::print(stderr, "{}\n", err.message);
+				return ExitGraph;
+			case FilterGraphErrorCode::PLAYER_RUNTIME:
+				fmt::print(stderr, "ffmpeg error: {}\n", err.message);
+				return ExitRender;
+		}
+		return ExitRender;
+	}
+
+	int batch(const Options& opts) {
+		if (!opts.inputs.empty()) {
+			fmt::print(stderr, "-i can't be used with -b, every input node "
+							   "reads the batch file\n");
+			return ExitUsage;
+		}
+		if (opts.output.empty()) {
+			fmt::print(stderr, "Batch mode needs an output template, use -o\n");
+			return ExitUsage;
+		}
+		const auto files = expandInputs(opts.batch);
+		if (files.empty()) {
+			fmt::print(stderr, "No files match {}\n", opts.batch.string());
+			return ExitUsage;
+		}
+
+		const auto profile = loadProfile(opts);
+		if (FilterGraph g(profile); !g.load(opts.graph)) {
+			fmt::print(stderr, "Unable to load {}\n", opts.graph.string());
+			return ExitLoad;
+		}
+		const auto jobs =
+			batchJobs(profile.runner, files, opts.output.string());
+		if (!jobs) {
+			fmt::print(stderr, "Bad output template\n");
+			return ExitUsage;
+		}
+		if (jobs->empty()) {
+			fmt::print(stderr, "No media files match {}\n", opts.batch.string());
+			return ExitUsage;
+		}
+
+		auto failed = 0;
+		const auto results = runBatch(
+			profile, {opts.graph, opts.node, opts.workers}, *jobs,
+			[&](const BatchResult& r) {
+				const auto ok =
+					r.error.code == FilterGraphErrorCode::PLAYER_NO_ERROR;
+				if (!ok) { failed++; }
+				fmt::print(
+					"{:<6} {:>8.2f}s  {} -> {}\n", ok ? "ok" : "FAILED",
+					r.seconds, r.job.input.string(), r.job.output.string());
+				if (!ok) {
+					fmt::print("       {}\n", str::strip(r.error.message));
+				}
+				std::fflush(stdout);
+			});
+		fmt::print("{} of {} files failed\n", failed, results.size());
+		return failed == 0 ? ExitSuccess : ExitRender;
+	}
+}  // namespace
+
+int main(int argc, char** argv) {
+	spdlog::set_level(spdlog::level::warn);
+#if !defined(APP_OS_WINDOWS)
+	// Writes to the pipes of finished ffmpeg runs fail instead
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+	Options opts;
+	if (!parseArgs(argc, argv, opts)) {
+		fmt::print(stderr, USAGE, argv[0]);
+		return ExitUsage;
+	}
+	try {
+		return opts.batch.empty() ? render(opts) : batch(opts);
+	} catch (std::exception& e) {
+		fmt::print(stderr, "{}\n", e.what());
+		return ExitRender;
+	}
+}
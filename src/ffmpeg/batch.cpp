@@ -0,0 +1,158 @@
+#include "ffmpeg/batch.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "ffmpeg/profile.hpp"
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	FilterGraphError jobError(std::string message) {
+		return {FilterGraphErrorCode::PLAYER_RUNTIME, std::move(message)};
+	}
+
+	FilterGraphError runJob(
+		const Profile& profile, const BatchOptions& opts, const BatchJob& job,
+		const std::atomic_bool* cancel) {
+		FilterGraph g(profile);
+		std::map<int, NodeId> ids;
+		if (!g.load(opts.graph, &ids)) {
+			return jobError(
+				fmt::format("Unable to load {}", opts.graph.string()));
+		}
+
+		const auto input = job.input.string();
+		std::vector<NodeId> inputs;
+		g.iterateNodes([&](const FilterNode& node, const NodeId& id) {
+			if (node.base().name == INPUT_FILTER_NAME) { inputs.push_back(id); }
+		});
+		for (const auto& id : inputs) {
+			g.getNode(id).option[0] = input;
+			g.optHook(id, 0, input);
+		}
+
+		NodeId target = INVALID_NODE;
+		if (opts.node.has_value()) {
+			if (auto itr = ids.find(opts.node.value()); itr != ids.end()) {
+				target = g.renderTarget(itr->second);
+			}
+		} else if (auto ends = g.ends(); ends.size() == 1) {
+			target = ends[0];
+		}
+		if (target == INVALID_NODE) {
+			return jobError("Unable to pick the node to render");
+		}
+
+		std::error_code err;
+		fs::create_directories(job.output.parent_path(), err);
+		return g.render(job.output, target, 1, cancel);
+	}
+}  // namespace
+
+std::vector<fs::path> expandInputs(const fs::path& pattern) {
+	std::vector<fs::path> result;
+	std::error_code err;
+	auto dir = pattern, name = fs::path("*");
+	if (!fs::is_directory(pattern, err)) {
+		dir = pattern.parent_path();
+		name = pattern.filename();
+		if (dir.empty()) { dir = "."; }
+	}
+	for (const auto& file : fs::directory_iterator(dir, err)) {
+		if (!file.is_regular_file(err)) { continue; }
+		if (str::wildcard(name.string(), file.path().filename().string())) {
+			result.push_back(file.path());
+		}
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+fs::path batchOutput(
+	const std::string& pattern, const fs::path& input, size_t index) {
+	try {
+		return fmt::format(
+			fmt::runtime(pattern),
+			fmt::arg("dir", input.parent_path().string()),
+			fmt::arg("stem", input.stem().string()),
+			fmt::arg("name", input.filename().string()),
+			fmt::arg("ext", input.extension().string()),
+			fmt::arg("index", index));
+	} catch (fmt::format_error& e) {
+		SPDLOG_ERROR("bad output template {}: {}", pattern, e.what());
+		return {};
+	}
+}
+
+std::optional<std::vector<BatchJob>> batchJobs(
+	const Runner& runner, const std::vector<fs::path>& files,
+	const std::string& pattern) {
+	std::vector<BatchJob> jobs;
+	for (const auto& file : files) {
+		const auto info = runner.getInfo(file);
+		if (info.streams.empty()) {
+			SPDLOG_INFO("skipping {}, it isn't media", file.string());
+			continue;
+		}
+		auto output = batchOutput(pattern, file, jobs.size());
+		if (output.empty()) { return std::nullopt; }
+		jobs.push_back({file, std::move(output), info.duration});
+	}
+	return jobs;
+}
+
+std::vector<BatchResult> runBatch(
+	const Profile& profile, const BatchOptions& opts,
+	std::vector<BatchJob> jobs, const BatchCallback& onDone,
+	const std::atomic_bool* cancel) {
+	// Setting the input files would queue a proxy of every one
+	auto jobProfile = profile;
+	jobProfile.proxies = nullptr;
+	for (auto& job : jobs) {
+		if (job.duration <= 0) {
+			job.duration = profile.runner.getInfo(job.input).duration;
+		}
+	}
+	std::stable_sort(
+		jobs.begin(), jobs.end(),
+		[](const auto& a, const auto& b) { return a.duration > b.duration; });
+
+	// ffmpeg is multithreaded itself, a process per core only thrashes
+	auto workers = opts.workers;
+	if (workers == 0) {
+		workers = std::max(1U, std::thread::hardware_concurrency() / 2);
+	}
+	workers = std::min<unsigned>(workers, jobs.size());
+
+	std::vector<BatchResult> results;
+	std::mutex mutex;
+	std::atomic_size_t next = 0;
+	auto work = [&]() {
+		using clock = std::chrono::steady_clock;
+		for (auto i = next++; i < jobs.size(); i = next++) {
+			if (cancel != nullptr && cancel->load()) { return; }
+			const auto start = clock::now();
+			BatchResult result{
+				jobs[i], runJob(jobProfile, opts, jobs[i], cancel)};
+			result.seconds =
+				std::chrono::duration<double>(clock::now() - start).count();
+
+			std::lock_guard lock(mutex);
+			if (onDone) { onDone(result); }
+			results.push_back(std::move(result));
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (auto i = 0U; i < workers; ++i) { pool.emplace_back(work); }
+	for (auto& t : pool) { t.join(); }
+	return results;
+}
@@ -0,0 +1,43 @@
+#include "ffmpeg/batch.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "ffmpeg/runner.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(Batch, output_template) {
+	EXPECT_EQ(
+		batchOutput("{dir}/out/{stem}_{index}.mkv", "clips/a.mov", 3),
+		fs::path("clips/out/a_3.mkv"));
+	EXPECT_EQ(
+		batchOutput("{name}{ext}", "clips/a.mov", 0), fs::path("a.mov.mov"));
+	EXPECT_EQ(batchOutput("{unknown}.mkv", "a.mov", 0), fs::path());
+}
+
+TEST(Batch, expand_inputs) {
+	const auto dir = fs::temp_directory_path() / "ffmpeg_node_editor_batch";
+	fs::remove_all(dir);
+	fs::create_directories(dir / "sub");
+	for (const auto* name : {"b.mov", "a.mov", "c.mkv"}) {
+		std::ofstream(dir / name) << "x";
+	}
+
+	EXPECT_EQ(
+		expandInputs(dir / "*.mov"),
+		(std::vector<fs::path>{dir / "a.mov", dir / "b.mov"}));
+	EXPECT_EQ(expandInputs(dir).size(), 3);
+	EXPECT_TRUE(expandInputs(dir / "*.mp4").empty());
+	fs::remove_all(dir);
+}
+
+TEST(Batch, skips_files_that_are_not_media) {
+	const auto file = fs::temp_directory_path() / "ffmpeg_node_editor_empty";
+	std::ofstream{file};
+	const auto jobs = batchJobs(Runner(), {file}, "{stem}.mkv");
+	ASSERT_TRUE(jobs.has_value());
+	EXPECT_TRUE(jobs->empty());
+	fs::remove(file);
+}
@@ -0,0 +1,175 @@
+#include "ffmpeg/benchmark.hpp"
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+
+#include "string_utils.hpp"
+#include "util.hpp"
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	BenchmarkRun, wall, utime, stime, maxRss, fps);
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	BenchmarkStats, mean, median, p95, stddev);
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	BenchmarkResult, date, ffmpeg, runs, wall, utime, stime, maxRss, fps);
+
+namespace fs = std::filesystem;
+
+namespace {
+	fs::path historyFile(const fs::path& dir, std::uint64_t fingerprint) {
+		return dir / fmt::format("{:016x}.json", fingerprint);
+	}
+
+	// Number after key in "... key=1.23s ...", units are ignored
+	bool readValue(std::string_view line, std::string_view key, double& v) {
+		auto idx = line.find(key);
+		if (idx == std::string_view::npos) { return false; }
+		line.remove_prefix(idx + key.size());
+		auto end = line.find_first_not_of("0123456789.");
+		return str::stod(line.substr(0, end), v);
+	}
+
+	std::string ffmpegVersion(const Runner& runner) {
+		std::string version;
+		(void)runner.lineScanner({"-version"}, [&](std::string_view line) {
+			version = line;
+			return false;
+		});
+		return version;
+	}
+}  // namespace
+
+BenchmarkStats summarize(std::vector<double> values) {
+	BenchmarkStats stats;
+	if (values.empty()) { return stats; }
+	std::sort(values.begin(), values.end());
+
+	const auto n = values.size();
+	stats.mean = std::accumulate(values.begin(), values.end(), 0.0) /
+				 static_cast<double>(n);
+	stats.median = n % 2 == 1 ? values[n / 2]
+							  : (values[n / 2 - 1] + values[n / 2]) / 2;
+	// Nearest rank
+	const auto rank =
+		static_cast<size_t>(std::ceil(0.95 * static_cast<double>(n)));
+	stats.p95 = values[std::max<size_t>(rank, 1) - 1];
+	if (n > 1) {
+		double sum = 0;
+		for (const auto& v : values) {
+			sum += (v - stats.mean) * (v - stats.mean);
+		}
+		stats.stddev = std::sqrt(sum / static_cast<double>(n - 1));
+	}
+	return stats;
+}
+
+BenchmarkRun parseBenchmark(std::string_view log) {
+	BenchmarkRun run;
+	for (auto line : str::split(log, '\n')) {
+		line = str::strip(line);
+		if (str::starts_with(line, "bench:")) {
+			(void)readValue(line, "utime=", run.utime);
+			(void)readValue(line, "stime=", run.stime);
+			(void)readValue(line, "maxrss=", run.maxRss);
+		} else if (str::starts_with(line, "fps=")) {
+			(void)readValue(line, "fps=", run.fps);
+		}
+	}
+	return run;
+}
+
+std::pair<int, std::string> runBenchmark(
+	const Runner& runner, Command cmd, unsigned repetitions,
+	BenchmarkResult& result, double duration,
+	const std::atomic_bool* cancel) {
+	using clock = std::chrono::steady_clock;
+
+	// bench: lines are logged at info level, progress goes to stderr too
+	// so a single pipe carries everything
+	cmd.encoder = {"-benchmark", "-nostats", "-progress", "pipe:2",
+				   "-v",		 "info",	 "-f",		  "null"};
+	if (duration > 0) {
+		cmd.encoder.insert(
+			cmd.encoder.begin(), {"-t", fmt::format("{}", duration)});
+	}
+
+	result = {};
+	result.date = fmt::format(
+		"{:%FT%TZ}", std::chrono::time_point_cast<std::chrono::seconds>(
+						 std::chrono::system_clock::now()));
+	result.ffmpeg = ffmpegVersion(runner);
+
+	// The warm up run fills the file cache and isn't counted
+	for (auto i = 0U; i <= repetitions; ++i) {
+		const auto start = clock::now();
+		auto [status, log] = runner.encode(cmd, "-", cancel);
+		if (status != 0) { return {status, log}; }
+		if (i == 0) { continue; }
+		auto run = parseBenchmark(log);
+		run.wall = std::chrono::duration<double>(clock::now() - start).count();
+		SPDLOG_INFO(
+			"run {}: {:.3f}s, {:.1f} fps, {:.0f} KiB", i, run.wall, run.fps,
+			run.maxRss);
+		result.runs.push_back(run);
+	}
+
+	auto measure = [&](double BenchmarkRun::*field) {
+		std::vector<double> values;
+		for (const auto& r : result.runs) { values.push_back(r.*field); }
+		return summarize(std::move(values));
+	};
+	result.wall = measure(&BenchmarkRun::wall);
+	result.utime = measure(&BenchmarkRun::utime);
+	result.stime = measure(&BenchmarkRun::stime);
+	result.maxRss = measure(&BenchmarkRun::maxRss);
+	result.fps = measure(&BenchmarkRun::fps);
+	return {0, ""};
+}
+
+std::vector<BenchmarkResult> loadBenchmarks(
+	const fs::path& dir, std::uint64_t fingerprint) {
+	try {
+		auto json = nlohmann::json::parse(
+			std::ifstream(historyFile(dir, fingerprint)));
+		return json.template get<std::vector<BenchmarkResult>>();
+	} catch (nlohmann::json::exception&) { return {}; }
+}
+
+bool saveBenchmark(
+	const fs::path& dir, std::uint64_t fingerprint,
+	const BenchmarkResult& result) {
+	auto history = loadBenchmarks(dir, fingerprint);
+	history.push_back(result);
+
+	std::error_code err;
+	fs::create_directories(dir, err);
+	std::ofstream o(historyFile(dir, fingerprint), std::ios_base::binary);
+	o << std::setw(4) << nlohmann::json(history);
+	return o.good();
+}
+
+std::string formatBenchmark(const BenchmarkResult& result) {
+	auto text = fmt::format(
+		"{} runs, {}\n{:<10}{:>12}{:>12}{:>12}{:>12}\n", result.runs.size(),
+		result.ffmpeg, "", "mean", "median", "p95", "stddev");
+	auto row = [&](std::string_view name, const BenchmarkStats& s) {
+		text += fmt::format(
+			"{:<10}{:>12.3f}{:>12.3f}{:>12.3f}{:>12.3f}\n", name, s.mean,
+			s.median, s.p95, s.stddev);
+	};
+	row("wall s", result.wall);
+	row("user s", result.utime);
+	row("system s", result.stime);
+	row("rss KiB", result.maxRss);
+	row("fps", result.fps);
+	return text;
+}
@@ -0,0 +1,51 @@
+#include "ffmpeg/benchmark.hpp"
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+TEST(Benchmark, summarize) {
+	auto s = summarize({4, 1, 3, 2});
+	EXPECT_DOUBLE_EQ(s.mean, 2.5);
+	EXPECT_DOUBLE_EQ(s.median, 2.5);
+	EXPECT_DOUBLE_EQ(s.p95, 4);
+	EXPECT_NEAR(s.stddev, 1.291, 0.001);
+
+	s = summarize({7});
+	EXPECT_DOUBLE_EQ(s.median, 7);
+	EXPECT_DOUBLE_EQ(s.p95, 7);
+	EXPECT_DOUBLE_EQ(s.stddev, 0);
+
+	EXPECT_DOUBLE_EQ(summarize({}).mean, 0);
+}
+
+TEST(Benchmark, parse) {
+	auto run = parseBenchmark(
+		"Input #0, lavfi, from 'testsrc':\n"
+		"frame=10\nfps=0.00\nprogress=continue\n"
+		"frame=250\nfps=241.5\nprogress=end\n"
+		"bench: utime=1.250s stime=0.125s rtime=1.035s\n"
+		"bench: maxrss=52344KiB\n");
+	EXPECT_DOUBLE_EQ(run.utime, 1.25);
+	EXPECT_DOUBLE_EQ(run.stime, 0.125);
+	EXPECT_DOUBLE_EQ(run.maxRss, 52344);
+	EXPECT_DOUBLE_EQ(run.fps, 241.5);
+}
+
+TEST(Benchmark, history) {
+	const auto dir = fs::temp_directory_path() / "ffmpeg_node_editor_bench";
+	fs::remove_all(dir);
+
+	BenchmarkResult result;
+	result.runs = {{1, 0.5, 0.1, 100, 30}};
+	result.wall = summarize({1});
+	EXPECT_TRUE(saveBenchmark(dir, 42, result));
+	EXPECT_TRUE(saveBenchmark(dir, 42, result));
+
+	auto history = loadBenchmarks(dir, 42);
+	ASSERT_EQ(history.size(), 2);
+	EXPECT_DOUBLE_EQ(history[1].runs[0].fps, 30);
+	EXPECT_DOUBLE_EQ(history[1].wall.mean, 1);
+	EXPECT_TRUE(loadBenchmarks(dir, 7).empty());
+	fs::remove_all(dir);
+}
@@ -1,20 +1,40 @@
 #include "ffmpeg/filter_graph.hpp"
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 #include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <nlohmann/json.hpp>
 #include <optional>
+#include <thread>
 #include <vector>
 
+#include "ffmpeg/benchmark.hpp"
 #include "ffmpeg/filter.hpp"
 #include "ffmpeg/filter_node.hpp"
+#include "ffmpeg/preview_encoding.hpp"
 #include "ffmpeg/profile.hpp"
+#include "ffmpeg/proxy_cache.hpp"
+#include "ffmpeg/render_cache.hpp"
 #include "ffmpeg/runner.hpp"
-#include "node_editor.hpp"
+#include "ffmpeg/thread_tuner.hpp"
+#include "hash.hpp"
 #include "string_utils.hpp"
 #include "util.hpp"
 
 const int LINK_ID_SHIFT = std::numeric_limits<IdBaseType>::digits / 2;
+// Node ids hold the vertex in their low bits and its generation above,
+// short of the sign bit so adding one never overflows
+const int VERTEX_ID_BITS = 20;
+const int GENERATION_BITS =
+	std::numeric_limits<IdBaseType>::digits - VERTEX_ID_BITS - 1;
+// Link ids pack both vertices, LINK_ID_SHIFT bits each, which bounds the
+// vertex count well below what node ids could name
+static_assert(LINK_ID_SHIFT <= VERTEX_ID_BITS);
+const size_t MAX_VERTICES = size_t(1) << LINK_ID_SHIFT;
+const std::uint16_t MAX_GENERATION = (1U << GENERATION_BITS) - 1;
 
 namespace {
 	LinkId getLinkId(IdBaseType u, IdBaseType v) {
@@ -27,8 +47,18 @@ namespace {
 		u = val >> LINK_ID_SHIFT;
 	}
 
-	NodeId getNodeId(const IdBaseType& u) { return {u + 1}; };
-	IdBaseType getU(const NodeId& id) { return id.val - 1; }
+	NodeId getNodeId(const GraphState& state, IdBaseType u) {
+		return {((IdBaseType(state.generation[u]) << VERTEX_ID_BITS) | u) + 1};
+	};
+	IdBaseType getU(const NodeId& id) {
+		return (id.val - 1) & ((IdBaseType(1) << VERTEX_ID_BITS) - 1);
+	}
+
+	// Whether count more vertices fit in the bits of a node id
+	bool hasRoom(const GraphState& state, size_t count) {
+		return state.freeVertices.size() + MAX_VERTICES - state.valid.size() >=
+			   count;
+	}
 
 	bool getSocket(
 		const GraphState& state, const std::vector<FilterNode>& nodes,
@@ -49,15 +79,29 @@ namespace {
 	IdBaseType addVertex(
 		GraphState& state, size_t nodeIndex, bool isSocket, size_t socketIndex,
 		bool isInput) {
+		state.changed = true;
+		if (!state.freeVertices.empty()) {
+			const auto id = state.freeVertices.back();
+			state.freeVertices.pop_back();
+			state.adjList[id].clear();
+			state.revAdjList[id].clear();
+			state.vertIdToNodeIndex[id] = nodeIndex;
+			state.valid[id] = true;
+			state.isInput[id] = isInput;
+			state.isSocket[id] = isSocket;
+			state.vertIdToSocketIndex[id] = socketIndex;
+			state.generation[id]++;
+			return id;
+		}
 		auto id = state.revAdjList.size();
-		state.adjList.emplace_back(0);
-		state.revAdjList.emplace_back(0);
+		state.adjList.emplace_back();
+		state.revAdjList.emplace_back();
 		state.vertIdToNodeIndex.emplace_back(nodeIndex);
 		state.valid.emplace_back(true);
 		state.isInput.emplace_back(isInput);
 		state.isSocket.emplace_back(isSocket);
 		state.vertIdToSocketIndex.emplace_back(socketIndex);
-		state.changed = true;
+		state.generation.emplace_back(state.firstGeneration);
 		return id;
 	}
 
@@ -95,14 +139,23 @@ namespace {
 	}
 
 	void deleteVertex(GraphState& state, IdBaseType u) {
+		if (!state.valid[u]) { return; }
+		// Copies, deleting edges shortens the lists being walked
+		const auto adj = state.adjList[u];
+		const auto revAdj = state.revAdjList[u];
 		if (state.isSocket[u]) {
-			for (auto& v : state.adjList[u]) { deleteEdge(state, u, v); }
-			for (auto& v : state.revAdjList[u]) { deleteEdge(state, v, u); }
+			for (auto v : adj) { deleteEdge(state, u, v); }
+			for (auto v : revAdj) { deleteEdge(state, v, u); }
 		} else {
-			for (auto& v : state.adjList[u]) { deleteVertex(state, v); }
-			for (auto& v : state.revAdjList[u]) { deleteVertex(state, v); }
+			for (auto v : adj) { deleteVertex(state, v); }
+			for (auto v : revAdj) { deleteVertex(state, v); }
 		}
 		state.valid[u] = false;
+		// Out of generations, reusing it would bring back ids handed out
+		// before. It stays unused till compact.
+		if (state.generation[u] < MAX_GENERATION) {
+			state.freeVertices.push_back(u);
+		}
 		state.changed = true;
 	}
 	std::vector<Socket> getSockets(const Runner& r, const std::string& path) {
@@ -148,7 +201,7 @@ namespace {
 				} else {
 					addEdge(state, nodeVertexId, sVertexId);
 				}
-				newIds.push_back(getNodeId(sVertexId));
+				newIds.push_back(getNodeId(state, sVertexId));
 			}
 			if (deleteOldSocket) { deleteVertex(state, getU(oldIds[i])); }
 		}
@@ -156,18 +209,34 @@ namespace {
 		state.changed = true;
 	}
 
+	// Vertices on the path being walked, with the next of their edges to
+	// follow. Kept on the heap, a long chain would overflow the thread's
+	// stack.
+	using DfsStack = std::vector<std::pair<IdBaseType, size_t>>;
+
+	// Calls cb for the nodes above v and then v, each once
 	void dfs(
-		const GraphState& state, std::vector<bool>& marked,
+		const GraphState& state, std::vector<bool>& marked, DfsStack& stack,
 		const std::vector<FilterNode>& nodes, IdBaseType v,
 		const NodeIterCallback& cb) {
 		marked[v] = true;
 		if (!state.valid[v]) { return; }
-		for (const auto& u : state.revAdjList[v]) {
-			if (marked[u]) { continue; }
-			dfs(state, marked, nodes, u, cb);
+		stack.emplace_back(v, 0);
+		while (!stack.empty()) {
+			auto [w, next] = stack.back();
+			const auto& adj = state.revAdjList[w];
+			if (next < adj.size()) {
+				stack.back().second++;
+				const auto u = adj[next];
+				if (marked[u]) { continue; }
+				marked[u] = true;
+				if (state.valid[u]) { stack.emplace_back(u, 0); }
+				continue;
+			}
+			stack.pop_back();
+			if (state.isSocket[w]) { continue; }
+			cb(nodes[state.vertIdToNodeIndex[w]], getNodeId(state, w));
 		}
-		if (state.isSocket[v]) { return; }
-		cb(nodes[state.vertIdToNodeIndex[v]], getNodeId(v));
 	}
 
 	std::vector<Socket> getNewSockets(unsigned int count, SocketType type) {
@@ -187,10 +256,222 @@ namespace {
 		}
 		return -1;
 	}
+
+	// Filters known to work on each frame alone. Anything else may depend on
+	// neighbouring frames, frame numbers or the position in the stream, so
+	// cutting the input could change the result.
+	bool isPerFrameFilter(std::string_view name) {
+		static const std::set<std::string_view> PER_FRAME{
+			INPUT_FILTER_NAME, OUTPUT_FILTER_NAME, "aformat", "amerge",
+			"anull", "asplit", "avgblur", "boxblur", "channelmap",
+			"channelsplit", "chromakey", "colorbalance", "colorchannelmixer",
+			"colorkey", "colorlevels", "colorspace", "convolution", "crop",
+			"curves", "delogo", "despill", "drawbox", "drawgrid", "drawtext",
+			"edgedetect", "eq", "format", "gblur", "hflip", "hstack", "hue",
+			"join", "lumakey", "lut", "lut3d", "lutrgb", "lutyuv", "negate",
+			"null", "overlay", "pad", "pan", "rotate", "scale", "setdar",
+			"setparams", "setsar", "split", "transpose", "unsharp", "vflip",
+			"vignette", "volume", "vstack", "xstack", "zscale",
+		};
+		return contains(PER_FRAME, name);
+	}
+
+	// Options holding pixel sizes or coordinates. Plain numbers in these are
+	// scaled along with the inputs during preview, expressions are left as
+	// they are since they are mostly relative to the frame size already.
+	bool isPixelOption(std::string_view filter, std::string_view option) {
+		static const std::map<std::string_view, std::set<std::string_view>>
+			PIXEL_OPTIONS{
+				{"crop", {"out_w", "w", "out_h", "h", "x", "y"}},
+				{"delogo", {"x", "y", "w", "h"}},
+				{"drawbox",
+				 {"x", "y", "width", "w", "height", "h", "thickness", "t"}},
+				{"drawgrid",
+				 {"x", "y", "width", "w", "height", "h", "thickness", "t"}},
+				{"drawtext",
+				 {"x", "y", "fontsize", "borderw", "boxborderw", "shadowx",
+				  "shadowy", "line_spacing"}},
+				{"overlay", {"x", "y"}},
+				{"pad", {"width", "w", "height", "h", "x", "y"}},
+				{"scale", {"w", "width", "h", "height"}},
+			};
+		auto itr = PIXEL_OPTIONS.find(filter);
+		return itr != PIXEL_OPTIONS.end() && contains(itr->second, option);
+	}
+
+	bool scaleNumber(
+		std::string_view text, double scale, int multiple, std::string& dest) {
+		double value = 0;
+		if (!str::stod(str::strip(text), value)) { return false; }
+		// Negative sizes mean keep the aspect ratio or fill, eg scale=-2:720
+		if (value < 0) { return false; }
+		auto scaled = multiple * std::lround(value * scale / multiple);
+		// Keep thin borders and small offsets from vanishing
+		if (value != 0 && scaled == 0) { scaled = multiple; }
+		dest += std::to_string(scaled);
+		return true;
+	}
+
+	std::string scaleOptionValue(
+		std::string_view filter, const Option& option,
+		const std::string& value, double scale) {
+		if (scale == 1) { return value; }
+		std::string result;
+		if (isPixelOption(filter, option.name) &&
+			scaleNumber(value, scale, 1, result)) {
+			return result;
+		}
+		// Sizes of generated sources, eg testsrc=size=1920x1080
+		if (option.type == "image_size") {
+			auto parts = str::split(value, 'x');
+			if (parts.size() == 2 && scaleNumber(parts[0], scale, 2, result)) {
+				result += 'x';
+				if (scaleNumber(parts[1], scale, 2, result)) { return result; }
+			}
+		}
+		return value;
+	}
+
+	// Filters inserted right after a video input for preview
+	std::string previewChain(double scale, double maxFps, double fps) {
+		std::vector<std::string> filters;
+		if (scale < 1) {
+			filters.push_back(fmt::format(
+				"scale=w=trunc(iw*{0}/2)*2:h=trunc(ih*{0}/2)*2:flags=fast_"
+				"bilinear",
+				scale));
+		}
+		if (maxFps > 0 && fps > maxFps) {
+			filters.push_back(fmt::format("fps={}", maxFps));
+		}
+		return fmt::format("{}", fmt::join(filters, ","));
+	}
+
+	// Fits a video output into a thumbnail, letterboxed
+	std::string thumbnailChain() {
+		return fmt::format(
+			"scale={0}:{1}:force_original_aspect_ratio=decrease,"
+			"pad={0}:{1}:-1:-1,setsar=1,format=rgba",
+			ThumbnailCache::WIDTH, ThumbnailCache::HEIGHT);
+	}
+
+	// Size of a tile in the mosaic of nodes played together
+	constexpr int TILE_WIDTH = 640;
+	constexpr int TILE_HEIGHT = 360;
+
+	std::string tileChain() {
+		return fmt::format(
+			"scale={0}:{1}:force_original_aspect_ratio=decrease,"
+			"pad={0}:{1}:-1:-1,setsar=1,format=yuv420p",
+			TILE_WIDTH, TILE_HEIGHT);
+	}
+
+	// xstack of count tiles in a grid about as wide as high, gaps black
+	std::string mosaicFilter(size_t count) {
+		const auto columns =
+			static_cast<size_t>(std::ceil(std::sqrt(double(count))));
+		std::vector<std::string> layout;
+		for (size_t i = 0; i < count; ++i) {
+			layout.push_back(fmt::format(
+				"{}_{}", i % columns * TILE_WIDTH, i / columns * TILE_HEIGHT));
+		}
+		return fmt::format(
+			"xstack=inputs={}:layout={}:fill=black", count,
+			fmt::join(layout, "|"));
+	}
+
+	// Maps the branches of nodes played together in the order asked for.
+	// Videos are stacked if a mosaic is wanted, and then only the first
+	// audio is kept. Whatever isn't mapped goes to a sink.
+	void mapBranches(
+		const PreviewOptions& preview,
+		const std::map<IdBaseType, std::pair<std::string, std::string>>&
+			branches,
+		std::string& filter, std::vector<std::string>& out) {
+		std::vector<std::string> videos, audios, dropped;
+		for (auto u : preview.together) {
+			auto itr = branches.find(u);
+			if (itr == branches.end()) { continue; }
+			const auto& [video, audio] = itr->second;
+			if (!video.empty()) { videos.push_back(video); }
+			if (!audio.empty()) { audios.push_back(audio); }
+		}
+		if (preview.mosaic && videos.size() > 1) {
+			fmt::format_to(
+				std::back_inserter(filter), "{}{}[mosaic];",
+				fmt::join(videos, ""), mosaicFilter(videos.size()));
+			videos = {"[mosaic]"};
+		}
+		if (preview.singleOutput == SocketType::Video) {
+			std::swap(audios, dropped);
+		} else if (preview.mosaic && audios.size() > 1) {
+			dropped.assign(audios.begin() + 1, audios.end());
+			audios.resize(1);
+		}
+		for (const auto& label : dropped) {
+			fmt::format_to(std::back_inserter(filter), "{}anullsink;", label);
+		}
+		out = std::move(videos);
+		out.insert(out.end(), audios.begin(), audios.end());
+	}
+
+	// Smallest number of filters in a subgraph worth caching
+	constexpr auto MIN_CACHED_FILTERS = 2;
+
+	// Picks n - 1 cut points, each at the keyframe nearest to an equal split
+	std::vector<Segment> planSegments(
+		const std::vector<double>& keyframes, double duration, unsigned n) {
+		std::vector<double> cuts;
+		for (auto i = 1U; i < n; ++i) {
+			const auto target = duration * i / n;
+			auto itr =
+				std::lower_bound(keyframes.begin(), keyframes.end(), target);
+			if (itr == keyframes.end()) { break; }
+			if (itr != keyframes.begin() &&
+				target - *std::prev(itr) < *itr - target) {
+				itr = std::prev(itr);
+			}
+			if (*itr <= 0 || *itr >= duration) { continue; }
+			if (!cuts.empty() && *itr <= cuts.back()) { continue; }
+			cuts.push_back(*itr);
+		}
+
+		std::vector<Segment> plan;
+		double start = 0;
+		for (const auto& cut : cuts) {
+			plan.push_back({start, cut - start});
+			start = cut;
+		}
+		plan.push_back({start, 0});
+		return plan;
+	}
+
+	PreviewOptions previewOptions(const Preference& pref) {
+		PreviewOptions preview;
+		switch (pref.previewQuality) {
+			case PreviewHalf:
+				preview.scale = 0.5;
+				break;
+			case PreviewQuarter:
+				preview.scale = 0.25;
+				break;
+			case PreviewCustom:
+				preview.maxHeight = pref.previewHeight;
+				break;
+			default:
+				break;
+		}
+		preview.maxFps = pref.previewFps;
+		preview.useProxies = pref.useProxies;
+		preview.useCache = pref.cacheIntermediates;
+		return preview;
+	}
 }  // namespace
 
 void FilterGraph::optHook(
 	const NodeId& id, const int& optId, const std::string& value) {
+	costs.clear();
+	revision++;
 	auto& node = getNode(id);
 	const auto& base = node.base();
 	const auto& option = base.options[optId];
@@ -245,6 +526,9 @@ void FilterGraph::optHook(
 		 base.name == "amovie") &&
 		option.name == "filename") {
 		newOutputs = getSockets(profile->runner, value);
+		if (base.name == INPUT_FILTER_NAME && profile->proxies) {
+			profile->proxies->request(value);
+		}
 	} else if (base.name == "acrossover" && option.name == "split") {
 		auto count = 1U;
 		char last = '\0';
@@ -278,6 +562,13 @@ void FilterGraph::optHook(
 				newInputs->end(), newOutputs->begin(), newOutputs->end());
 		}
 	}
+	// New sockets are added before the ones they replace are dropped
+	const auto added = (newInputs ? newInputs->size() : 0) +
+					   (newOutputs ? newOutputs->size() : 0);
+	if (!hasRoom(state, added)) {
+		SPDLOG_ERROR("Graph is full, sockets of {} are left as is", node.name);
+		return;
+	}
 	if (newInputs.has_value()) {
 		updateSocketsIds(
 			state, nodeIndex, nodeVertexId, newInputs.value(), node.input(),
@@ -294,24 +585,38 @@ void FilterGraph::optHook(
 }
 
 NodeId FilterGraph::addNode(const Filter& filter) {
+	if (!hasRoom(state, 1 + filter.input.size() + filter.output.size())) {
+		SPDLOG_ERROR("Graph is full, {} can't be added", filter.name);
+		return INVALID_NODE;
+	}
 	auto nodeIndex = nodes.size();
-	nodes.emplace_back(filter);
+	if (freeNodes.empty()) {
+		nodes.emplace_back(filter);
+	} else {
+		nodeIndex = freeNodes.back();
+		freeNodes.pop_back();
+		nodes[nodeIndex] = FilterNode(filter);
+	}
+	auto& node = nodes[nodeIndex];
+	costs.clear();
+	revision++;
 
 	auto nodeVertexId = addVertex(state, nodeIndex, false, 0, false);
+	const auto id = getNodeId(state, nodeVertexId);
 
 	updateSocketsIds(
-		state, nodeIndex, nodeVertexId, filter.input, {},
-		nodes.back().inputSocketIds, true);
+		state, nodeIndex, nodeVertexId, filter.input, {}, node.inputSocketIds,
+		true);
 
 	updateSocketsIds(
 		state, nodeIndex, nodeVertexId, filter.output, {},
-		nodes.back().outputSocketIds, false);
+		node.outputSocketIds, false);
 
 	if (auto i = getOptIndex(filter, filter.name); i != -1) {
-		nodes.back().option[i] = filter.options[i].defaultValue;
-		optHook(getNodeId(nodeVertexId), i, filter.options[i].defaultValue);
+		node.option[i] = filter.options[i].defaultValue;
+		optHook(id, i, filter.options[i].defaultValue);
 	}
-	return getNodeId(nodeVertexId);
+	return id;
 }
 
 LinkId FilterGraph::addLink(NodeId uu, NodeId vv) {
@@ -319,15 +624,26 @@ LinkId FilterGraph::addLink(NodeId uu, NodeId vv) {
 	auto u = getU(uu), v = getU(vv);
 	if (!canAddEdge(state, nodes, u, v)) { return INVALID_LINK; }
 	if (state.isInput[u]) { std::swap(u, v); }
+	costs.clear();
+	revision++;
 	if (addEdge(state, u, v)) { return getLinkId(u, v); }
 	return INVALID_LINK;
 }
 
-void FilterGraph::deleteNode(NodeId id) { deleteVertex(state, getU(id)); };
+void FilterGraph::deleteNode(NodeId id) {
+	if (!valid(id)) { return; }
+	const auto u = getU(id);
+	costs.clear();
+	revision++;
+	if (!state.isSocket[u]) { freeNodes.push_back(state.vertIdToNodeIndex[u]); }
+	deleteVertex(state, u);
+};
 
 void FilterGraph::deleteLink(LinkId id) {
 	IdBaseType u = 0, v = 0;
 	getUV(id, u, v);
+	costs.clear();
+	revision++;
 	deleteEdge(state, u, v);
 }
 
@@ -340,18 +656,62 @@ void FilterGraph::iterateLinks(const EdgeIterCallback& cb) const {
 	for (IdBaseType v = 0; v < state.revAdjList.size(); ++v) {
 		for (const auto& u : state.revAdjList[v]) {
 			if (state.isSocket[u] && state.isSocket[v]) {
-				cb(getLinkId(u, v), getNodeId(u), getNodeId(v));
+				cb(getLinkId(u, v), getNodeId(state, u), getNodeId(state, v));
 			}
 		}
 	}
 }
 
+std::vector<NodeId> FilterGraph::ends() const {
+	std::set<IdBaseType> linked;
+	iterateLinks([&](const LinkId&, const NodeId& u, const NodeId& v) {
+		if (getNode(v).base().name != OUTPUT_FILTER_NAME) {
+			linked.insert(u.val);
+		}
+	});
+	std::vector<NodeId> result;
+	iterateNodes([&](const FilterNode& node, const NodeId& id) {
+		if (node.output().empty()) { return; }
+		for (const auto& s : node.outputSocketIds) {
+			if (contains(linked, s.val)) { return; }
+		}
+		result.push_back(id);
+	});
+	return result;
+}
+
+NodeId FilterGraph::renderTarget(const NodeId& id) const {
+	if (!valid(id) || getNode(id).base().name != OUTPUT_FILTER_NAME) {
+		return id;
+	}
+	NodeId source = INVALID_NODE;
+	inputSockets(id, [&](const Socket&, const NodeId&, const NodeId& s) {
+		if (source != INVALID_NODE || s == INVALID_NODE) { return; }
+		source = getNodeId(state, state.revAdjList[getU(s)][0]);
+	});
+	return source;
+}
+
+std::filesystem::path FilterGraph::outputFile(const NodeId& id) const {
+	std::filesystem::path file;
+	iterateNodes([&](const FilterNode& node, const NodeId& u) {
+		if (!file.empty() || node.base().name != OUTPUT_FILTER_NAME ||
+			renderTarget(u) != id) {
+			return;
+		}
+		if (auto itr = node.option.find(0); itr != node.option.end()) {
+			file = itr->second;
+		}
+	});
+	return file;
+}
+
 void FilterGraph::iterateNodes(
 	const NodeIterCallback& cb, NodeIterOrder order, NodeId u) const {
 	if (order == NodeIterOrder::Default) {
 		for (auto i = 0U; i < state.revAdjList.size(); ++i) {
 			if (state.valid[i] && !state.isSocket[i]) {
-				cb(nodes[state.vertIdToNodeIndex[i]], getNodeId(i));
+				cb(nodes[state.vertIdToNodeIndex[i]], getNodeId(state, i));
 			}
 		}
 		return;
@@ -365,8 +725,9 @@ void FilterGraph::iterateNodes(
 
 	// Topological Sort
 	std::vector<bool> marked(state.revAdjList.size(), false);
+	DfsStack stack;
 	for (auto v = b; v < e; ++v) {
-		if (!marked[v]) { dfs(state, marked, nodes, v, cb); }
+		if (!marked[v]) { dfs(state, marked, stack, nodes, v, cb); }
 	}
 }
 
@@ -381,7 +742,7 @@ void FilterGraph::inputSockets(NodeId uu, const InputSocketCallback& cb) const {
 		if (state.revAdjList[v].empty()) {
 			cb(socket, socketId, INVALID_NODE);
 		} else {
-			cb(socket, socketId, getNodeId(state.revAdjList[v][0]));
+			cb(socket, socketId, getNodeId(state, state.revAdjList[v][0]));
 		}
 	}
 }
@@ -397,6 +758,190 @@ void FilterGraph::outputSockets(
 	}
 }
 
+ProxyState FilterGraph::proxyState(const NodeId& id) const {
+	const auto& node = getNode(id);
+	if (!profile->proxies || node.base().name != INPUT_FILTER_NAME ||
+		!contains(node.option, 0)) {
+		return ProxyState::None;
+	}
+	if (proxyKeysRevision != revision) {
+		proxyKeys.clear();
+		proxyKeysRevision = revision;
+	}
+	const auto u = getU(id);
+	auto itr = proxyKeys.find(u);
+	if (itr == proxyKeys.end()) {
+		itr = proxyKeys
+				  .emplace(u, ProxyCache::proxyKey(node.option.at(0)))
+				  .first;
+	}
+	if (!itr->second) { return ProxyState::None; }
+	const auto state = profile->proxies->state(*itr->second);
+	if (state == ProxyState::None) {
+		profile->proxies->request(node.option.at(0), *itr->second);
+	}
+	return state;
+}
+
+namespace nlohmann {
+	template <> struct adl_serializer<NodeId> {
+		static void to_json(nlohmann::json& j, const NodeId& id) { j = id.val; }
+	};
+}  // namespace nlohmann
+
+bool FilterGraph::save(const std::filesystem::path& file) {
+	nlohmann::json obj;
+	obj["nodes"] = nlohmann::json::array();
+	iterateNodes(
+		[&](const FilterNode& node, const NodeId& id) {
+			nlohmann::json elem;
+			elem["id"] = id;
+			elem["name"] = node.name;
+			const auto& options = node.base().options;
+			for (const auto& [optIdx, optValue] : node.option) {
+				nlohmann::json opt;
+				opt["key"] = options[optIdx].name;
+				opt["value"] = optValue;
+				elem["option"].push_back(opt);
+			}
+			elem["inputs"] = node.inputSocketIds;
+			elem["outputs"] = node.outputSocketIds;
+			inputSockets(
+				id, [&](const Socket&, const NodeId& dest, const NodeId& src) {
+					elem["edges"].push_back({{"src", src}, {"dest", dest}});
+				});
+			obj["nodes"].push_back(elem);
+		},
+		NodeIterOrder::Topological);
+	std::ofstream o(file, std::ios_base::binary);
+	resetChanged();
+	o << std::setw(4) << obj;
+	return true;
+}
+
+bool FilterGraph::load(
+	const std::filesystem::path& file, std::map<int, NodeId>* ids) {
+	nlohmann::json json;
+	try {
+		json = nlohmann::json::parse(std::ifstream(file));
+	} catch (nlohmann::json::exception&) { return false; }
+	clear();
+	std::map<int, NodeId> mapping;
+	for (const auto& elem : json["nodes"]) {
+		auto id = elem["id"].template get<int>();
+		auto name = elem["name"].template get<std::string>();
+		const auto& base = std::find_if(
+			allFilters().begin(), allFilters().end(),
+			[&](const Filter& filter) { return filter.name == name; });
+		if (base == allFilters().end()) {
+			SPDLOG_ERROR("Unknown filter {} in {}", name, file.string());
+			return false;
+		}
+		auto nId = addNode(*base);
+		if (nId == INVALID_NODE) { return false; }
+		mapping[id] = nId;
+		if (ids != nullptr) { (*ids)[id] = nId; }
+
+		if (elem.contains("option")) {
+			for (const auto& opt : elem["option"]) {
+				auto name = opt["key"].template get<std::string>();
+				auto value = opt["value"].template get<std::string>();
+				const auto& optionBase = std::find_if(
+					base->options.begin(), base->options.end(),
+					[&](const Option& option) { return option.name == name; });
+
+				auto optId = std::distance(base->options.begin(), optionBase);
+				getNode(nId).option[optId] = value;
+				optHook(nId, optId, value);
+			}
+		}
+
+		{
+			const auto& sockets = getNode(nId).inputSocketIds;
+			const auto& ints = elem["inputs"].template get<std::vector<int>>();
+			const auto limit = std::min(sockets.size(), ints.size());
+			for (auto i = 0u; i < limit; ++i) { mapping[ints[i]] = sockets[i]; }
+		}
+		{
+			const auto& sockets = getNode(nId).outputSocketIds;
+			const auto& ints = elem["outputs"].template get<std::vector<int>>();
+			const auto limit = std::min(sockets.size(), ints.size());
+			for (auto i = 0u; i < limit; ++i) { mapping[ints[i]] = sockets[i]; }
+		}
+		if (elem.find("edges") != elem.end()) {
+			for (const auto& edge : elem["edges"]) {
+				const auto& src = edge["src"].template get<int>();
+				const auto& dest = edge["dest"].template get<int>();
+				addLink(mapping[src], mapping[dest]);
+			}
+		}
+	}
+	resetChanged();
+	return true;
+}
+
+bool FilterGraph::valid(NodeId id) const {
+	if (id == INVALID_NODE) { return false; }
+	const auto u = getU(id);
+	return size_t(u) < state.valid.size() && state.valid[u] &&
+		   getNodeId(state, u) == id;
+}
+
+std::map<int, NodeId> FilterGraph::compact() {
+	// New generations follow every one handed out, so no old id survives.
+	// Once they run out they start over, see compact.
+	auto generation = state.firstGeneration;
+	for (auto g : state.generation) { generation = std::max(generation, g); }
+	GraphState next;
+	next.firstGeneration = generation < MAX_GENERATION ? generation + 1 : 0;
+
+	const auto count = IdBaseType(state.valid.size());
+	std::vector<IdBaseType> vertices(count, -1);
+	std::map<size_t, size_t> nodeIndices;
+	std::vector<FilterNode> kept;
+	for (IdBaseType u = 0; u < count; ++u) {
+		if (!state.valid[u]) { continue; }
+		const auto [itr, added] =
+			nodeIndices.try_emplace(state.vertIdToNodeIndex[u], kept.size());
+		if (added) { kept.push_back(std::move(nodes[itr->first])); }
+		vertices[u] = addVertex(
+			next, itr->second, state.isSocket[u], state.vertIdToSocketIndex[u],
+			state.isInput[u]);
+	}
+
+	std::map<int, NodeId> ids;
+	std::map<IdBaseType, NodeCost> keptCosts;
+	for (IdBaseType u = 0; u < count; ++u) {
+		const auto w = vertices[u];
+		if (w == -1) { continue; }
+		for (auto v : state.adjList[u]) {
+			if (vertices[v] != -1) { next.adjList[w].push_back(vertices[v]); }
+		}
+		for (auto v : state.revAdjList[u]) {
+			if (vertices[v] != -1) {
+				next.revAdjList[w].push_back(vertices[v]);
+			}
+		}
+		ids[getNodeId(state, u).val] = getNodeId(next, w);
+		if (auto itr = costs.find(u); itr != costs.end()) {
+			keptCosts[w] = itr->second;
+		}
+	}
+	for (auto& node : kept) {
+		for (auto& id : node.inputSocketIds) { id = ids.at(id.val); }
+		for (auto& id : node.outputSocketIds) { id = ids.at(id.val); }
+	}
+
+	// The graph itself is the same, saving is no more needed than before
+	next.changed = state.changed;
+	state = std::move(next);
+	nodes = std::move(kept);
+	freeNodes.clear();
+	costs = std::move(keptCosts);
+	revision++;
+	return ids;
+}
+
 const FilterNode& FilterGraph::getNode(NodeId id) const {
 	return nodes[state.vertIdToNodeIndex[getU(id)]];
 }
@@ -405,7 +950,8 @@ FilterNode& FilterGraph::getNode(NodeId id) {
 }
 
 void addNodeToFilterGraph(
-	std::string& buff, const FilterNode& node, const NodeId& id) {
+	std::string& buff, const FilterNode& node, const NodeId& id,
+	double scale = 1) {
 	fmt::format_to(
 		std::back_inserter(buff), "{}@{}{}=", node.name, node.name, id.val);
 
@@ -429,24 +975,174 @@ void addNodeToFilterGraph(
 		} else
 #endif
 		{
-			buff += value;
+			buff += scaleOptionValue(
+				node.base().name, options[id], value, scale);
 		}
 		buff += ':';
 	}
 	buff.pop_back();
 }
 
-FilterGraphError FilterGraph::play(const Preference& pref, const NodeId& id) {
+FilterGraphError FilterGraph::emit(
+	Command& cmd, const NodeId& id, const PreviewOptions& preview) const {
 	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
 
-	std::string buff;
-	std::vector<std::string> inputs;
+	std::map<std::string, MediaInfo> info;
+	if (preview.maxHeight > 0 || preview.maxFps > 0 || preview.useProxies) {
+		iterateNodes(
+			[&](const FilterNode& node, const NodeId&) {
+				if (node.base().name != INPUT_FILTER_NAME) { return; }
+				const auto& file = node.option.at(0);
+				if (!contains(info, file)) {
+					info[file] = profile->runner.getInfo(file);
+				}
+			},
+			NodeIterOrder::Topological, id);
+	}
+
+	// Every input is scaled by the same factor, so positions relating one
+	// input to another stay consistent
+	auto scale = std::min(1.0, preview.scale);
+	if (preview.maxHeight > 0) {
+		int height = 0;
+		for (const auto& [_, i] : info) {
+			for (const auto& s : i.streams) {
+				height = std::max(height, s.height);
+			}
+		}
+		if (height > preview.maxHeight) {
+			scale = std::min(scale, double(preview.maxHeight) / height);
+		}
+	}
+
+	// Proxies are already downscaled by their own factor. The global factor
+	// is capped to the smallest of them so no proxy is scaled back up.
+	std::map<std::string, std::pair<std::string, double>> proxies;
+	if (preview.useProxies && profile->proxies) {
+		for (const auto& [file, i] : info) {
+			auto proxy = profile->proxies->find(file);
+			if (!proxy) { continue; }
+			int height = 0;
+			for (const auto& s : i.streams) {
+				height = std::max(height, s.height);
+			}
+			auto factor = height > ProxyCache::HEIGHT
+							  ? double(ProxyCache::HEIGHT) / height
+							  : 1.0;
+			proxies[file] = {proxy->string(), factor};
+			scale = std::min(scale, factor);
+		}
+	}
+
+	// Nodes with a rendered output in the cache are read back as inputs and
+	// nothing upstream of them is emitted
+	std::map<IdBaseType, std::string> cached;
+	std::set<IdBaseType> needed;
+	if (preview.useCache && profile->renders && id != INVALID_NODE) {
+		const auto fingerprint = fingerprints(id, preview);
+		std::vector<IdBaseType> stack{getU(id)};
+		while (!stack.empty()) {
+			auto u = stack.back();
+			stack.pop_back();
+			if (!needed.insert(u).second) { continue; }
+			const auto& node = nodes[state.vertIdToNodeIndex[u]];
+			auto f = fingerprint.find(u);
+			if (f != fingerprint.end() &&
+				node.base().name != INPUT_FILTER_NAME) {
+				if (auto file = profile->renders->find(f->second)) {
+					cached[u] = file->string();
+					continue;
+				}
+			}
+			for (const auto& socket : state.revAdjList[u]) {
+				for (const auto& parentSocket : state.revAdjList[socket]) {
+					stack.insert(
+						stack.end(), state.revAdjList[parentSocket].begin(),
+						state.revAdjList[parentSocket].end());
+				}
+			}
+		}
+	}
+
+	// Thumbnails and nodes played together need only the nodes feeding
+	// them
+	if (!preview.thumbnails.empty() || !preview.together.empty()) {
+		std::vector<IdBaseType> stack(
+			preview.thumbnails.begin(), preview.thumbnails.end());
+		stack.insert(
+			stack.end(), preview.together.begin(), preview.together.end());
+		while (!stack.empty()) {
+			auto u = stack.back();
+			stack.pop_back();
+			if (!needed.insert(u).second) { continue; }
+			for (const auto& socket : state.revAdjList[u]) {
+				for (const auto& parentSocket : state.revAdjList[socket]) {
+					stack.insert(
+						stack.end(), state.revAdjList[parentSocket].begin(),
+						state.revAdjList[parentSocket].end());
+				}
+			}
+		}
+	}
+
+	// Each thumbnail branches off the first video output of its node
+	std::string thumbs;
+	std::vector<std::string> thumbOutputs;
+	std::map<IdBaseType, SocketType> outputTypes;
+	auto addThumbnail = [&](std::string_view source, IdBaseType socket) {
+		fmt::format_to(
+			std::back_inserter(thumbs), "{}{}[t{}];", source,
+			thumbnailChain(), socket);
+		thumbOutputs.push_back(fmt::format("[t{}]", socket));
+	};
+	// Nodes played together branch off their first video and audio
+	// output alike, labels by node
+	std::map<IdBaseType, std::pair<std::string, std::string>> branches;
+	auto addBranch = [&](std::string_view source, std::string_view chain,
+						 IdBaseType u, const Socket& socket,
+						 IdBaseType socketId) {
+		const auto video = socket.type == SocketType::Video;
+		std::string filter = video ? (preview.mosaic ? tileChain() : "null")
+								   : "anull";
+		if (!chain.empty()) { filter = fmt::format("{},{}", chain, filter); }
+		auto label = fmt::format("[m{}]", socketId);
+		fmt::format_to(
+			std::back_inserter(thumbs), "{}{}{};", source, filter, label);
+		auto& branch = branches[u];
+		(video ? branch.first : branch.second) = std::move(label);
+	};
+
+	std::string buff, prelude;
+	auto& inputs = cmd.inputs;
+	inputs.clear();
+	cmd.videoSources.clear();
+	cmd.audioSources.clear();
 	std::map<IdBaseType, std::string> inputSocketNames;
 	std::map<IdBaseType, std::string> outputSocketNames;
+	std::map<IdBaseType, std::string> previewChains;
+	const auto target = id;
 	iterateNodes(
 		[&](const FilterNode& node, const NodeId& id) {
 			auto idx = inputs.size();
 			if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return; }
+			const auto u = getU(id);
+			if (!needed.empty() && !contains(needed, u)) { return; }
+			if (auto c = cached.find(u); c != cached.end()) {
+				inputs.push_back(c->second);
+				outputSockets(
+					id, [&](const Socket& socket, const NodeId& socketId) {
+						auto stream =
+							state.vertIdToSocketIndex[getU(socketId)];
+						inputSocketNames[socketId.val] =
+							fmt::format("[{}:{}]", idx, stream);
+						if (id == target) {
+							outputSocketNames[socketId.val] =
+								fmt::format("{}:{}", idx, stream);
+							outputTypes[socketId.val] = socket.type;
+						}
+					});
+				return;
+			}
 			auto isInput = node.base().name == INPUT_FILTER_NAME;
 			inputSockets(
 				id, [&](const Socket& s, const NodeId& sId,
@@ -462,58 +1158,745 @@ FilterGraphError FilterGraph::play(const Preference& pref, const NodeId& id) {
 						return;
 					}
 					outputSocketNames.erase(parentSocketId.val);
+					auto itr = previewChains.find(parentSocketId.val);
+					if (itr == previewChains.end()) {
+						buff += inputSocketNames[parentSocketId.val];
+						return;
+					}
+					// Every consumer gets its own chain, ffmpeg allows
+					// reusing an input stream but not a filter output
+					auto label = fmt::format("[p{}]", sId.val);
 					fmt::format_to(
-						std::back_inserter(buff), "{}",
-						inputSocketNames[parentSocketId.val]);
+						std::back_inserter(prelude), "{}{}{};",
+						inputSocketNames[parentSocketId.val], itr->second,
+						label);
+					buff += label;
 				});
 			if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return; }
+			auto inputScale = scale;
 			if (isInput) {
-				inputs.push_back(node.option.at(0));
+				const auto& file = node.option.at(0);
+				if (auto p = proxies.find(file); p != proxies.end()) {
+					inputs.push_back(p->second.first);
+					inputScale = scale / p->second.second;
+				} else {
+					inputs.push_back(file);
+				}
 			} else {
-				addNodeToFilterGraph(buff, node, id);
+				addNodeToFilterGraph(buff, node, id, scale);
 			}
 
+			auto thumbnail = contains(preview.thumbnails, u);
+			auto branchVideo = contains(preview.together, u);
+			auto branchAudio = branchVideo;
 			outputSockets(
 				id, [&](const Socket& socket, const NodeId& socketId) {
+					const auto wantThumbnail =
+						thumbnail && socket.type == SocketType::Video;
+					if (wantThumbnail) { thumbnail = false; }
+					auto& branch = socket.type == SocketType::Video
+									   ? branchVideo
+									   : branchAudio;
+					const auto wantBranch =
+						branch && socket.type != SocketType::Subtitle;
+					if (wantBranch) { branch = false; }
 					if (isInput) {
 						inputSocketNames[socketId.val] =
 							fmt::format("[{}:{}]", idx, socket.index);
+						if (id == target) {
+							outputSocketNames[socketId.val] =
+								fmt::format("{}:{}", idx, socket.index);
+							outputTypes[socketId.val] = socket.type;
+						}
+						// Input streams can be read many times
+						if (wantThumbnail) {
+							addThumbnail(
+								inputSocketNames[socketId.val], socketId.val);
+						}
+						std::string chain;
+						if (socket.type == SocketType::Video) {
+							double fps = 0;
+							if (auto i = info.find(node.option.at(0));
+								i != info.end() &&
+								static_cast<size_t>(socket.index) <
+									i->second.streams.size()) {
+								fps = i->second.streams[socket.index].fps;
+							}
+							chain =
+								previewChain(inputScale, preview.maxFps, fps);
+							if (!chain.empty()) {
+								previewChains[socketId.val] = chain;
+							}
+						}
+						if (wantBranch) {
+							addBranch(
+								inputSocketNames[socketId.val], chain, u,
+								socket, socketId.val);
+						}
 						return;
 					}
-					inputSocketNames[socketId.val] =
-						fmt::format("[s{}]", socketId.val);
-					outputSocketNames[socketId.val] =
-						fmt::format("[s{}]", socketId.val);
-					buff += inputSocketNames[socketId.val];
+					auto label = fmt::format("[s{}]", socketId.val);
+					buff += label;
+					if (node.input().empty()) {
+						(socket.type == SocketType::Audio ? cmd.audioSources
+														  : cmd.videoSources)
+							.push_back(label);
+					}
+					if (wantThumbnail) {
+						// Consumers read the other branch of a split
+						fmt::format_to(
+							std::back_inserter(thumbs), "{}split[c{}][u{}];",
+							label, socketId.val, socketId.val);
+						addThumbnail(
+							fmt::format("[u{}]", socketId.val), socketId.val);
+						label = fmt::format("[c{}]", socketId.val);
+					} else if (
+						wantBranch && state.adjList[getU(socketId)].empty()) {
+						// Nothing else reads it, so no split is needed
+						addBranch(label, "", u, socket, socketId.val);
+						return;
+					} else if (wantBranch) {
+						fmt::format_to(
+							std::back_inserter(thumbs), "{}{}[c{}][b{}];",
+							label,
+							socket.type == SocketType::Audio ? "asplit"
+															 : "split",
+							socketId.val, socketId.val);
+						addBranch(
+							fmt::format("[b{}]", socketId.val), "", u, socket,
+							socketId.val);
+						label = fmt::format("[c{}]", socketId.val);
+					}
+					outputTypes[socketId.val] = socket.type;
+					inputSocketNames[socketId.val] = label;
+					outputSocketNames[socketId.val] = label;
 				});
 			if (!isInput) { fmt::format_to(std::back_inserter(buff), ";"); }
 		},
 		NodeIterOrder::Topological, id);
 	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
-	std::vector<std::string> out;
-	out.reserve(outputSocketNames.size());
-	for (auto& e : outputSocketNames) {
-		out.push_back(fmt::format("{}", e.second));
+	auto& out = cmd.outputs;
+	out.clear();
+	if (!preview.thumbnails.empty() || !preview.together.empty() ||
+		preview.singleOutput.has_value()) {
+		// Only thumbnails, branches or a single output are mapped, the
+		// rest is dropped. Streams of cached inputs need no sink.
+		for (const auto& [socket, label] : outputSocketNames) {
+			const auto type = outputTypes[socket];
+			if (out.empty() && preview.together.empty() &&
+				preview.singleOutput == type) {
+				out.push_back(label);
+			} else if (str::starts_with(label, "[")) {
+				fmt::format_to(
+					std::back_inserter(thumbs), "{}{};", label,
+					type == SocketType::Audio ? "anullsink" : "nullsink");
+			}
+		}
+		if (!preview.thumbnails.empty()) { out = std::move(thumbOutputs); }
+		if (!preview.together.empty()) {
+			mapBranches(preview, branches, thumbs, out);
+		}
+	} else {
+		out.reserve(outputSocketNames.size());
+		for (auto& e : outputSocketNames) {
+			out.push_back(fmt::format("{}", e.second));
+		}
 	}
-	int status = 0;
-	auto filterString = fmt::to_string(buff);
+	auto& filterString = cmd.filter;
+	filterString = prelude + buff + thumbs;
 
 	// this is needed for some versions of ffmpeg
 	if (!filterString.empty() && filterString.back() == ';') {
 		filterString.pop_back();
 	}
+	return err;
+}
+
+std::map<IdBaseType, std::uint64_t> FilterGraph::fingerprints(
+	const NodeId& id, const PreviewOptions& preview) const {
+	std::map<IdBaseType, std::uint64_t> result;
+	iterateNodes(
+		[&](const FilterNode& node, const NodeId& nodeId) {
+			Hasher h;
+			h.add(preview.scale).add(preview.maxHeight).add(preview.maxFps);
+			h.add(node.base().name);
+			const auto& options = node.base().options;
+			for (const auto& [idx, value] : node.option) {
+				h.add(options[idx].name).add(value);
+				if (options[idx].name == "filename") { h.addFile(value); }
+			}
+			if (node.base().name == INPUT_FILTER_NAME && preview.useProxies &&
+				profile->proxies && contains(node.option, 0)) {
+				if (auto p = profile->proxies->find(node.option.at(0))) {
+					h.add(p->string());
+				}
+			}
+			inputSockets(
+				nodeId, [&](const Socket&, const NodeId&,
+							const NodeId& parentSocketId) {
+					if (parentSocketId == INVALID_NODE) {
+						h.add(std::string_view());
+						return;
+					}
+					const auto p = getU(parentSocketId);
+					h.add(result[state.revAdjList[p][0]])
+						.add(state.vertIdToSocketIndex[p]);
+				});
+			result[getU(nodeId)] = h.value();
+		},
+		NodeIterOrder::Topological, id);
+	return result;
+}
+
+std::uint64_t FilterGraph::fingerprint(
+	const NodeId& id, const PreviewOptions& preview) const {
+	return fingerprints(id, preview).at(getU(id));
+}
+
+void FilterGraph::requestCache(
+	const NodeId& id, const PreviewOptions& preview) const {
+	if (!profile->renders || id == INVALID_NODE ||
+		!profile->renders->isEnabled()) {
+		return;
+	}
+	const auto fingerprint = fingerprints(id, preview);
+	inputSockets(
+		id, [&](const Socket&, const NodeId&, const NodeId& parentSocketId) {
+			if (parentSocketId == INVALID_NODE) { return; }
+			const auto u = state.revAdjList[getU(parentSocketId)][0];
+			const auto parent = getNodeId(state, u);
+			const auto& node = getNode(parent);
+			if (node.base().name == INPUT_FILTER_NAME) { return; }
+			if (profile->renders->find(fingerprint.at(u))) { return; }
+
+			auto filters = 0;
+			iterateNodes(
+				[&](const FilterNode& n, const NodeId&) {
+					if (n.base().name != INPUT_FILTER_NAME) { filters++; }
+				},
+				NodeIterOrder::Topological, parent);
+			if (filters < MIN_CACHED_FILTERS) { return; }
+
+			Command cmd;
+			if (emit(cmd, parent, preview).code !=
+				FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				return;
+			}
+			// Streams of the cached file follow the socket order of parent
+			std::vector<std::string> outputs;
+			for (const auto& socketId : node.outputSocketIds) {
+				outputs.push_back(fmt::format("[s{}]", socketId.val));
+			}
+			for (const auto& o : cmd.outputs) {
+				if (!contains(outputs, o)) { outputs.push_back(o); }
+			}
+			cmd.outputs = std::move(outputs);
+			profile->renders->request(fingerprint.at(u), std::move(cmd));
+		});
+}
+
+void FilterGraph::applyTuning(Command& cmd, const NodeId& id) const {
+	if (!profile->tuner || id == INVALID_NODE) { return; }
+	if (auto threads = profile->tuner->find(fingerprint(id))) {
+		cmd.threads = *threads;
+	}
+}
+
+FilterGraphError FilterGraph::tune(
+	const NodeId& id, const std::atomic_bool* cancel) const {
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	if (!profile->tuner || id == INVALID_NODE) { return err; }
+
+	Command cmd;
+	err = emit(cmd, id);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+
+	int status = 0;
 	std::tie(status, err.message) =
-		profile->runner.play(inputs, filterString, out, pref.player);
+		profile->tuner->tune(profile->runner, cmd, fingerprint(id), cancel);
 	if (status != 0) { err.code = FilterGraphErrorCode::PLAYER_RUNTIME; }
 	return err;
 }
 
+FilterGraphError FilterGraph::benchmark(
+	const NodeId& id, unsigned repetitions, BenchmarkResult& result,
+	const std::atomic_bool* cancel) const {
+	Command cmd;
+	auto err = emit(cmd, id);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	// Measure what play and render would run
+	applyTuning(cmd, id);
+
+	int status = 0;
+	std::tie(status, err.message) =
+		runBenchmark(profile->runner, cmd, repetitions, result, 0, cancel);
+	if (status != 0) {
+		err.code = FilterGraphErrorCode::PLAYER_RUNTIME;
+		return err;
+	}
+	(void)saveBenchmark(path.appDir / "benchmarks", fingerprint(id), result);
+	return err;
+}
+
+FilterGraphError FilterGraph::profileCosts(
+	const NodeId& id, const std::atomic_bool* cancel) {
+	// Long enough for fps to settle, the runs are repeated for every node
+	constexpr double SAMPLE_DURATION = 3;
+
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	if (id == INVALID_NODE) { return err; }
+
+	std::vector<NodeId> order;
+	iterateNodes(
+		[&](const FilterNode& node, const NodeId& u) {
+			if (node.base().name == OUTPUT_FILTER_NAME) { return; }
+			if (node.outputSocketIds.empty()) { return; }
+			order.push_back(u);
+		},
+		NodeIterOrder::Topological, id);
+	const auto fingerprint = fingerprints(id, {});
+
+	costs.clear();
+	std::map<IdBaseType, NodeCost> result;
+	for (const auto& u : order) {
+		const auto fp = fingerprint.at(getU(u));
+		auto itr = costRuns.find(fp);
+		if (itr == costRuns.end()) {
+			// Thread settings are left alone so the runs compare
+			Command cmd;
+			err = emit(cmd, u);
+			if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				return err;
+			}
+			BenchmarkResult bench;
+			int status = 0;
+			std::tie(status, err.message) = runBenchmark(
+				profile->runner, cmd, 1, bench, SAMPLE_DURATION, cancel);
+			if (status != 0) {
+				err.code = FilterGraphErrorCode::PLAYER_RUNTIME;
+				return err;
+			}
+			itr = costRuns.emplace(fp, bench.runs.at(0)).first;
+		}
+		const auto& run = itr->second;
+
+		NodeCost cost;
+		cost.prefixCpu = run.utime + run.stime;
+		cost.fps = run.fps;
+
+		// The run till u includes every node upstream of it once
+		auto upstream = 0.0;
+		iterateNodes(
+			[&](const FilterNode&, const NodeId& v) {
+				if (auto itr = result.find(getU(v)); itr != result.end()) {
+					upstream += itr->second.cpu;
+				}
+			},
+			NodeIterOrder::Topological, u);
+		cost.cpu = std::max(0.0, cost.prefixCpu - upstream);
+
+		auto slowest = -1.0;
+		inputSockets(u, [&](const Socket&, const NodeId&, const NodeId& s) {
+			if (s == INVALID_NODE) { return; }
+			const auto parent = state.revAdjList[getU(s)][0];
+			if (auto itr = result.find(parent); itr != result.end()) {
+				const auto fps = itr->second.fps;
+				slowest = slowest < 0 ? fps : std::min(slowest, fps);
+			}
+		});
+		if (slowest >= 0) { cost.fpsDrop = std::max(0.0, slowest - cost.fps); }
+
+		SPDLOG_INFO(
+			"{}: {:.3f}s cpu of {:.3f}s, {:.1f} fps", getNode(u).name,
+			cost.cpu, cost.prefixCpu, cost.fps);
+		result[getU(u)] = cost;
+	}
+	costs = std::move(result);
+	return err;
+}
+
+void FilterGraph::takeCosts(const FilterGraph& other) {
+	costRuns.insert(other.costRuns.begin(), other.costRuns.end());
+	if (other.revision == revision) { costs = other.costs; }
+}
+
+const NodeCost* FilterGraph::cost(const NodeId& id) const {
+	auto itr = costs.find(getU(id));
+	return itr == costs.end() ? nullptr : &itr->second;
+}
+
+double FilterGraph::maxCost() const {
+	auto m = 0.0;
+	for (const auto& [_, c] : costs) { m = std::max(m, c.cpu); }
+	return m;
+}
+
+FilterGraphError FilterGraph::validate(const NodeId& id) const {
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	if (!profile->validator || id == INVALID_NODE) { return err; }
+
+	Command cmd;
+	err = emit(cmd, id);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+
+	auto result =
+		profile->validator->validate(profile->runner, cmd, fingerprint(id));
+	if (result.status == 0) { return err; }
+	err.code = FilterGraphErrorCode::PLAYER_RUNTIME;
+	err.message = std::move(result.message);
+
+	// Labels are only trusted for nodes that are still in the graph
+	if (const NodeId blamed{result.instance};
+		valid(blamed) && !state.isSocket[getU(blamed)]) {
+		err.node = blamed;
+		err.message = fmt::format(
+			R"(Node "{}" failed: {})", getNode(err.node).name, err.message);
+	}
+	return err;
+}
+
+FilterGraphError FilterGraph::blame(
+	FilterGraphError err, const FilterGraphError& checked) const {
+	if (checked.code == FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	if (err.code == FilterGraphErrorCode::PLAYER_NO_ERROR) {
+		SPDLOG_WARN(
+			"Validation failed but the run did not: {}", checked.message);
+		return err;
+	}
+	if (valid(checked.node) && !valid(err.node)) {
+		err.node = checked.node;
+		err.message = fmt::format(
+			R"(Node "{}" failed: {})", getNode(err.node).name, err.message);
+	}
+	return err;
+}
+
+FilterGraphError FilterGraph::validateAll(
+	const std::vector<NodeId>& ids) const {
+	for (const auto& id : ids) {
+		auto err = validate(id);
+		if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	}
+	return {FilterGraphErrorCode::PLAYER_NO_ERROR};
+}
+
+FilterGraphError FilterGraph::play(
+	const Preference& pref, const NodeId& id, const Segment& window,
+	const std::atomic_bool* cancel) {
+	const auto preview = previewOptions(pref);
+	const auto checked = validate(id);
+
+	Command cmd;
+	auto err = emit(cmd, id, preview);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	if (preview.useCache) { requestCache(id, preview); }
+	applyTuning(cmd, id);
+	return blame(playCommand(pref, cmd, window, cancel), checked);
+}
+
+bool FilterGraph::canStream() const { return profile->runner.isLocal(); }
+
+FilterGraphError FilterGraph::stream(
+	const Preference& pref, FrameRing& ring, const NodeId& id,
+	const Segment& window, const std::atomic_bool* cancel) {
+	auto preview = previewOptions(pref);
+	preview.singleOutput = SocketType::Video;
+	const auto checked = validate(id);
+
+	Command cmd;
+	auto err = emit(cmd, id, preview);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	if (preview.useCache) { requestCache(id, preview); }
+	applyTuning(cmd, id);
+	return blame(streamCommand(cmd, ring, window, cancel), checked);
+}
+
+FilterGraphError FilterGraph::emitTogether(
+	Command& cmd, const std::vector<NodeId>& ids,
+	PreviewOptions preview) const {
+	if (ids.empty()) {
+		return {FilterGraphErrorCode::PLAYER_UNSUPPORTED, "No nodes to play"};
+	}
+	for (const auto& id : ids) { preview.together.push_back(getU(id)); }
+	// Cached subgraphs and thread tuning are found per node, neither fits
+	// a run of many
+	preview.useCache = false;
+	return emit(cmd, INVALID_NODE, preview);
+}
+
+FilterGraphError FilterGraph::playTogether(
+	const Preference& pref, const std::vector<NodeId>& ids,
+	const Segment& window, const std::atomic_bool* cancel) {
+	auto preview = previewOptions(pref);
+	preview.mosaic = pref.previewMosaic;
+	const auto checked = validateAll(ids);
+	Command cmd;
+	auto err = emitTogether(cmd, ids, preview);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	return blame(playCommand(pref, cmd, window, cancel), checked);
+}
+
+FilterGraphError FilterGraph::streamTogether(
+	const Preference& pref, FrameRing& ring, const std::vector<NodeId>& ids,
+	const Segment& window, const std::atomic_bool* cancel) {
+	auto preview = previewOptions(pref);
+	preview.mosaic = true;
+	preview.singleOutput = SocketType::Video;
+	const auto checked = validateAll(ids);
+	Command cmd;
+	auto err = emitTogether(cmd, ids, preview);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	return blame(streamCommand(cmd, ring, window, cancel), checked);
+}
+
+FilterGraphError FilterGraph::playCommand(
+	const Preference& pref, const Command& cmd, const Segment& window,
+	const std::atomic_bool* cancel) const {
+	auto encoding = pref.previewEncoding;
+	if (encoding <= EncodingAuto || encoding >= ENCODING_COUNT) {
+		encoding = profile->encodings
+					   ? profile->encodings->choose(profile->runner, cancel)
+					   : EncodingChooser::FALLBACK;
+	}
+	const auto& encoder = encodingProfile(encoding);
+	auto encoded = cmd;
+	encoded.encoder.insert(
+		encoded.encoder.end(), encoder.args.begin(), encoder.args.end());
+
+	constexpr std::uintmax_t MIB = 1024 * 1024;
+	PlayOptions options{profile->previews.get()};
+	options.memoryBudget = std::uintmax_t(pref.previewMemory) * MIB;
+	options.sizeFactor = encoder.sizeFactor;
+	options.cancel = cancel;
+
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	int status = 0;
+	std::tie(status, err.message) =
+		profile->runner.play(encoded, pref.player, window, options);
+	if (status != 0) { err.code = FilterGraphErrorCode::PLAYER_RUNTIME; }
+	return err;
+}
+
+FilterGraphError FilterGraph::streamCommand(
+	const Command& cmd, FrameRing& ring, const Segment& window,
+	const std::atomic_bool* cancel) const {
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	if (cmd.outputs.empty()) {
+		err.code = FilterGraphErrorCode::PLAYER_UNSUPPORTED;
+		err.message = "Only video can be shown in the editor";
+		return err;
+	}
+	int status = 0;
+	std::tie(status, err.message) =
+		profile->runner.stream(cmd, ring, window, cancel);
+	if (status != 0) { err.code = FilterGraphErrorCode::PLAYER_RUNTIME; }
+	return err;
+}
+
+FilterGraphError FilterGraph::render(
+	const std::filesystem::path& dest, const NodeId& id, unsigned segments,
+	const std::atomic_bool* cancel) const {
+	const auto checked = validate(id);
+
+	Command cmd;
+	auto err = emit(cmd, id);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+	applyTuning(cmd, id);
+
+	if (segments == 0) {
+		segments = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	std::vector<Segment> plan{{0, 0}};
+	if (segments > 1 && !cmd.inputs.empty()) {
+		std::string_view other;
+		NodeId otherId = INVALID_NODE;
+		iterateNodes(
+			[&](const FilterNode& node, const NodeId& nodeId) {
+				if (other.empty() && !isPerFrameFilter(node.base().name)) {
+					other = node.name;
+					otherId = nodeId;
+				}
+			},
+			NodeIterOrder::Topological, id);
+		if (!other.empty()) {
+			err.code = FilterGraphErrorCode::PLAYER_UNSUPPORTED;
+			err.message = fmt::format(
+				R"(Node "{}" isn't known to work frame by frame and can't )"
+				R"(be rendered in segments, render with one segment)",
+				other);
+			err.node = otherId;
+			return err;
+		}
+
+		// Cut along the keyframes of the longest input
+		const auto& runner = profile->runner;
+		std::string_view longest;
+		double duration = 0;
+		for (const auto& input : cmd.inputs) {
+			if (auto d = runner.getInfo(input).duration; d > duration) {
+				duration = d;
+				longest = input;
+			}
+		}
+		if (!longest.empty()) {
+			plan = planSegments(
+				runner.getKeyframes(longest), duration, segments);
+		}
+	}
+
+	int status = 0;
+	std::tie(status, err.message) =
+		profile->runner.render(cmd, plan, dest, cancel);
+	if (status != 0) { err.code = FilterGraphErrorCode::PLAYER_RUNTIME; }
+	return blame(err, checked);
+}
+
+std::map<IdBaseType, std::uint64_t> FilterGraph::outputKeys(
+	SocketType type, double salt) const {
+	std::map<IdBaseType, std::uint64_t> keys;
+	const auto fingerprint = fingerprints(INVALID_NODE, {});
+	std::set<IdBaseType> complete;
+	iterateNodes(
+		[&](const FilterNode& node, const NodeId& id) {
+			auto linked = true;
+			if (node.base().name == INPUT_FILTER_NAME) {
+				auto file = node.option.find(0);
+				linked = file != node.option.end() && !file->second.empty();
+			}
+			inputSockets(
+				id, [&](const Socket&, const NodeId&, const NodeId& parent) {
+					linked = linked && parent != INVALID_NODE &&
+							 contains(
+								 complete,
+								 state.revAdjList[getU(parent)][0]);
+				});
+			if (!linked) { return; }
+			complete.insert(getU(id));
+
+			const auto& outputs = node.output();
+			if (std::none_of(
+					outputs.begin(), outputs.end(),
+					[&](const Socket& s) { return s.type == type; })) {
+				return;
+			}
+			keys[id.val] = Hasher()
+							   .add(fingerprint.at(getU(id)))
+							   .add(static_cast<int>(type))
+							   .add(salt)
+							   .value();
+		},
+		NodeIterOrder::Topological);
+	return keys;
+}
+
+std::map<IdBaseType, std::uint64_t> FilterGraph::thumbnailKeys(
+	double time) const {
+	return outputKeys(SocketType::Video, time);
+}
+
+FilterGraphError FilterGraph::thumbnails(
+	double time, const std::atomic_bool* cancel) const {
+	FilterGraphError err{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	auto& cache = profile->thumbnails;
+	if (!cache) { return err; }
+
+	const auto keys = thumbnailKeys(time);
+	PreviewOptions preview;
+	for (const auto& [id, key] : keys) {
+		if (!cache->contains(key)) {
+			preview.thumbnails.insert(getU(NodeId{id}));
+		}
+	}
+	if (preview.thumbnails.empty()) { return err; }
+
+	Command cmd;
+	err = emit(cmd, INVALID_NODE, preview);
+	if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) { return err; }
+
+	std::vector<std::vector<std::uint8_t>> images;
+	int status = 0;
+	std::tie(status, err.message) = profile->runner.thumbnails(
+		cmd, time, ThumbnailCache::BYTES, images, cancel);
+	if (status != 0) {
+		err.code = FilterGraphErrorCode::PLAYER_RUNTIME;
+		return err;
+	}
+
+	// Outputs are labelled [t<socket id>]
+	for (auto i = 0U; i < cmd.outputs.size(); ++i) {
+		const std::string_view label = cmd.outputs[i];
+		IdBaseType socket = 0;
+		if (!str::stoi(label.substr(2, label.size() - 3), socket) ||
+			!valid(NodeId{socket})) {
+			continue;
+		}
+		const auto& owner = state.revAdjList[getU(NodeId{socket})];
+		if (owner.empty()) { continue; }
+		const auto key = keys.find(getNodeId(state, owner[0]).val);
+		if (key == keys.end()) { continue; }
+		cache->insert(key->second, std::move(images[i]));
+	}
+	return err;
+}
+
+std::map<IdBaseType, std::uint64_t> FilterGraph::waveformKeys() const {
+	return outputKeys(SocketType::Audio, 0);
+}
+
+FilterGraphError FilterGraph::waveforms(
+	const std::map<IdBaseType, std::uint64_t>& keys,
+	const std::atomic_bool* cancel) const {
+	FilterGraphError result{FilterGraphErrorCode::PLAYER_NO_ERROR};
+	auto& cache = profile->waveforms;
+	if (!cache) { return result; }
+
+	PreviewOptions preview;
+	preview.singleOutput = SocketType::Audio;
+	for (const auto& [id, key] : keys) {
+		if (cancel != nullptr && cancel->load()) { break; }
+		if (cache->contains(key)) { continue; }
+		Command cmd;
+		auto err = emit(cmd, NodeId{id}, preview);
+		if (err.code != FilterGraphErrorCode::PLAYER_NO_ERROR) {
+			if (result.code == FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				result = err;
+			}
+			continue;
+		}
+
+		Waveform waveform;
+		auto [status, message] = profile->runner.readAudio(
+			cmd, Waveform::RATE, Waveform::CHANNELS,
+			[&](const float* samples, size_t count) {
+				waveform.append(samples, count);
+				return true;
+			},
+			cancel);
+		// Cancelled reads are cut short, they'd be wrong if kept
+		if (cancel != nullptr && cancel->load()) { break; }
+		if (status != 0) {
+			if (result.code == FilterGraphErrorCode::PLAYER_NO_ERROR) {
+				result.code = FilterGraphErrorCode::PLAYER_RUNTIME;
+				result.message = message;
+			}
+			continue;
+		}
+		waveform.finish();
+		cache->insert(key, std::move(waveform));
+	}
+	return result;
+}
+
 const std::vector<Filter>& FilterGraph::allFilters() const {
 	return profile->filters;
 }
 
 void FilterGraph::clear() {
 	nodes.clear();
+	freeNodes.clear();
+	costs.clear();
+	revision++;
 	state = GraphState{};
 	state.changed = true;
 }
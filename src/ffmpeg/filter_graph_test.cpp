@@ -0,0 +1,663 @@
+#include "ffmpeg/filter_graph.hpp"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#include "ffmpeg/profile.hpp"
+#include "ffmpeg/thumbnail_cache.hpp"
+#include "ffmpeg/validator.hpp"
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace {
+	const Filter TESTSRC{
+		"testsrc", "", {}, {{0, "default", SocketType::Video}},
+		{{"size", "", "image_size"}}, false, false};
+	const Filter DRAWBOX{
+		"drawbox",
+		"",
+		{{0, "default", SocketType::Video}},
+		{{0, "default", SocketType::Video}},
+		{{"x", "", "string"}, {"thickness", "", "string"}},
+		false,
+		false};
+
+	struct Chain {
+		std::vector<NodeId> boxes;
+		NodeId end;	 // of the longest path
+	};
+
+	// Mostly a chain of boxes after a source, now and then a branch off an
+	// earlier box. Three vertices a box, its node and two sockets.
+	Chain buildChain(FilterGraph& g, size_t vertices) {
+		Chain chain{{g.addNode(TESTSRC)}, {}};
+		auto& boxes = chain.boxes;
+		chain.end = boxes.back();
+		std::uint32_t seed = 1;
+		while (boxes.size() * 3 < vertices) {
+			seed = seed * 1664525 + 1013904223;
+			const auto branch = seed >> 28 == 0;
+			const auto from =
+				branch ? boxes[(seed >> 8) % boxes.size()] : chain.end;
+			auto box = g.addNode(DRAWBOX);
+			g.addLink(
+				g.getNode(from).outputSocketIds[0],
+				g.getNode(box).inputSocketIds[0]);
+			boxes.push_back(box);
+			if (!branch) { chain.end = box; }
+		}
+		return chain;
+	}
+}  // namespace
+
+TEST(FilterGraph, emit_generated_sources) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+
+	// Only the source is listed, its first label is where it writes
+	Command cmd;
+	ASSERT_EQ(g.emit(cmd, box).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	const auto label =
+		fmt::format("[s{}]", g.getNode(src).outputSocketIds[0].val);
+	EXPECT_EQ(cmd.videoSources, std::vector<std::string>{label});
+	EXPECT_TRUE(cmd.audioSources.empty());
+	EXPECT_LT(cmd.filter.find("testsrc"), cmd.filter.find(label));
+	EXPECT_LT(cmd.filter.find(label), cmd.filter.find("drawbox"));
+}
+
+TEST(FilterGraph, emit_preview_scale) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(src).option[0] = "1920x1080";
+	g.getNode(box).option[0] = "100";
+	g.getNode(box).option[1] = "1";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+
+	Command cmd;
+	EXPECT_EQ(g.emit(cmd, box).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(str::contains(cmd.filter, "size=1920x1080"));
+	EXPECT_TRUE(str::contains(cmd.filter, "x=100:thickness=1"));
+
+	PreviewOptions preview;
+	preview.scale = 0.25;
+	EXPECT_EQ(
+		g.emit(cmd, box, preview).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(str::contains(cmd.filter, "size=480x270"));
+	EXPECT_TRUE(str::contains(cmd.filter, "x=25:thickness=1"));
+
+	// Negative values are kept as they are
+	g.getNode(box).option[0] = "-2";
+	EXPECT_EQ(
+		g.emit(cmd, box, preview).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(str::contains(cmd.filter, "x=-2:thickness=1"));
+}
+
+TEST(FilterGraph, fingerprint) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	auto b = g.addNode(DRAWBOX);
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+	g.addLink(
+		g.getNode(a).outputSocketIds[0], g.getNode(b).inputSocketIds[0]);
+
+	const auto fa = g.fingerprint(a), fb = g.fingerprint(b);
+	EXPECT_NE(fa, fb);
+
+	// Downstream edits leave upstream fingerprints alone
+	g.getNode(b).option[0] = "10";
+	EXPECT_EQ(g.fingerprint(a), fa);
+	EXPECT_NE(g.fingerprint(b), fb);
+
+	// Upstream edits change everything below
+	const auto fb2 = g.fingerprint(b);
+	g.getNode(src).option[0] = "640x480";
+	EXPECT_NE(g.fingerprint(a), fa);
+	EXPECT_NE(g.fingerprint(b), fb2);
+
+	PreviewOptions preview;
+	preview.scale = 0.5;
+	EXPECT_NE(g.fingerprint(b, preview), g.fingerprint(b));
+}
+
+TEST(FilterGraph, emit_cached_subgraph) {
+	namespace fs = std::filesystem;
+	const auto dir = fs::temp_directory_path() / "ffmpeg_node_editor_fg_test";
+	fs::remove_all(dir);
+
+	Profile profile{Runner()};
+	profile.renders = std::make_shared<RenderCache>(Runner(), dir);
+	profile.renders->configure(true, 1024);
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	auto b = g.addNode(DRAWBOX);
+	g.getNode(a).option[0] = "1";
+	g.getNode(b).option[0] = "2";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+	g.addLink(
+		g.getNode(a).outputSocketIds[0], g.getNode(b).inputSocketIds[0]);
+
+	PreviewOptions preview;
+	preview.useCache = true;
+	const auto cached =
+		dir / fmt::format("{:016x}.mkv", g.fingerprint(a, preview));
+	std::ofstream(cached) << "x";
+
+	Command cmd;
+	EXPECT_EQ(
+		g.emit(cmd, b, preview).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	ASSERT_EQ(cmd.inputs.size(), 1);
+	EXPECT_EQ(cmd.inputs[0], cached.string());
+	EXPECT_FALSE(str::contains(cmd.filter, "testsrc"));
+	EXPECT_FALSE(str::contains(cmd.filter, "x=1"));
+	EXPECT_TRUE(str::starts_with(cmd.filter, "[0:0]drawbox"));
+
+	// Playing the cached node itself just reads the file back
+	EXPECT_EQ(
+		g.emit(cmd, a, preview).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(cmd.filter.empty());
+	EXPECT_EQ(cmd.outputs, std::vector<std::string>{"0:0"});
+
+	profile.renders.reset();
+	fs::remove_all(dir);
+}
+
+TEST(FilterGraph, emit_thumbnails) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	auto b = g.addNode(DRAWBOX);
+	g.getNode(a).option[0] = "1";
+	g.getNode(b).option[0] = "2";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+	g.addLink(
+		g.getNode(a).outputSocketIds[0], g.getNode(b).inputSocketIds[0]);
+
+	// Vertex ids are one below node ids
+	PreviewOptions preview;
+	preview.thumbnails = {src.val - 1, a.val - 1};
+	Command cmd;
+	EXPECT_EQ(
+		g.emit(cmd, INVALID_NODE, preview).code,
+		FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_EQ(cmd.outputs.size(), 2);
+	EXPECT_TRUE(str::contains(cmd.filter, "split"));
+	EXPECT_TRUE(str::contains(cmd.filter, "format=rgba"));
+	EXPECT_TRUE(str::contains(cmd.filter, "nullsink"));
+	// Nothing below the thumbnails is run
+	EXPECT_FALSE(str::contains(cmd.filter, "x=2"));
+}
+
+TEST(FilterGraph, thumbnails) {
+	Profile profile{Runner()};
+	profile.thumbnails = std::make_shared<ThumbnailCache>();
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	// Reused vertices, so socket ids carry a generation
+	g.deleteNode(g.addNode(DRAWBOX));
+	auto a = g.addNode(DRAWBOX);
+	g.getNode(src).option[0] = "320x240";
+	g.getNode(a).option[0] = "1";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+
+	ASSERT_EQ(g.thumbnails(0).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	const auto keys = g.thumbnailKeys(0);
+	ASSERT_EQ(keys.size(), 2);
+	for (const auto& [id, key] : keys) {
+		const auto image = profile.thumbnails->find(key);
+		ASSERT_TRUE(image.has_value()) << "node " << id;
+		EXPECT_EQ(image->size(), ThumbnailCache::BYTES);
+	}
+}
+
+TEST(FilterGraph, emit_together) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	auto b = g.addNode(DRAWBOX);
+	auto c = g.addNode(DRAWBOX);
+	g.getNode(a).option[0] = "1";
+	g.getNode(b).option[0] = "2";
+	g.getNode(c).option[0] = "3";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+	g.addLink(
+		g.getNode(a).outputSocketIds[0], g.getNode(b).inputSocketIds[0]);
+	g.addLink(
+		g.getNode(b).outputSocketIds[0], g.getNode(c).inputSocketIds[0]);
+
+	PreviewOptions preview;
+	preview.together = {a.val - 1, c.val - 1};
+	Command cmd;
+	ASSERT_EQ(
+		g.emit(cmd, INVALID_NODE, preview).code,
+		FilterGraphErrorCode::PLAYER_NO_ERROR);
+	// A stream each, a is split to feed b as well while c needs no split
+	EXPECT_EQ(cmd.outputs.size(), 2);
+	EXPECT_EQ(cmd.filter.find("split"), cmd.filter.rfind("split"));
+	EXPECT_FALSE(str::contains(cmd.filter, "nullsink"));
+
+	preview.mosaic = true;
+	ASSERT_EQ(
+		g.emit(cmd, INVALID_NODE, preview).code,
+		FilterGraphErrorCode::PLAYER_NO_ERROR);
+	ASSERT_EQ(cmd.outputs.size(), 1);
+	EXPECT_EQ(cmd.outputs[0], "[mosaic]");
+	EXPECT_TRUE(str::contains(cmd.filter, "xstack=inputs=2"));
+	// The shared part is filtered once
+	EXPECT_EQ(cmd.filter.find("x=1"), cmd.filter.rfind("x=1"));
+	EXPECT_EQ(cmd.filter.find("x=2"), cmd.filter.rfind("x=2"));
+}
+
+TEST(FilterGraph, save_load) {
+	const auto file = std::filesystem::temp_directory_path() /
+					  "ffmpeg_node_editor_graph_test.json";
+	Profile profile{Runner()};
+	profile.filters = {TESTSRC, DRAWBOX};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(box).option[0] = "100";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+	ASSERT_TRUE(g.save(file));
+
+	FilterGraph loaded(profile);
+	std::map<int, NodeId> ids;
+	ASSERT_TRUE(loaded.load(file, &ids));
+	ASSERT_TRUE(contains(ids, box.val));
+	Command cmd;
+	EXPECT_EQ(
+		loaded.emit(cmd, ids[box.val]).code,
+		FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(str::contains(cmd.filter, "x=100"));
+	EXPECT_EQ(g.fingerprint(box), loaded.fingerprint(ids[box.val]));
+	std::filesystem::remove(file);
+}
+
+TEST(FilterGraph, profile_costs) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(box).option[0] = "100";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+
+	ASSERT_EQ(
+		g.profileCosts(box).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	const auto* s = g.cost(src);
+	const auto* b = g.cost(box);
+	ASSERT_NE(s, nullptr);
+	ASSERT_NE(b, nullptr);
+	// The box only pays for what its run adds over the source
+	EXPECT_DOUBLE_EQ(s->cpu, s->prefixCpu);
+	EXPECT_DOUBLE_EQ(b->cpu, std::max(0.0, b->prefixCpu - s->cpu));
+	EXPECT_GE(b->fpsDrop, 0);
+	EXPECT_GE(g.maxCost(), b->cpu);
+
+	g.getNode(box).option[0] = "10";
+	g.optHook(box, 0, "10");
+	EXPECT_EQ(g.cost(box), nullptr);
+}
+
+TEST(FilterGraph, take_costs) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+
+	// Profiled on a copy, as the editor does in the background
+	auto copy = g;
+	ASSERT_EQ(
+		copy.profileCosts(box).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	g.takeCosts(copy);
+	ASSERT_NE(g.cost(box), nullptr);
+	EXPECT_DOUBLE_EQ(g.cost(box)->cpu, copy.cost(box)->cpu);
+
+	// Costs of a graph edited meanwhile would be off
+	copy = g;
+	ASSERT_EQ(
+		copy.profileCosts(src).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	g.getNode(box).option[0] = "10";
+	g.optHook(box, 0, "10");
+	g.takeCosts(copy);
+	EXPECT_EQ(g.cost(src), nullptr);
+}
+
+TEST(FilterGraph, output_node) {
+	const Filter OUTPUT{
+		OUTPUT_FILTER_NAME, "", {{0, "default", SocketType::Video}}, {},
+		{{"filename", "", "string"}}, false, false};
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	auto out = g.addNode(OUTPUT);
+	g.getNode(out).option[0] = "out.mkv";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+	EXPECT_EQ(g.renderTarget(out), INVALID_NODE);
+	g.addLink(
+		g.getNode(box).outputSocketIds[0], g.getNode(out).inputSocketIds[0]);
+
+	// The node feeding the output node is what gets rendered
+	EXPECT_EQ(g.ends(), std::vector<NodeId>{box});
+	EXPECT_EQ(g.renderTarget(out), box);
+	EXPECT_EQ(g.renderTarget(box), box);
+	EXPECT_EQ(g.outputFile(box), "out.mkv");
+	EXPECT_TRUE(g.outputFile(src).empty());
+}
+
+TEST(FilterGraph, reuse_vertices) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(a).inputSocketIds[0]);
+	const auto vertices = g.vertexCount();
+	const auto oldInput = g.getNode(a).inputSocketIds[0];
+
+	g.deleteNode(a);
+	EXPECT_FALSE(g.valid(a));
+	EXPECT_FALSE(g.valid(oldInput));
+	auto b = g.addNode(DRAWBOX);
+	EXPECT_EQ(g.vertexCount(), vertices);
+	// Same vertex, another generation
+	EXPECT_NE(b, a);
+	EXPECT_TRUE(g.valid(b));
+	EXPECT_FALSE(g.valid(a));
+	g.deleteNode(a);  // stale, b stays
+	EXPECT_TRUE(g.valid(b));
+
+	// Regenerated sockets take the place of the dropped ones too
+	const Filter split{
+		"split", "", {{0, "default", SocketType::Video}},
+		{{0, "default", SocketType::Video}}, {{"outputs", "", "int"}},
+		false, true};
+	auto s = g.addNode(split);
+	g.optHook(s, 0, "3");
+	const auto before = g.vertexCount();
+	for (auto i = 0; i < 10; ++i) {
+		g.optHook(s, 0, "2");
+		g.optHook(s, 0, "3");
+	}
+	EXPECT_EQ(g.vertexCount(), before);
+	EXPECT_EQ(g.getNode(s).outputSocketIds.size(), 3);
+}
+
+TEST(FilterGraph, compact) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto a = g.addNode(DRAWBOX);
+	auto b = g.addNode(DRAWBOX);
+	g.getNode(b).option[0] = "7";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(b).inputSocketIds[0]);
+	const auto fingerprint = g.fingerprint(b);
+	const auto input = g.getNode(b).inputSocketIds[0];
+	g.deleteNode(a);
+	g.resetChanged();
+
+	const auto ids = g.compact();
+	EXPECT_EQ(g.vertexCount(), 5);
+	EXPECT_FALSE(contains(ids, a.val));
+	ASSERT_TRUE(contains(ids, b.val));
+	ASSERT_TRUE(contains(ids, src.val));
+	EXPECT_FALSE(g.changed());
+	// Old ids are gone, even those of vertices that did not move
+	EXPECT_FALSE(g.valid(src));
+	EXPECT_FALSE(g.valid(b));
+
+	const auto newB = ids.at(b.val);
+	ASSERT_TRUE(g.valid(newB));
+	EXPECT_EQ(g.getNode(newB).option[0], "7");
+	EXPECT_EQ(g.fingerprint(newB), fingerprint);
+	EXPECT_EQ(ids.at(input.val), g.getNode(newB).inputSocketIds[0]);
+	size_t links = 0;
+	g.iterateLinks([&](const LinkId&, const NodeId& u, const NodeId& v) {
+		EXPECT_EQ(u, g.getNode(ids.at(src.val)).outputSocketIds[0]);
+		EXPECT_EQ(v, g.getNode(newB).inputSocketIds[0]);
+		links++;
+	});
+	EXPECT_EQ(links, 1);
+
+	Command cmd;
+	ASSERT_EQ(g.emit(cmd, newB).code, FilterGraphErrorCode::PLAYER_NO_ERROR);
+	EXPECT_TRUE(str::contains(cmd.filter, "x=7"));
+	// Vertices added afterwards get ids no earlier one had
+	auto c = g.addNode(DRAWBOX);
+	EXPECT_NE(c, a);
+	EXPECT_NE(c, b);
+}
+
+TEST(FilterGraph, generations_run_out) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	const auto first = g.addNode(DRAWBOX);
+	auto box = first;
+	for (auto i = 0; i < 1100; ++i) {
+		g.deleteNode(box);
+		box = g.addNode(DRAWBOX);
+		ASSERT_NE(box, first);
+	}
+	// Exhausted vertices are left aside instead of naming old ids again
+	EXPECT_FALSE(g.valid(first));
+	EXPECT_GT(g.vertexCount(), 3);
+
+	box = g.compact().at(box.val);
+	EXPECT_EQ(g.vertexCount(), 3);
+	// Compactions start generations over once they run out too
+	for (auto i = 0; i < 1100; ++i) {
+		const auto ids = g.compact();
+		ASSERT_EQ(ids.size(), 3);
+		box = ids.at(box.val);
+		ASSERT_TRUE(g.valid(box));
+	}
+	EXPECT_EQ(g.getNode(box).name, "drawbox");
+}
+
+TEST(FilterGraph, links_at_vertex_limit) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	// Each drawbox takes three vertices, the last ones are the highest a
+	// link id can hold and none past them can be added
+	std::vector<NodeId> boxes;
+	for (auto box = g.addNode(DRAWBOX); box != INVALID_NODE;
+		 box = g.addNode(DRAWBOX)) {
+		boxes.push_back(box);
+	}
+	ASSERT_EQ(boxes.size(), (1 << 15) / 3);
+	EXPECT_EQ(g.addNode(DRAWBOX), INVALID_NODE);
+
+	const auto& a = g.getNode(boxes[boxes.size() - 2]);
+	const auto& b = g.getNode(boxes.back());
+	const auto link = g.addLink(a.outputSocketIds[0], b.inputSocketIds[0]);
+	ASSERT_NE(link, INVALID_LINK);
+	auto links = 0;
+	g.iterateLinks([&](const LinkId& id, const NodeId& u, const NodeId& v) {
+		EXPECT_EQ(id, link);
+		EXPECT_EQ(u, a.outputSocketIds[0]);
+		EXPECT_EQ(v, b.inputSocketIds[0]);
+		links++;
+	});
+	EXPECT_EQ(links, 1);
+
+	g.deleteLink(link);
+	links = 0;
+	g.iterateLinks([&](const LinkId&, const NodeId&, const NodeId&) {
+		links++;
+	});
+	EXPECT_EQ(links, 0);
+}
+
+TEST(FilterGraph, validate_after_compact) {
+	Profile profile{Runner()};
+	profile.validator = std::make_shared<Validator>();
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	g.deleteNode(g.addNode(DRAWBOX));
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(box).option[0] = "bad";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+	box = g.compact().at(box.val);
+
+	const auto err = g.validate(box);
+	EXPECT_EQ(err.code, FilterGraphErrorCode::PLAYER_RUNTIME);
+	EXPECT_EQ(err.node, box);
+}
+
+TEST(FilterGraph, validate_cached) {
+	Profile profile{Runner()};
+	profile.validator = std::make_shared<Validator>();
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto unused = g.addNode(DRAWBOX);
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(box).option[0] = "bad";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+	EXPECT_EQ(g.validate(box).node, box);
+
+	// Same graph, other ids, so the cached failure must be mapped to them
+	g.deleteNode(unused);
+	const auto ids = g.compact();
+	const NodeId moved{ids.at(box.val)};
+	ASSERT_NE(moved, box);
+	profile.runner = Runner("no-such-ffmpeg");
+	const auto err = g.validate(moved);
+	EXPECT_EQ(err.code, FilterGraphErrorCode::PLAYER_RUNTIME);
+	EXPECT_EQ(err.node, moved);
+}
+
+TEST(FilterGraph, render_blames_validated_node) {
+	Profile profile{Runner()};
+	profile.validator = std::make_shared<Validator>();
+	FilterGraph g(profile);
+	auto src = g.addNode(TESTSRC);
+	auto box = g.addNode(DRAWBOX);
+	g.getNode(box).option[0] = "bad";
+	g.addLink(
+		g.getNode(src).outputSocketIds[0], g.getNode(box).inputSocketIds[0]);
+
+	// The render still runs, its failure is put on the validated node
+	const auto dest = std::filesystem::temp_directory_path() / "blame.mkv";
+	const auto err = g.render(dest, box, 1);
+	EXPECT_EQ(err.code, FilterGraphErrorCode::PLAYER_RUNTIME);
+	EXPECT_EQ(err.node, box);
+	EXPECT_NE(err.message.find("drawbox"), std::string::npos);
+}
+
+TEST(FilterGraph, render_segments_per_frame_only) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	const Filter input{
+		INPUT_FILTER_NAME, "", {}, {{0, "default", SocketType::Video}},
+		{{"filename", "", "string"}}, false, false};
+	auto in = g.addNode(input);
+	g.getNode(in).option[0] = "clip.mkv";
+	// Not known to be per frame, as any filter ffmpeg adds later
+	const Filter motion{
+		"tmotionblur", "", DRAWBOX.input, DRAWBOX.output, {}, false, false};
+	auto blur = g.addNode(motion);
+	g.addLink(
+		g.getNode(in).outputSocketIds[0], g.getNode(blur).inputSocketIds[0]);
+
+	const auto dest = std::filesystem::temp_directory_path() / "segs.mkv";
+	const auto err = g.render(dest, blur, 2);
+	EXPECT_EQ(err.code, FilterGraphErrorCode::PLAYER_UNSUPPORTED);
+	EXPECT_EQ(err.node, blur);
+}
+
+TEST(EdgeList, spills_to_heap) {
+	EdgeList edges;
+	for (auto i = 0; i < 10; ++i) { edges.push_back(i); }
+	ASSERT_EQ(edges.size(), 10);
+	EXPECT_EQ(edges[9], 9);
+	erase(edges, 3);
+	EXPECT_EQ(edges.size(), 9);
+	EXPECT_FALSE(contains(edges, 3));
+	EXPECT_EQ(edges[3], 4);
+
+	auto copy = edges;
+	auto moved = std::move(edges);
+	EXPECT_TRUE(edges.empty());
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), moved.begin()));
+
+	EdgeList small;
+	small.push_back(7);
+	moved = small;
+	ASSERT_EQ(moved.size(), 1);
+	EXPECT_EQ(moved[0], 7);
+	copy = std::move(small);
+	EXPECT_EQ(copy[0], 7);
+}
+
+TEST(FilterGraph, iterate_chain) {
+	Profile profile{Runner()};
+	FilterGraph g(profile);
+	const auto [boxes, end] = buildChain(g, 3000);
+	auto visits = [&](NodeIterOrder order, NodeId u) {
+		size_t visited = 0;
+		g.iterateNodes(
+			[&](const FilterNode&, const NodeId&) { visited++; }, order, u);
+		return visited;
+	};
+	EXPECT_EQ(visits(NodeIterOrder::Default, INVALID_NODE), boxes.size());
+	EXPECT_EQ(visits(NodeIterOrder::Topological, INVALID_NODE), boxes.size());
+	// Goes up the whole chain, as deep as the graph gets
+	EXPECT_GT(visits(NodeIterOrder::Topological, end), boxes.size() / 2);
+}
+
+// Timing only, run with --gtest_also_run_disabled_tests
+TEST(FilterGraph, DISABLED_benchmark_iteration) {
+	for (const auto vertices : {10000, 100000}) {
+		Profile profile{Runner()};
+		FilterGraph g(profile);
+		const auto chain = buildChain(g, vertices);
+		auto time = [&](const char* name, NodeIterOrder order, NodeId u) {
+			constexpr int RUNS = 20;
+			const auto start = std::chrono::steady_clock::now();
+			for (auto i = 0; i < RUNS; ++i) {
+				g.iterateNodes(
+					[](const FilterNode&, const NodeId&) {}, order, u);
+			}
+			const std::chrono::duration<double, std::milli> elapsed =
+				std::chrono::steady_clock::now() - start;
+			fmt::print(
+				"{} over {} vertices: {:.3f} ms\n", name, vertices,
+				elapsed.count() / RUNS);
+		};
+		time("iterateNodes", NodeIterOrder::Default, INVALID_NODE);
+		time("topological sort", NodeIterOrder::Topological, INVALID_NODE);
+		time(
+			"topological sort from the end", NodeIterOrder::Topological,
+			chain.end);
+	}
+}
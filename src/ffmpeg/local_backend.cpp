@@ -0,0 +1,217 @@
+#include <subprocess.h>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "ffmpeg/runner_backend.hpp"
+#include "log_buffer.hpp"
+#include "util.hpp"
+
+#if defined(APP_OS_WINDOWS)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include <csignal>
+#endif
+
+namespace {
+	auto convertArgs(const std::vector<std::string>& args) {
+		std::vector<const char*> result;
+		result.reserve(args.size() + 1);
+		for (const auto& e : args) { result.push_back(e.data()); }
+		result.push_back(nullptr);
+		return result;
+	}
+
+	class Process : public RunnerJob {
+		subprocess_s process;
+		// Guards the process handle, the pipes have a reader each
+		std::mutex mutex;
+		int status = -1;
+		bool joined = false;
+		std::vector<std::string> args;	// for the process log
+		static constexpr auto BUFFER_SIZE = 4096u;
+		static constexpr auto CHUNK_SIZE = 64 * 1024u;
+
+		using Reader = unsigned (*)(subprocess_s*, char*, unsigned);
+
+		// Till cb returns false or the stream ends
+		void readStream(
+			Reader reader, const std::function<bool(std::string_view)>& cb,
+			size_t size = BUFFER_SIZE) {
+			std::string buffer(size, '\0');
+			for (auto read = reader(&process, buffer.data(), buffer.size());
+				 read > 0;
+				 read = reader(&process, buffer.data(), buffer.size())) {
+				if (!cb(std::string_view(buffer).substr(0, read))) { return; }
+			}
+		}
+
+		// ffmpeg finishes its outputs and exits on q
+		void sendQuit() {
+#if !defined(APP_OS_WINDOWS)
+			// Writing after the process closed stdin raises SIGPIPE. The
+			// executables ignore it, other users of the library may not,
+			// so it's held back for this thread and dropped.
+			sigset_t pipe, old;
+			sigemptyset(&pipe);
+			sigaddset(&pipe, SIGPIPE);
+			pthread_sigmask(SIG_BLOCK, &pipe, &old);
+#endif
+			if (auto* in = subprocess_stdin(&process)) {
+				std::fputs("q\n", in);
+				std::fflush(in);
+			}
+#if !defined(APP_OS_WINDOWS)
+			sigset_t pending;
+			if (int sig = 0; sigpending(&pending) == 0 &&
+							 sigismember(&pending, SIGPIPE) == 1) {
+				sigwait(&pipe, &sig);
+			}
+			pthread_sigmask(SIG_SETMASK, &old, nullptr);
+#endif
+		}
+
+	   public:
+		Process() = default;
+		Process(const Process&) = delete;
+		Process(Process&&) = delete;
+		Process& operator=(Process&&) = delete;
+		Process& operator=(const Process&) = delete;
+
+		~Process() override {
+			terminate();
+			finish();
+			subprocess_destroy(&process);
+		}
+
+		bool start(const std::vector<std::string>& a) {
+			args = a;
+			auto aargs = convertArgs(args);
+			return subprocess_create(
+					   aargs.data(),
+					   subprocess_option_enable_async |
+						   subprocess_option_search_user_path |
+						   subprocess_option_inherit_environment,
+					   &process) == 0;
+		}
+
+		void lowerPriority() {
+#if defined(APP_OS_WINDOWS)
+			SetPriorityClass(process.hProcess, IDLE_PRIORITY_CLASS);
+#else
+			constexpr auto LOWEST_PRIORITY = 19;
+			setpriority(PRIO_PROCESS, process.child, LOWEST_PRIORITY);
+#endif
+		}
+
+		bool isRunning() override {
+			std::lock_guard lock(mutex);
+			return !joined && subprocess_alive(&process) != 0;
+		}
+
+		void stop(StopLevel level) override {
+			std::lock_guard lock(mutex);
+			if (joined || subprocess_alive(&process) == 0) { return; }
+			switch (level) {
+				case StopLevel::Quit:
+					sendQuit();
+					break;
+				case StopLevel::Terminate:
+#if defined(APP_OS_WINDOWS)
+					subprocess_terminate(&process);
+#else
+					kill(process.child, SIGTERM);
+#endif
+					break;
+				case StopLevel::Kill:
+					subprocess_terminate(&process);
+					break;
+			}
+		}
+
+		int finish() override {
+			// Joining blocks, polling leaves the handle free for stop
+			using namespace std::chrono_literals;
+			while (isRunning()) { std::this_thread::sleep_for(10ms); }
+			std::lock_guard lock(mutex);
+			if (!joined) {
+				subprocess_join(&process, &status);
+				joined = true;
+			}
+			return status;
+		}
+
+		// A verbose ffmpeg can write a lot, keep its tail and errors only
+		std::string readStdErr() override {
+			LogBuffer log;
+			readStream(subprocess_read_stderr, [&](std::string_view data) {
+				log.append(data);
+				return true;
+			});
+			auto text = log.str();
+			logProcess(args, text);
+			return text;
+		}
+		std::string readStdOut() override {
+			std::string str;
+			readStream(subprocess_read_stdout, [&](std::string_view data) {
+				str += data;
+				return true;
+			});
+			return str;
+		}
+		// Video frames are large, fewer reads keep up with them
+		void readChunks(
+			const std::function<bool(std::string_view)>& cb) override {
+			readStream(subprocess_read_stdout, cb, CHUNK_SIZE);
+		}
+
+		void readLines(
+			const LineScannerCallback& cb, bool readStdErr) override {
+			Reader reader = subprocess_read_stdout;
+			if (readStdErr) { reader = subprocess_read_stderr; }
+
+			std::string line, buffer(BUFFER_SIZE, '\0');
+			for (auto read = reader(&process, buffer.data(), buffer.size());
+				 read > 0;
+				 read = reader(&process, buffer.data(), buffer.size())) {
+				auto data = std::string_view(buffer).substr(0, read);
+				for (auto idx = data.find('\n'); idx != std::string_view::npos;
+					 idx = data.find('\n')) {
+					line += data.substr(0, idx);
+					data.remove_prefix(idx + 1);
+					if (!cb(line)) { return; }
+					line.clear();
+				}
+				line += data;
+			}
+			if (!line.empty()) { cb(line); }
+		}
+	};
+}  // namespace
+
+std::recursive_mutex& LocalBackend::spawnMutex() {
+	static std::recursive_mutex mutex;
+	return mutex;
+}
+
+std::unique_ptr<RunnerJob> LocalBackend::start(
+	const std::vector<std::string>& args, bool lowPriority) {
+	auto process = std::make_unique<Process>();
+	std::unique_lock spawning(spawnMutex());
+	const auto started = process->start(args);
+	spawning.unlock();
+	if (!started) {
+		SPDLOG_ERROR("unable to start {}", args.empty() ? "" : args[0]);
+		return nullptr;
+	}
+	if (lowPriority) { process->lowerPriority(); }
+	return process;
+}
@@ -0,0 +1,69 @@
+#include "ffmpeg/preview_encoding.hpp"
+
+#include "util.hpp"
+
+namespace {
+	// The sine is there so the PCM encoder is part of the measurement
+	constexpr auto SAMPLE_SOURCE =
+		"testsrc2=size=1920x1080:rate=30[v];sine=sample_rate=48000[a]";
+}  // namespace
+
+const EncodingProfile& encodingProfile(int encoding) {
+	static const std::vector<EncodingProfile> profiles{
+		{"Auto", {}, 1},
+		{"Lossless (utvideo)",
+		 {"-c:v", "utvideo", "-c:a", "pcm_s16le"},
+		 30},
+		{"Intra only (MJPEG)",
+		 {"-c:v", "mjpeg", "-q:v", "3", "-c:a", "pcm_s16le"},
+		 8},
+		{"x264 ultrafast",
+		 {"-c:v", "libx264", "-preset", "ultrafast", "-tune", "zerolatency",
+		  "-c:a", "pcm_s16le"},
+		 2},
+		{"ffmpeg default", {}, 1},
+	};
+	return profiles.at(encoding);
+}
+
+std::vector<EncodingTiming> compareEncodings(
+	const Runner& runner, const Command& cmd,
+	const std::atomic_bool* cancel) {
+	std::vector<EncodingTiming> timings;
+	for (auto e = EncodingAuto + 1; e < ENCODING_COUNT; ++e) {
+		if (cancel != nullptr && cancel->load()) { break; }
+		auto encoded = cmd;
+		const auto& args = encodingProfile(e).args;
+		encoded.encoder.insert(encoded.encoder.end(), args.begin(), args.end());
+		auto& timing = timings.emplace_back();
+		timing.encoding = e;
+		auto [status, err] = runner.firstFrame(encoded, timing.firstFrame);
+		if (status != 0) {
+			timing.firstFrame = -1;
+			timing.error = err;
+		}
+	}
+	return timings;
+}
+
+int EncodingChooser::choose(
+	const Runner& runner, const std::atomic_bool* cancel) {
+	std::lock_guard lock(mutex);
+	if (fastest) { return *fastest; }
+	const Command sample{{}, SAMPLE_SOURCE, {"[v]", "[a]"}};
+	const auto timings = compareEncodings(runner, sample, cancel);
+	if (cancel != nullptr && cancel->load()) { return FALLBACK; }
+	int chosen = FALLBACK;
+	double best = -1;
+	for (const auto& t : timings) {
+		SPDLOG_INFO(
+			"{}: {:.3f}s to the first frame", encodingProfile(t.encoding).name,
+			t.firstFrame);
+		if (t.firstFrame >= 0 && (best < 0 || t.firstFrame < best)) {
+			best = t.firstFrame;
+			chosen = t.encoding;
+		}
+	}
+	fastest = chosen;
+	return chosen;
+}
@@ -0,0 +1,48 @@
+#include "ffmpeg/preview_encoding.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "util.hpp"
+
+TEST(PreviewEncoding, profiles) {
+	for (auto e = EncodingAuto + 1; e < ENCODING_COUNT; ++e) {
+		const auto& args = encodingProfile(e).args;
+		// Only the default leaves the codecs to ffmpeg
+		EXPECT_EQ(args.empty(), e == EncodingDefault);
+		if (!args.empty()) { EXPECT_TRUE(contains(args, "pcm_s16le")); }
+	}
+	EXPECT_TRUE(contains(encodingProfile(EncodingX264).args, "zerolatency"));
+}
+
+TEST(PreviewEncoding, compare) {
+	Runner runner;
+	const Command cmd{{}, "testsrc=d=1[v]", {"[v]"}};
+	const auto timings = compareEncodings(runner, cmd);
+	ASSERT_EQ(timings.size(), ENCODING_COUNT - 1);
+	for (const auto& t : timings) {
+		EXPECT_GE(t.firstFrame, 0) << encodingProfile(t.encoding).name;
+	}
+
+	EncodingChooser chooser;
+	const auto fastest = chooser.choose(runner);
+	EXPECT_GT(fastest, EncodingAuto);
+	EXPECT_LT(fastest, ENCODING_COUNT);
+	// Measured once only
+	EXPECT_EQ(chooser.choose(Runner("no-such-ffmpeg")), fastest);
+}
+
+TEST(PreviewEncoding, choose_fallback) {
+	// Nothing encodes without ffmpeg, so its default is the safe choice
+	EncodingChooser missing;
+	EXPECT_EQ(missing.choose(Runner("no-such-ffmpeg")), EncodingDefault);
+
+	// A cancelled measurement is taken again next time
+	EncodingChooser chooser;
+	const std::atomic_bool cancel = true;
+	EXPECT_EQ(chooser.choose(Runner(), &cancel), EncodingChooser::FALLBACK);
+	const auto fastest = chooser.choose(Runner());
+	EXPECT_GT(fastest, EncodingAuto);
+	EXPECT_EQ(chooser.choose(Runner("no-such-ffmpeg")), fastest);
+}
@@ -0,0 +1,118 @@
+#include "ffmpeg/preview_store.hpp"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+
+#include "hash.hpp"
+#include "string_utils.hpp"
+#include "util.hpp"
+
+#if defined(APP_OS_WINDOWS)
+#include <Windows.h>
+#include <process.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr auto PREVIEW_DIR = "previews";
+	std::atomic_int reserved = 0;
+
+	bool isRunning(int pid) {
+#if defined(APP_OS_WINDOWS)
+		auto* h = OpenProcess(
+			PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+		if (h == nullptr) { return false; }
+		DWORD code = 0;
+		const auto running =
+			GetExitCodeProcess(h, &code) != 0 && code == STILL_ACTIVE;
+		CloseHandle(h);
+		return running;
+#else
+		return kill(pid, 0) == 0 || errno == EPERM;
+#endif
+	}
+
+	// Process that created a temp file, named "<name>-<pid>-<n>". Older
+	// versions used "temp<pid * 1000 + n>.mkv" and "render<pid * 1000 + n>".
+	std::optional<int> owner(const fs::path& p) {
+		const auto name = p.filename().string();
+		int pid = 0;
+		if (auto parts = str::split(name, '-'); parts.size() >= 3) {
+			if (str::stoi(parts[1], pid)) { return pid; }
+			return {};
+		}
+		for (auto prefix : {"temp", "render"}) {
+			if (!str::starts_with(name, prefix)) { continue; }
+			auto rest = std::string_view(name).substr(strlen(prefix));
+			auto number = str::split(rest, '.')[0];
+			if (long long n = 0; str::stoi(number, n)) {
+				return static_cast<int>(n / 1000);
+			}
+		}
+		return {};
+	}
+
+	void removeOrphans(const fs::path& dir, bool recurse) {
+		std::error_code err;
+		for (const auto& entry : fs::directory_iterator(dir, err)) {
+			const auto& p = entry.path();
+			if (recurse && p.filename() == PREVIEW_DIR) {
+				removeOrphans(p, false);
+				continue;
+			}
+			auto pid = owner(p);
+			if (!pid.has_value() || isRunning(pid.value())) { continue; }
+			SPDLOG_INFO("Removing orphaned {}", p.string());
+			fs::remove_all(p, err);
+		}
+	}
+}  // namespace
+
+void scavengeTempFiles(const fs::path& root) { removeOrphans(root, true); }
+
+PreviewStore::PreviewStore(const fs::path& root, std::uintmax_t budget)
+	: cache(root / PREVIEW_DIR, budget) {
+	scavengeTempFiles(root);
+}
+
+std::string PreviewStore::key(const Command& cmd, const Segment& window) {
+	Hasher h;
+	h.add(cmd.inputs.size());
+	for (const auto& i : cmd.inputs) { h.addFile(i); }
+	h.add(cmd.filter);
+	h.add(cmd.outputs.size());
+	for (const auto& o : cmd.outputs) { h.add(o); }
+	h.add(cmd.encoder.size());
+	for (const auto& e : cmd.encoder) { h.add(e); }
+	// Thread counts are left out, they don't change the output
+	h.add(window.start).add(window.duration);
+	return h.hex() + ".mkv";
+}
+
+std::optional<fs::path> PreviewStore::find(std::string_view key) const {
+	if (!cache.contains(key)) { return {}; }
+	return cache.find(key);
+}
+
+fs::path PreviewStore::reserve(std::string_view key) const {
+	return cache.path(fmt::format(
+		"{}-{}-{}.part", str::split(key, '.')[0], getpid(), ++reserved));
+}
+
+bool PreviewStore::insert(std::string_view key, const fs::path& file) {
+	std::lock_guard lock(mutex);
+	return cache.insert(key, file);
+}
+
+void PreviewStore::setBudget(std::uintmax_t bytes) {
+	std::lock_guard lock(mutex);
+	cache.setBudget(bytes);
+}
@@ -0,0 +1,76 @@
+#include "ffmpeg/preview_store.hpp"
+
+#include <gtest/gtest.h>
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <string>
+
+#include "util.hpp"
+
+#if defined(APP_OS_WINDOWS)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+	// Far above any real pid, so it never belongs to a running process
+	constexpr auto DEAD_PID = 999999999;
+}  // namespace
+
+class PreviewStoreTest : public ::testing::Test {
+   protected:
+	fs::path root =
+		fs::temp_directory_path() / "ffmpeg_node_editor_preview_test";
+
+	void SetUp() override {
+		fs::remove_all(root);
+		fs::create_directories(root / "previews");
+	}
+	void TearDown() override { fs::remove_all(root); }
+
+	fs::path touch(const fs::path& p) {
+		std::ofstream(p, std::ios_base::binary) << "x";
+		return p;
+	}
+};
+
+TEST_F(PreviewStoreTest, scavenge) {
+	const auto alive = root / fmt::format("render-{}-1", getpid());
+	const auto dead = root / fmt::format("render-{}-1", DEAD_PID);
+	fs::create_directories(alive);
+	fs::create_directories(dead);
+	const auto legacy = touch(root / fmt::format("temp{}000.mkv", DEAD_PID));
+	const auto part =
+		touch(root / "previews" / fmt::format("abc-{}-2.part", DEAD_PID));
+	const auto kept = touch(root / "previews" / "abc.mkv");
+
+	PreviewStore store(root, PreviewStore::DEFAULT_BUDGET);
+	EXPECT_TRUE(fs::exists(alive));
+	EXPECT_FALSE(fs::exists(dead));
+	EXPECT_FALSE(fs::exists(legacy));
+	EXPECT_FALSE(fs::exists(part));
+	EXPECT_TRUE(fs::exists(kept));
+}
+
+TEST_F(PreviewStoreTest, replay) {
+	PreviewStore store(root, PreviewStore::DEFAULT_BUDGET);
+	Command cmd{{}, "testsrc", {}};
+	const auto key = PreviewStore::key(cmd, {0, 0});
+	EXPECT_EQ(store.find(key), std::nullopt);
+
+	const auto file = touch(store.reserve(key));
+	EXPECT_TRUE(store.insert(key, file));
+	EXPECT_TRUE(store.find(key).has_value());
+
+	// Same output with other thread counts, another with a new filter
+	cmd.threads = {2, 2, 2};
+	EXPECT_EQ(PreviewStore::key(cmd, {0, 0}), key);
+	EXPECT_NE(PreviewStore::key(cmd, {1, 0}), key);
+	cmd.filter = "testsrc=size=320x240";
+	EXPECT_NE(PreviewStore::key(cmd, {0, 0}), key);
+}
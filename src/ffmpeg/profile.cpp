@@ -8,7 +8,7 @@
 
 #include "ffmpeg/filter.hpp"
 #include "file_utils.hpp"
-#include "pref.hpp"
+#include "paths.hpp"
 #include "string_utils.hpp"
 #include "util.hpp"
 
@@ -287,14 +287,28 @@ const std::vector<Option> OutputNodeOptions = {
 	{"filename", "path to output", "string"},
 };
 
-Profile GetProfile() {
-	Runner runner;
+Profile GetProfile(
+	std::shared_ptr<RunnerBackend> backend, const JobLimits& limits) {
+	Runner runner("ffmpeg", std::move(backend));
+	runner.setLimits(limits);
 	if (runner.lineScanner({"-version"}, nullptr) != 0) {
 		showErrorMessage("Error", "Failed to run ffmpeg");
 		throw std::invalid_argument("Failed to run ffmpeg");
 	}
 
 	Profile profile(runner);
+	profile.proxies =
+		std::make_shared<ProxyCache>(runner, path.appDir / "proxy_cache");
+	profile.renders =
+		std::make_shared<RenderCache>(runner, path.appDir / "render_cache");
+	profile.tuner =
+		std::make_shared<ThreadTuner>(path.appDir / "thread_tuning.json");
+	profile.previews = std::make_shared<PreviewStore>(
+		tempDirectory(), PreviewStore::DEFAULT_BUDGET);
+	profile.validator = std::make_shared<Validator>();
+	profile.thumbnails = std::make_shared<ThumbnailCache>();
+	profile.waveforms = std::make_shared<WaveformCache>();
+	profile.encodings = std::make_shared<EncodingChooser>();
 
 	try {
 		auto json =
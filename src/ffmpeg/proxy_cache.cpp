@@ -0,0 +1,156 @@
+#include "ffmpeg/proxy_cache.hpp"
+
+#include <fmt/format.h>
+
+#include <utility>
+
+#include "hash.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+ProxyCache::ProxyCache(Runner r, fs::path dir)
+	: runner(std::move(r)),
+	  cache(std::move(dir), 0),
+	  worker([this] { work(); }) {}
+
+ProxyCache::~ProxyCache() {
+	stop = true;
+	cv.notify_all();
+	worker.join();
+}
+
+void ProxyCache::configure(bool enable, std::uintmax_t budget) {
+	std::lock_guard lock(mutex);
+	if (enable != enabled) { SPDLOG_INFO("proxy cache enabled = {}", enable); }
+	enabled = enable;
+	cache.setBudget(budget);
+}
+
+std::optional<std::string> ProxyCache::proxyKey(const fs::path& input) {
+	std::error_code err;
+	if (input.empty() || !fs::is_regular_file(input, err)) {
+		return std::nullopt;
+	}
+	return Hasher().addFile(input).hex() + ".mkv";
+}
+
+void ProxyCache::request(const fs::path& input) {
+	if (const auto key = proxyKey(input)) { request(input, *key); }
+}
+
+void ProxyCache::request(const fs::path& input, const std::string& key) {
+	{
+		std::lock_guard lock(mutex);
+		if (!enabled || states.contains(key)) { return; }
+		if (cache.contains(key)) {
+			states[key] = ProxyState::Ready;
+			return;
+		}
+		states[key] = ProxyState::Pending;
+		queue.push_back(input);
+	}
+	cv.notify_one();
+}
+
+ProxyState ProxyCache::state(const std::string& key) {
+	std::lock_guard lock(mutex);
+	auto it = states.find(key);
+	return it == states.end() ? ProxyState::None : it->second;
+}
+
+std::optional<fs::path> ProxyCache::find(const fs::path& input) {
+	const auto key = proxyKey(input);
+	if (!key) { return std::nullopt; }
+	std::lock_guard lock(mutex);
+	if (!enabled) { return std::nullopt; }
+	auto proxy = cache.find(*key);
+	// Evicted entries are generated again on the next request, those too
+	// large to keep are not
+	if (auto it = states.find(*key);
+		!proxy && it != states.end() && it->second == ProxyState::Ready) {
+		states.erase(it);
+	}
+	return proxy;
+}
+
+void ProxyCache::work() {
+	while (true) {
+		fs::path input;
+		{
+			std::unique_lock lock(mutex);
+			cv.wait(lock, [this] { return stop || !queue.empty(); });
+			if (stop) { return; }
+			input = std::move(queue.front());
+			queue.pop_front();
+		}
+		const auto key = proxyKey(input);
+		if (!key) { continue; }
+
+		const auto state = transcode(input, *key);
+
+		std::lock_guard lock(mutex);
+		states[*key] = state;
+	}
+}
+
+ProxyState ProxyCache::transcode(
+	const fs::path& input, const std::string& key) {
+	std::error_code err;
+	fs::create_directories(cache.directory(), err);
+	const auto part = cache.path(key + ".part");
+
+	// Sockets refer to streams by index, so the proxy must keep every one
+	for (const auto& stream : runner.getInfo(input).streams) {
+		if (stream.type != "video" && stream.type != "audio" &&
+			stream.type != "subtitle") {
+			SPDLOG_INFO(
+				"no proxy for {}, it has {} streams", input.string(),
+				stream.type);
+			return ProxyState::Failed;
+		}
+	}
+
+	SPDLOG_INFO("generating proxy for {}", input.string());
+	// MJPEG is intra-only, so seeking into the proxy is cheap
+	auto [status, msg] = runner.run(
+		{"-hide_banner",
+		 "-v",
+		 "error",
+		 "-i",
+		 input.string(),
+		 "-map",
+		 "0",
+		 "-vf",
+		 fmt::format("scale=w=-2:h='min({},ih)'", HEIGHT),
+		 "-c:v",
+		 "mjpeg",
+		 "-q:v",
+		 "5",
+		 "-c:a",
+		 "pcm_s16le",
+		 "-c:s",
+		 "copy",
+		 "-f",
+		 "matroska",
+		 "-y",
+		 part.string()},
+		&stop, true);
+	if (status != 0) {
+		if (!stop) {
+			SPDLOG_ERROR("proxy failed for {}: {}", input.string(), msg);
+		}
+		fs::remove(part, err);
+		return ProxyState::Failed;
+	}
+
+	std::lock_guard lock(mutex);
+	if (const auto size = fs::file_size(part, err); !err && !cache.fits(size)) {
+		SPDLOG_WARN(
+			"proxy for {} is {} bytes, more than the proxy cache holds",
+			input.string(), size);
+		fs::remove(part, err);
+		return ProxyState::TooLarge;
+	}
+	return cache.insert(key, part) ? ProxyState::Ready : ProxyState::Failed;
+}
@@ -0,0 +1,181 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ffmpeg/runner_backend.hpp"
+#include "log_buffer.hpp"
+#include "stream_socket.hpp"
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace {
+	// Receives the output of a job started on a worker, see Worker for the
+	// protocol
+	class RemoteJob : public RunnerJob {
+		StreamSocket socket;
+		std::vector<std::string> args;	// for the process log
+		std::thread receiver;
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::string out, err;
+		// err only feeds readLines, readStdErr returns the bounded log
+		LogBuffer errLog;
+		bool done = false;
+		int status = -1;
+		static constexpr size_t ERR_LIMIT = 1024 * 1024;
+
+		void receive() {
+			// Workers are trusted, and a line of binary output can be long
+			std::string line;
+			while (socket.readLine(line, std::string::npos)) {
+				nlohmann::json msg;
+				try {
+					msg = nlohmann::json::parse(line);
+				} catch (nlohmann::json::exception& e) {
+					SPDLOG_ERROR("bad message from worker: {}", e.what());
+					break;
+				}
+				std::lock_guard lock(mutex);
+				if (auto itr = msg.find("stdout"); itr != msg.end()) {
+					out += itr->get<std::string>();
+				} else if (auto itr = msg.find("stderr"); itr != msg.end()) {
+					const auto& data = itr->get_ref<const std::string&>();
+					errLog.append(data);
+					err += data;
+					if (err.size() > ERR_LIMIT) {
+						err.erase(0, err.size() - ERR_LIMIT);
+					}
+				} else if (auto itr = msg.find("exit"); itr != msg.end()) {
+					status = itr->get<int>();
+					break;
+				}
+				changed.notify_all();
+			}
+			socket.shutdown();
+			std::lock_guard lock(mutex);
+			done = true;
+			changed.notify_all();
+		}
+
+		std::string readAll(std::string& stream) {
+			std::unique_lock lock(mutex);
+			changed.wait(lock, [this] { return done; });
+			return std::exchange(stream, {});
+		}
+
+	   public:
+		RemoteJob(StreamSocket s, std::vector<std::string> a)
+			: socket(std::move(s)), args(std::move(a)) {
+			receiver = std::thread([this] { receive(); });
+		}
+		RemoteJob(const RemoteJob&) = delete;
+		RemoteJob(RemoteJob&&) = delete;
+		RemoteJob& operator=(RemoteJob&&) = delete;
+		RemoteJob& operator=(const RemoteJob&) = delete;
+
+		~RemoteJob() override {
+			terminate();
+			receiver.join();
+		}
+
+		bool isRunning() override {
+			std::lock_guard lock(mutex);
+			return !done;
+		}
+
+		// Dropping the connection makes the worker kill the process
+		void stop(StopLevel level) override {
+			if (level == StopLevel::Kill) {
+				socket.shutdown();
+				return;
+			}
+			const nlohmann::json msg{{"stop", static_cast<int>(level)}};
+			(void)socket.send(msg.dump() + "\n");
+		}
+
+		int finish() override {
+			std::unique_lock lock(mutex);
+			changed.wait(lock, [this] { return done; });
+			return status;
+		}
+
+		std::string readStdOut() override { return readAll(out); }
+		std::string readStdErr() override {
+			(void)finish();
+			auto text = errLog.str();
+			logProcess(args, text);
+			return text;
+		}
+
+		void readLines(
+			const LineScannerCallback& cb, bool readStdErr) override {
+			auto& stream = readStdErr ? err : out;
+			for (;;) {
+				std::unique_lock lock(mutex);
+				changed.wait(lock, [&] {
+					return done || stream.find('\n') != std::string::npos;
+				});
+				const auto idx = stream.find('\n');
+				if (idx == std::string::npos) {
+					auto rest = std::exchange(stream, {});
+					lock.unlock();
+					if (!rest.empty()) { cb(rest); }
+					return;
+				}
+				auto line = stream.substr(0, idx);
+				stream.erase(0, idx + 1);
+				lock.unlock();
+				if (!cb(line)) { return; }
+			}
+		}
+
+		void readChunks(
+			const std::function<bool(std::string_view)>& cb) override {
+			for (;;) {
+				std::unique_lock lock(mutex);
+				changed.wait(lock, [&] { return done || !out.empty(); });
+				if (out.empty()) { return; }
+				auto chunk = std::exchange(out, {});
+				lock.unlock();
+				if (!cb(chunk)) { return; }
+			}
+		}
+	};
+}  // namespace
+
+std::string workerToken() {
+	const auto* token = std::getenv("FFMPEG_NODE_EDITOR_TOKEN");
+	return token == nullptr ? "" : token;
+}
+
+RemoteBackend::RemoteBackend(std::string_view workers, std::string secret)
+	: token(std::move(secret)) {
+	for (auto address : str::split(workers, ',')) {
+		address = str::strip(address);
+		if (!address.empty()) { addresses.emplace_back(address); }
+	}
+}
+
+std::unique_ptr<RunnerJob> RemoteBackend::start(
+	const std::vector<std::string>& args, bool lowPriority) {
+	// Round robin, skipping workers that can't be reached
+	StreamSocket socket;
+	const auto first = next++;
+	for (auto i = 0U; i < addresses.size() && !socket.valid(); ++i) {
+		const auto& address = addresses[(first + i) % addresses.size()];
+		socket = StreamSocket::connect(address);
+		if (!socket.valid()) {
+			SPDLOG_ERROR("unable to connect to worker at {}", address);
+		}
+	}
+	if (!socket.valid()) { return nullptr; }
+	const nlohmann::json request{
+		{"token", token}, {"args", args}, {"low_priority", lowPriority}};
+	if (!socket.send(request.dump() + "\n")) { return nullptr; }
+	return std::make_unique<RemoteJob>(std::move(socket), args);
+}
@@ -0,0 +1,87 @@
+#include "ffmpeg/render_cache.hpp"
+
+#include <fmt/format.h>
+
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	std::string cacheKey(std::uint64_t fingerprint) {
+		return fmt::format("{:016x}.mkv", fingerprint);
+	}
+}  // namespace
+
+RenderCache::RenderCache(Runner r, fs::path dir)
+	: runner(std::move(r)),
+	  cache(std::move(dir), 0),
+	  worker([this] { work(); }) {}
+
+RenderCache::~RenderCache() {
+	stop = true;
+	cv.notify_all();
+	worker.join();
+}
+
+void RenderCache::configure(bool enable, std::uintmax_t budget) {
+	std::lock_guard lock(mutex);
+	if (enable != enabled) { SPDLOG_INFO("render cache enabled = {}", enable); }
+	enabled = enable;
+	cache.setBudget(budget);
+}
+
+bool RenderCache::isEnabled() {
+	std::lock_guard lock(mutex);
+	return enabled;
+}
+
+void RenderCache::request(std::uint64_t fingerprint, Command cmd) {
+	auto key = cacheKey(fingerprint);
+	{
+		std::lock_guard lock(mutex);
+		if (!enabled || pending.contains(key) || cache.contains(key)) {
+			return;
+		}
+		pending.insert(key);
+		// FFV1 and PCM are lossless and cheap to decode. Every frame is a
+		// keyframe so seeking into the cached file stays exact.
+		cmd.encoder = {"-c:v", "ffv1", "-level", "3", "-g", "1", "-c:a",
+					   "pcm_f32le", "-f", "matroska"};
+		queue.emplace_back(std::move(key), std::move(cmd));
+	}
+	cv.notify_one();
+}
+
+std::optional<fs::path> RenderCache::find(std::uint64_t fingerprint) {
+	std::lock_guard lock(mutex);
+	if (!enabled) { return std::nullopt; }
+	return cache.find(cacheKey(fingerprint));
+}
+
+void RenderCache::work() {
+	while (true) {
+		std::pair<std::string, Command> job;
+		{
+			std::unique_lock lock(mutex);
+			cv.wait(lock, [this] { return stop || !queue.empty(); });
+			if (stop) { return; }
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+		const auto& [key, cmd] = job;
+		const auto part = cache.path(key + ".part");
+
+		SPDLOG_INFO("caching intermediate {}", key);
+		auto [status, msg] = runner.encode(cmd, part, &stop, true);
+
+		std::lock_guard lock(mutex);
+		pending.erase(key);
+		if (status != 0) {
+			if (!stop) { SPDLOG_ERROR("caching {} failed: {}", key, msg); }
+			std::error_code err;
+			fs::remove(part, err);
+			continue;
+		}
+		(void)cache.insert(key, part);
+	}
+}
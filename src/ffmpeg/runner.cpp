@@ -3,217 +3,900 @@
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
-#include <subprocess.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <thread>
 #include <vector>
 
+#include "ffmpeg/preview_store.hpp"
+#include "frame_ring.hpp"
 #include "string_utils.hpp"
 #include "util.hpp"
 
+#if defined(APP_OS_WINDOWS)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(APP_OS_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 using namespace std::chrono_literals;
 
 namespace {
 	const int PID = getpid();
 	std::atomic_int filename_index = 0;
 
-	auto convertArgs(const std::vector<std::string>& args) {
-		std::vector<const char*> result;
-		result.reserve(args.size() + 1);
-		for (const auto& e : args) { result.push_back(e.data()); }
-		result.push_back(nullptr);
-		return result;
-	}
+	// Hard limit for graphs without any file inputs, in seconds
+	constexpr auto LAVFI_DURATION_LIMIT = 300;
 
-}  // namespace
+	// Seconds of the inputs read for thumbnails, nodes without a frame in
+	// it get none
+	constexpr auto THUMBNAIL_WINDOW = 2;
+
+	// Guess for the output rate of generated sources, in bytes per second
+	constexpr std::uintmax_t GENERATED_RATE = 1024 * 1024;
+
+	std::atomic<std::uintmax_t> memoryInUse = 0;
+	std::atomic_bool shuttingDown = false;	// see Runner::shutdown
+
+	// Time each step of stopping a job gets before the next, see StopLevel
+	constexpr auto STOP_GRACE = 3s;
+
+	// Enforces JobLimits and cancel on a job from a thread of its own, so
+	// the caller can block on something else meanwhile. Stalls are read
+	// from the -progress output on stdout. The job is killed if it is still
+	// running when the watchdog goes away.
+	class Watchdog {
+		using clock = std::chrono::steady_clock;
+
+		RunnerJob& job;
+		const JobLimits limits;
+		const bool watchStall;
+		const std::atomic_bool* cancel;
+		const clock::time_point started = clock::now();
+		std::atomic<clock::rep> progressed;	 // ticks of the last new frame
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool done = false;
+		std::string reason;	 // why the job is being stopped
+
+		std::thread reader, monitor;
+
+		void readProgress() {
+			std::string frame, outTime;
+			job.readLines(
+				[&](std::string_view line) {
+					auto advance = [&](std::string_view key, std::string& v) {
+						if (!str::starts_with(line, key)) { return; }
+						const auto value = line.substr(key.size());
+						if (value == v) { return; }
+						v = value;
+						progressed = clock::now().time_since_epoch().count();
+					};
+					// Audio only outputs don't count frames
+					advance("frame=", frame);
+					advance("out_time_us=", outTime);
+					return true;
+				},
+				false);
+		}
+
+		[[nodiscard]] std::string overrun(clock::time_point now) const {
+			const auto seconds = [](clock::duration d) {
+				return std::chrono::duration<double>(d).count();
+			};
+			if (cancel != nullptr && cancel->load()) { return "cancelled"; }
+			if (limits.timeout > 0 && seconds(now - started) > limits.timeout) {
+				return fmt::format("timed out after {}s", limits.timeout);
+			}
+			const clock::time_point last{clock::duration(progressed.load())};
+			if (watchStall && limits.stallTimeout > 0 &&
+				seconds(now - last) > limits.stallTimeout) {
+				return fmt::format(
+					"stalled, no new frame for {}s", limits.stallTimeout);
+			}
+			return "";
+		}
+
+		void watch() {
+			using namespace std::chrono_literals;
+			std::unique_lock lock(mutex);
+			std::optional<StopLevel> level;
+			clock::time_point escalated;
+			while (!wake.wait_for(lock, 100ms, [this] { return done; }) &&
+				   job.isRunning()) {
+				const auto now = clock::now();
+				if (!level.has_value()) {
+					reason = overrun(now);
+					if (reason.empty()) { continue; }
+					SPDLOG_WARN("job {}, stopping it", reason);
+					level = shuttingDown ? StopLevel::Kill : StopLevel::Quit;
+				} else if (shuttingDown && level != StopLevel::Kill) {
+					level = StopLevel::Kill;
+				} else if (
+					now - escalated < STOP_GRACE ||
+					level == StopLevel::Kill) {
+					continue;
+				} else {
+					level = static_cast<StopLevel>(static_cast<int>(*level) + 1);
+				}
+				job.stop(*level);
+				escalated = now;
+			}
+		}
 
-class Process {
-	subprocess_s process;
-	int status;
-	static constexpr auto BUFFER_SIZE = 4096u;
+	   public:
+		// progress tells if the job writes -progress to stdout
+		Watchdog(
+			RunnerJob& j, const JobLimits& l, bool progress,
+			const std::atomic_bool* c = nullptr)
+			: job(j),
+			  limits(l),
+			  watchStall(progress),
+			  cancel(c),
+			  progressed(started.time_since_epoch().count()) {
+			if (progress) { reader = std::thread([this] { readProgress(); }); }
+			if (limits.timeout > 0 || limits.stallTimeout > 0 ||
+				cancel != nullptr) {
+				monitor = std::thread([this] { watch(); });
+			}
+		}
+		Watchdog(const Watchdog&) = delete;
+		Watchdog& operator=(const Watchdog&) = delete;
 
-	static std::string readStream(std::FILE* file) {
-		std::string buffer(BUFFER_SIZE, '\0'), str;
-		for (; std::fgets(buffer.data(), buffer.size(), file) != nullptr;) {
-			str += buffer.substr(0, buffer.find_first_of('\0'));
-			std::ranges::fill(buffer, '\0');
+		~Watchdog() {
+			{
+				std::lock_guard lock(mutex);
+				done = true;
+			}
+			wake.notify_all();
+			if (monitor.joinable()) { monitor.join(); }
+			job.terminate();
+			if (reader.joinable()) { reader.join(); }
 		}
-		return str;
+
+		// Empty unless the job went over a limit or was cancelled
+		[[nodiscard]] std::string stopReason() {
+			std::lock_guard lock(mutex);
+			return reason;
+		}
+	};
+
+	// Adds -progress output for a Watchdog, unless args already have it
+	bool watchProgress(std::vector<std::string>& args, const JobLimits& l) {
+		if (l.stallTimeout <= 0 || contains(args, "-progress")) {
+			return false;
+		}
+		args.insert(args.begin(), {"-progress", "pipe:1"});
+		return true;
 	}
 
-   public:
-	Process() = default;
-	Process(const Process&) = delete;
-	Process(Process&&) = delete;
-	Process& operator=(Process&&) = delete;
-	Process& operator=(const Process&) = delete;
+	// Preview output in an anonymous file in RAM. Processes started while
+	// it is inheritable reach it at the same /proc/self/fd path.
+	class MemoryFile {
+		int fd;
+		std::uintmax_t reserved;
+
+	   public:
+		MemoryFile(int f, std::uintmax_t size) : fd(f), reserved(size) {}
+		MemoryFile(const MemoryFile&) = delete;
+		MemoryFile& operator=(const MemoryFile&) = delete;
+
+		~MemoryFile() {
+#if defined(APP_OS_LINUX)
+			close(fd);
+#endif
+			memoryInUse -= reserved;
+		}
+
+		// nullptr if size doesn't fit in what is left of budget. Up to
+		// twice size is reserved if it fits, as size is an estimate.
+		static std::unique_ptr<MemoryFile> create(
+			std::uintmax_t size, std::uintmax_t budget) {
+#if defined(APP_OS_LINUX)
+			auto used = memoryInUse.load();
+			std::uintmax_t reserve = 0;
+			do {
+				if (used + size > budget) { return nullptr; }
+				reserve = std::min(budget - used, size * 2);
+			} while (!memoryInUse.compare_exchange_weak(used, used + reserve));
+			const auto fd = memfd_create("ffmpeg_node_editor", MFD_CLOEXEC);
+			if (fd < 0) {
+				memoryInUse -= reserve;
+				return nullptr;
+			}
+			return std::make_unique<MemoryFile>(fd, reserve);
+#else
+			(void)size;
+			(void)budget;
+			return nullptr;
+#endif
+		}
+
+		[[nodiscard]] std::filesystem::path path() const {
+			return fmt::format("/proc/self/fd/{}", fd);
+		}
+
+		// Bytes the file may grow to, ffmpeg is told to stop writing there
+		[[nodiscard]] std::uintmax_t limit() const { return reserved; }
 
-	~Process() {
-		if (isRunning()) { subprocess_terminate(&process); }
-		finish();
-		subprocess_destroy(&process);
+		// Every process started meanwhile inherits the file. Callers hold
+		// LocalBackend::spawnMutex till it is disabled again, so only the
+		// processes meant to get it are started.
+		void inherit(bool enable) const {
+#if defined(APP_OS_LINUX)
+			fcntl(fd, F_SETFD, enable ? 0 : FD_CLOEXEC);
+#else
+			(void)enable;
+#endif
+		}
+	};
+
+	// Filter of cmd with its generated sources moved to start, where
+	// -copyts leaves the seeked inputs. The first use of a source label is
+	// the source itself, it is renamed to feed a setpts writing the label.
+	std::string shiftSources(const Command& cmd, double start) {
+		auto filter = cmd.filter;
+		auto shift = [&](const std::string& label, std::string_view setpts) {
+			const auto pos = filter.find(label);
+			if (pos == std::string::npos) { return; }
+			const auto moved = label.substr(0, label.size() - 1) + "g]";
+			filter.replace(pos, label.size(), moved);
+			fmt::format_to(
+				std::back_inserter(filter), ";{}{}=PTS+{}/TB{}", moved, setpts,
+				start, label);
+		};
+		for (const auto& label : cmd.videoSources) { shift(label, "setpts"); }
+		for (const auto& label : cmd.audioSources) { shift(label, "asetpts"); }
+		return filter;
 	}
 
-	bool start(const std::vector<std::string>& args, int options) {
-		auto aargs = convertArgs(args);
-		status = subprocess_create(aargs.data(), options, &process);
-		return status == 0;
+	// Arguments for running cmd over segment of its inputs. Inputs marked
+	// as not seekable (eg images) are always fed whole, with -copyts they
+	// and the generated sources are moved to start with the rest.
+	std::vector<std::string> commandArgs(
+		const Command& cmd, const std::vector<bool>& seekable,
+		const Segment& segment, bool copyts) {
+		std::vector<std::string> args{
+			"-hide_banner", "-v", "error"};
+		if (copyts) { args.emplace_back("-copyts"); }
+		const auto& threads = cmd.threads;
+		if (threads.filterThreads > 0) {
+			args.insert(
+				args.end(),
+				{"-filter_threads", std::to_string(threads.filterThreads)});
+		}
+		if (threads.filterComplexThreads > 0) {
+			args.insert(
+				args.end(), {"-filter_complex_threads",
+							 std::to_string(threads.filterComplexThreads)});
+		}
+		if (cmd.inputs.empty()) {
+			args.insert(args.end(), {"-f", "lavfi", "-i", "nullsrc"});
+		}
+		for (auto i = 0U; i < cmd.inputs.size(); ++i) {
+			// Input side seeking, so start is reached without decoding
+			if (seekable[i] && segment.start > 0) {
+				args.insert(
+					args.end(), {"-ss", fmt::format("{}", segment.start)});
+			}
+			if (seekable[i] && segment.duration > 0) {
+				args.insert(
+					args.end(), {"-t", fmt::format("{}", segment.duration)});
+			}
+			if (!seekable[i] && copyts && segment.start > 0) {
+				args.insert(
+					args.end(),
+					{"-itsoffset", fmt::format("{}", segment.start)});
+			}
+			if (threads.threads > 0) {
+				args.insert(
+					args.end(), {"-threads", std::to_string(threads.threads)});
+			}
+			args.insert(args.end(), {"-i", cmd.inputs[i]});
+		}
+		if (!cmd.filter.empty()) {
+			const auto shift =
+				copyts && segment.start > 0 && !cmd.inputs.empty();
+			args.insert(
+				args.end(),
+				{"-filter_complex",
+				 shift ? shiftSources(cmd, segment.start) : cmd.filter});
+		}
+		for (const auto& o : cmd.outputs) {
+			args.insert(args.end(), {"-map", o});
+		}
+		if (threads.threads > 0) {
+			args.insert(
+				args.end(), {"-threads", std::to_string(threads.threads)});
+		}
+		args.insert(args.end(), cmd.encoder.begin(), cmd.encoder.end());
+		if (cmd.inputs.empty()) {
+			// Generated sources can't be seeked, they have to be rendered
+			// from zero and dropped till start
+			if (segment.start > 0) {
+				args.insert(
+					args.end(), {"-ss", fmt::format("{}", segment.start)});
+			}
+			if (segment.duration > 0) {
+				args.insert(
+					args.end(), {"-t", fmt::format("{}", segment.duration)});
+			} else if (!contains(cmd.encoder, std::string("-t"))) {
+				// If input is empty add a hard limit of 5 min for now,
+				// unless the encoder limits the output itself
+				args.insert(
+					args.end(),
+					{"-t", std::to_string(LAVFI_DURATION_LIMIT)});
+			}
+		}
+		return args;
 	}
 
-	bool isRunning() { return subprocess_alive(&process) != 0; }
-	bool failed() {
-		if (isRunning()) { return false; }
-		finish();
-		return status != 0;
+	// Rough size of a preview, factor times the size of the inputs read
+	std::uintmax_t estimateSize(
+		const Command& cmd, const std::vector<double>& durations,
+		const Segment& window, double factor) {
+		if (cmd.inputs.empty()) {
+			const auto seconds =
+				window.duration > 0 ? window.duration : LAVFI_DURATION_LIMIT;
+			return static_cast<std::uintmax_t>(
+				seconds * factor * GENERATED_RATE);
+		}
+		std::uintmax_t total = 0;
+		for (auto i = 0U; i < cmd.inputs.size(); ++i) {
+			std::error_code err;
+			auto size = std::filesystem::file_size(cmd.inputs[i], err);
+			if (err) { return std::numeric_limits<std::uintmax_t>::max(); }
+			auto share = factor;
+			if (window.duration > 0 && durations[i] > window.duration) {
+				share *= window.duration / durations[i];
+			}
+			total += static_cast<std::uintmax_t>(
+				static_cast<double>(size) * share);
+		}
+		return total;
 	}
 
-	void finish() { subprocess_join(&process, &status); }
-	auto getStdErr() { return readStream(subprocess_stderr(&process)); }
-	auto getStdOut() { return readStream(subprocess_stdout(&process)); }
-	[[nodiscard]] auto returnCode() const { return status; }
+	// Blocks till the user closes the player, or cancel is set. started is
+	// called once the player is running.
+	std::pair<int, std::string> openPlayer(
+		const std::string& player, const std::filesystem::path& file,
+		const std::atomic_bool* cancel,
+		const std::function<void()>& started = nullptr) {
+#if defined(APP_OS_WINDOWS)
+		std::vector<std::string> player_args{"cmd", "/C", "start"};
+#else
+		std::vector<std::string> player_args{};
+#endif
+		for (auto& elem : str::split(player, '\n')) {
+			if (elem == "%f") {
+				player_args.emplace_back(file.string());
+			} else {
+				player_args.emplace_back(str::strip(elem));
+			}
+		}
 
-	void lineReader(const LineScannerCallback& cb, bool readStdErr) {
-		auto reader = subprocess_read_stdout;
-		if (readStdErr) { reader = subprocess_read_stderr; }
+		SPDLOG_DEBUG("player args: {}", player_args);
 
-		std::string incompleteLine, buffer(BUFFER_SIZE, '\0');
-		for (auto read = reader(&process, buffer.data(), buffer.size());
-			 read > 0; read = reader(&process, buffer.data(), buffer.size())) {
-			auto data = std::string_view(buffer);
-			for (auto idx = data.find_first_of('\n');
-				 idx != std::string_view::npos;
-				 idx = data.find_first_of('\n')) {
-				incompleteLine += data.substr(0, idx);
-				if (!cb(incompleteLine)) { return; }
+		// The player shows a window here, wherever ffmpeg ran
+		auto player_process = LocalBackend().start(player_args);
+		if (started != nullptr) { started(); }
+		if (player_process == nullptr) {
+			return {-1, "failed to start player"};
+		}
+
+		const Watchdog watchdog(*player_process, {0, 0}, false, cancel);
+		auto err = player_process->readStdErr();
+		return {player_process->finish(), err};
+	}
+
+	std::string escapeConcatPath(const std::filesystem::path& p) {
+		std::string result;
+		for (const auto& ch : p.string()) {
+			if (ch == '\'') {
+				result += R"('\'')";
+			} else {
+				result.push_back(ch);
 			}
 		}
+		return result;
 	}
-};
 
-int Runner::lineScanner(
-	std::vector<std::string> args, const LineScannerCallback& cb,
-	bool readStdErr) const {
-	Process process{};
+}  // namespace
 
-	args.insert(args.begin(), path.string());
+std::filesystem::path tempDirectory() {
+	return std::filesystem::temp_directory_path() / "ffmpeg_node_editor";
+}
 
-	if (!process.start(
-			args, subprocess_option_enable_async |
-					  subprocess_option_search_user_path)) {
-		return process.returnCode();
-	}
+std::unique_ptr<RunnerJob> Runner::start(
+	std::vector<std::string> args, bool lowPriority) const {
+	args.insert(args.begin(), path.string());
+	SPDLOG_DEBUG("ffmpeg start: \"{}\"", fmt::join(args, " "));
+	return backend->start(args, lowPriority);
+}
 
-	if (cb == nullptr) {
-		process.finish();
-		return process.returnCode();
-	}
+void Runner::shutdown() { shuttingDown = true; }
 
-	process.lineReader(cb, readStdErr);
+int Runner::lineScanner(
+	std::vector<std::string> args, const LineScannerCallback& cb,
+	bool readStdErr) const {
+	auto job = start(std::move(args));
+	if (job == nullptr) { return -1; }
 
-	process.finish();
+	if (cb != nullptr) { job->readLines(cb, readStdErr); }
 
-	return process.returnCode();
+	return job->finish();
 }
 
 std::pair<int, std::string> Runner::play(
 	const std::vector<std::string>& inputs, std::string_view filter,
 	const std::vector<std::string>& outputs, const std::string& player) const {
-	namespace fs = std::filesystem;
-
-	const auto tempPath =
-		fs::temp_directory_path() / "ffmpeg_node_editor" /
-		fmt::format("temp{}.mkv", PID * 1000 + (++filename_index));
+	return play({inputs, std::string(filter), outputs}, player);
+}
 
-	fs::create_directories(tempPath.parent_path());
+std::pair<int, std::string> Runner::play(
+	const Command& cmd, const std::string& player, const Segment& window,
+	const PlayOptions& options) const {
+	namespace fs = std::filesystem;
 
-	defer tempfileDefer([&]() {
-		std::error_code err;
-		fs::remove(tempPath, err);
-	});
+	auto* store = options.store;
+	std::string key;
+	if (store != nullptr) {
+		key = PreviewStore::key(cmd, window);
+		if (auto file = store->find(key); file.has_value()) {
+			SPDLOG_DEBUG("Replaying {}", file->string());
+			return openPlayer(player, file.value(), options.cancel);
+		}
+	}
 
-	std::vector<std::string> args{path.string(), "-hide_banner", "-v", "error"};
-	if (inputs.empty()) {
-		args.insert(args.end(), {"-f", "lavfi", "-i", "nullsrc"});
-	} else {
-		for (const auto& i : inputs) { args.insert(args.end(), {"-i", i}); }
+	std::vector<bool> seekable(cmd.inputs.size(), false);
+	std::vector<double> durations(cmd.inputs.size(), 0);
+	if (window.start > 0 || window.duration > 0 || options.memoryBudget > 0) {
+		for (auto i = 0U; i < cmd.inputs.size(); ++i) {
+			durations[i] = getInfo(cmd.inputs[i]).duration;
+			seekable[i] = durations[i] > 0;
+		}
 	}
-	if (!filter.empty()) {
-		args.emplace_back("-filter_complex");
-		args.emplace_back(filter.data());
+
+	// RAM previews are never kept, they are cheap to render again
+	std::unique_ptr<MemoryFile> memory;
+	if (options.memoryBudget > 0 && backend->isLocal()) {
+		memory = MemoryFile::create(
+			estimateSize(cmd, durations, window, options.sizeFactor),
+			options.memoryBudget);
 	}
 
-	for (const auto& o : outputs) { args.insert(args.end(), {"-map", o}); }
-	if (inputs.empty()) {
-		// If input is empty add a hard limit of 5 min for now
-		args.insert(args.end(), {"-y", "-t", "300", tempPath.string()});
+	fs::path tempPath;
+	if (memory != nullptr) {
+		tempPath = memory->path();
+		store = nullptr;
+	} else if (store != nullptr) {
+		tempPath = store->reserve(key);
 	} else {
-		args.insert(args.end(), {"-y", tempPath.string()});
+		tempPath = tempDirectory() /
+				   fmt::format("preview-{}-{}.mkv", PID, ++filename_index);
 	}
 
-	auto aargs = convertArgs(args);
+	if (memory == nullptr) { fs::create_directories(tempPath.parent_path()); }
 
-	Process ffmpeg_process;
+	defer tempfileDefer([&]() {
+		if (memory != nullptr) { return; }
+		std::error_code err;
+		fs::remove(tempPath, err);
+	});
+
+	// Keep the source timestamps, so expressions using t see the same
+	// values as a full run would
+	auto args = commandArgs(cmd, seekable, window, window.start > 0);
+	if (memory != nullptr) {
+		args.insert(args.end(), {"-fs", std::to_string(memory->limit())});
+	}
+	args.insert(args.end(), {"-f", "matroska", "-y", tempPath.string()});
+	const auto progress = watchProgress(args, limits);
 
-	SPDLOG_DEBUG("ffmpeg start: \"{}\"", fmt::join(args, " "));
 	// 1. Start the ffmpeg process
-	if (!ffmpeg_process.start(args, subprocess_option_search_user_path)) {
-		return {ffmpeg_process.returnCode(), ffmpeg_process.getStdErr()};
+	std::unique_lock spawning(LocalBackend::spawnMutex(), std::defer_lock);
+	if (memory != nullptr) {
+		spawning.lock();
+		memory->inherit(true);
+	}
+	auto ffmpeg_process = start(args);
+	if (memory != nullptr) {
+		memory->inherit(false);
+		spawning.unlock();
 	}
+	if (ffmpeg_process == nullptr) { return {-1, "failed to start ffmpeg"}; }
+	Watchdog watchdog(*ffmpeg_process, limits, progress, options.cancel);
 
 	// 2. We have to wait until ffmpeg writes something to the file
 	while (!fs::exists(tempPath) || fs::file_size(tempPath) == 0) {
 		SPDLOG_DEBUG(
 			"Checking for file size: {}",
 			fs::exists(tempPath) && fs::file_size(tempPath));
-		if (!ffmpeg_process.isRunning()) { break; }
-		std::this_thread::sleep_for(std::chrono::seconds(1));
+		if (!ffmpeg_process->isRunning()) { break; }
+		// Short, this wait is most of the time to the first frame
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
 	}
 
-	if (ffmpeg_process.failed()) {
-		return {
-			ffmpeg_process.returnCode(),
-			"ffmpeg error: " + ffmpeg_process.getStdErr()};
+	if (!ffmpeg_process->isRunning()) {
+		auto err = ffmpeg_process->readStdErr();
+		if (auto reason = watchdog.stopReason(); !reason.empty()) {
+			return {-1, fmt::format("ffmpeg {}: {}", reason, err)};
+		}
+		if (auto status = ffmpeg_process->finish(); status != 0) {
+			return {status, "ffmpeg error: " + err};
+		}
 	}
 
 	SPDLOG_DEBUG(
 		"Found files {} with size {}", tempPath.string(),
 		fs::file_size(tempPath));
 
-#if defined(APP_OS_WINDOWS)
-	std::vector<std::string_view> player_args{"cmd", "/C", "start"};
-#else
-	std::vector<std::string> player_args{};
-#endif
-	for (auto& elem : str::split(player, '\n')) {
-		if (elem == "%f") {
-			player_args.emplace_back(tempPath.string());
-		} else {
-			player_args.emplace_back(str::strip(elem));
+	if (memory != nullptr) {
+		spawning.lock();
+		memory->inherit(true);
+	}
+	auto result = openPlayer(player, tempPath, options.cancel, [&] {
+		if (memory == nullptr) { return; }
+		memory->inherit(false);
+		spawning.unlock();
+	});
+
+	// Only complete previews are kept, a player closed early stops ffmpeg
+	if (store != nullptr && !ffmpeg_process->isRunning() &&
+		ffmpeg_process->finish() == 0 && watchdog.stopReason().empty()) {
+		(void)store->insert(key, tempPath);
+	}
+	// ffmpeg ends cleanly at -fs, only the size tells the preview was cut
+	std::error_code err;
+	if (memory != nullptr && result.first == 0 &&
+		!ffmpeg_process->isRunning() && ffmpeg_process->finish() == 0 &&
+		fs::file_size(tempPath, err) >= memory->limit() && !err) {
+		return {
+			-1, fmt::format(
+					"Preview cut at its share of the RAM budget, {} KiB. "
+					"Raise the preview memory, or set it to 0 to write "
+					"previews to disk",
+					memory->limit() / 1024)};
+	}
+	return result;
+}
+
+std::pair<int, std::string> Runner::readOutput(
+	const std::vector<std::string>& args,
+	const std::function<bool(std::string_view)>& cb,
+	const std::atomic_bool* cancel) const {
+	if (!backend->isLocal()) {
+		return {-1, "Reading ffmpeg's output needs ffmpeg on this machine"};
+	}
+	auto job = start(args);
+	if (job == nullptr) { return {-1, "failed to start ffmpeg"}; }
+	// stdout carries the output, so there is no -progress to watch stalls
+	// with. Those are expected anyway while the reader falls behind.
+	Watchdog watchdog(*job, limits, false, cancel);
+	// Drained at once, a full stderr pipe would stall ffmpeg
+	auto err = std::async(std::launch::async, [&] {
+		return job->readStdErr();
+	});
+
+	auto stopped = false;
+	job->readChunks([&](std::string_view data) {
+		stopped = !cb(data);
+		return !stopped;
+	});
+	// Whoever stopped reading wants no more output
+	if (stopped) {
+		job->terminate();
+		(void)job->finish();
+		(void)err.get();
+		return {0, ""};
+	}
+	auto message = err.get();
+	auto status = job->finish();
+	if (auto reason = watchdog.stopReason(); !reason.empty()) {
+		return {-1, message.empty() ? reason : reason + "\n" + message};
+	}
+	return {status, message};
+}
+
+std::pair<int, std::string> Runner::stream(
+	const Command& cmd, FrameRing& ring, const Segment& window,
+	const std::atomic_bool* cancel) const {
+	defer closeDefer([&]() { ring.close(); });
+	if (cmd.outputs.empty()) { return {-1, "Nothing to stream"}; }
+
+	std::vector<bool> seekable(cmd.inputs.size(), false);
+	if (window.start > 0 || window.duration > 0) {
+		for (auto i = 0U; i < cmd.inputs.size(); ++i) {
+			seekable[i] = getInfo(cmd.inputs[i]).duration > 0;
+		}
+	}
+
+	// Letterboxed to the ring's size with transparent bars, which the
+	// scopes leave out. realtime holds frames back till they are due.
+	auto graph = cmd;
+	graph.outputs = {"[stream]"};
+	graph.encoder.clear();
+	// Streams of cached inputs are mapped without brackets
+	const auto& output = cmd.outputs[0];
+	const auto source = str::starts_with(output, "[")
+							? output
+							: fmt::format("[{}]", output);
+	if (!graph.filter.empty()) { graph.filter += ";"; }
+	graph.filter += fmt::format(
+		"{0}scale={1}:{2}:force_original_aspect_ratio=decrease,format=rgba,"
+		"pad={1}:{2}:-1:-1:color=black@0,setsar=1,realtime[stream]",
+		source, ring.getWidth(), ring.getHeight());
+	auto args = commandArgs(graph, seekable, window, window.start > 0);
+	args.insert(args.end(), {"-f", "rawvideo", "-"});
+
+	const auto frameBytes = ring.getFrameBytes();
+	std::uint8_t* frame = nullptr;
+	size_t filled = 0;
+	return readOutput(
+		args,
+		[&](std::string_view data) {
+			while (!data.empty()) {
+				if (frame == nullptr) { frame = ring.acquire(cancel); }
+				if (frame == nullptr) { return false; }
+				const auto n = std::min(data.size(), frameBytes - filled);
+				std::memcpy(frame + filled, data.data(), n);
+				data.remove_prefix(n);
+				filled += n;
+				if (filled == frameBytes) {
+					ring.publish();
+					frame = nullptr;
+					filled = 0;
+				}
+			}
+			return true;
+		},
+		cancel);
+}
+
+std::pair<int, std::string> Runner::readAudio(
+	const Command& cmd, int rate, int channels,
+	const std::function<bool(const float*, size_t)>& cb,
+	const std::atomic_bool* cancel) const {
+	if (cmd.outputs.empty()) { return {-1, "Nothing to read"}; }
+	auto graph = cmd;
+	graph.outputs.resize(1);
+	graph.encoder = {
+		"-ac", std::to_string(channels), "-ar", std::to_string(rate),
+		"-f",  "f32le"};
+	auto args = commandArgs(
+		graph, std::vector<bool>(cmd.inputs.size(), false), {0, 0}, false);
+	args.emplace_back("-");
+
+	// Chunks may end inside a sample, its first bytes wait in pending.
+	// Samples are copied out, as they may be unaligned in the chunk.
+	std::vector<float> samples;
+	std::string pending;
+	return readOutput(
+		args,
+		[&](std::string_view data) {
+			if (cancel != nullptr && cancel->load()) { return false; }
+			pending.append(data);
+			const auto count = pending.size() / sizeof(float);
+			samples.resize(count);
+			std::memcpy(samples.data(), pending.data(), count * sizeof(float));
+			pending.erase(0, count * sizeof(float));
+			return count == 0 || cb(samples.data(), count);
+		},
+		cancel);
+}
+
+std::pair<int, std::string> Runner::firstFrame(
+	const Command& cmd, double& seconds,
+	const std::atomic_bool* cancel) const {
+	seconds = -1;
+	auto args = commandArgs(
+		cmd, std::vector<bool>(cmd.inputs.size(), false), {0, 0}, false);
+	// Flushed per packet, so the first one shows up as soon as it's muxed
+	args.insert(args.end(), {"-flush_packets", "1", "-f", "matroska", "-"});
+
+	// Headers come first, the first Cluster element holds the first frame.
+	// Its id may be split between chunks, tail keeps the last few bytes.
+	constexpr std::string_view CLUSTER_ID = "\x1F\x43\xB6\x75";
+	std::string tail;
+	const auto started = std::chrono::steady_clock::now();
+	auto result = readOutput(
+		args,
+		[&](std::string_view data) {
+			tail.append(data);
+			if (tail.find(CLUSTER_ID) != std::string::npos) {
+				const std::chrono::duration<double> elapsed =
+					std::chrono::steady_clock::now() - started;
+				seconds = elapsed.count();
+				return false;
+			}
+			tail.erase(0, tail.size() - std::min(tail.size(), size_t(3)));
+			return true;
+		},
+		cancel);
+	if (result.first == 0 && seconds < 0) {
+		return {-1, "ffmpeg gave no frame"};
+	}
+	return result;
+}
+
+std::pair<int, std::string> Runner::run(
+	std::vector<std::string> args, const std::atomic_bool* cancel,
+	bool lowPriority) const {
+	const auto progress = watchProgress(args, limits);
+	auto process = start(std::move(args), lowPriority);
+	if (process == nullptr) { return {-1, "failed to start ffmpeg"}; }
+	Watchdog watchdog(*process, limits, progress, cancel);
+
+	// Drain stderr before joining, a blocked pipe would stall ffmpeg
+	auto err = process->readStdErr();
+	auto status = process->finish();
+	if (auto reason = watchdog.stopReason(); !reason.empty()) {
+		// A job stopped with q may still exit cleanly
+		return {-1, err.empty() ? reason : reason + "\n" + err};
+	}
+	return {status, err};
+}
+
+std::pair<int, std::string> Runner::encode(
+	const Command& cmd, const std::filesystem::path& dest,
+	const std::atomic_bool* cancel, bool lowPriority) const {
+	// Nothing is cut, so seekability doesn't matter
+	auto args = commandArgs(
+		cmd, std::vector<bool>(cmd.inputs.size(), false), {0, 0}, false);
+	args.insert(args.end(), {"-y", dest.string()});
+	return run(args, cancel, lowPriority);
+}
+
+std::pair<int, std::string> Runner::render(
+	const Command& cmd, const std::vector<Segment>& segments,
+	const std::filesystem::path& dest, const std::atomic_bool* cancel) const {
+	namespace fs = std::filesystem;
+
+	// Inputs without a duration (eg images) are fed whole to every segment
+	std::vector<bool> seekable;
+	seekable.reserve(cmd.inputs.size());
+	for (const auto& i : cmd.inputs) {
+		seekable.push_back(getInfo(i).duration > 0);
+	}
+
+	if (segments.size() <= 1) {
+		auto args = commandArgs(cmd, seekable, {0, 0}, false);
+		args.insert(args.end(), {"-y", dest.string()});
+		return run(args, cancel);
+	}
+
+	const auto tempDir =
+		tempDirectory() / fmt::format("render-{}-{}", PID, ++filename_index);
+
+	fs::create_directories(tempDir);
+
+	defer tempDirDefer([&]() {
+		std::error_code err;
+		fs::remove_all(tempDir, err);
+	});
+
+	// Split the cores between the segments instead of letting every
+	// process spawn a full set of threads
+	const auto threads = std::max(
+		1U, std::thread::hardware_concurrency() /
+				static_cast<unsigned>(segments.size()));
+
+	std::vector<fs::path> parts;
+	std::vector<std::future<std::pair<int, std::string>>> jobs;
+	for (auto i = 0U; i < segments.size(); ++i) {
+		parts.push_back(
+			tempDir / fmt::format("part{}{}", i, dest.extension().string()));
+		auto args = commandArgs(cmd, seekable, segments[i], true);
+		args.insert(
+			args.end(), {"-threads", std::to_string(threads), "-y",
+						 parts.back().string()});
+		jobs.push_back(std::async(
+			std::launch::async,
+			[this, args, cancel]() { return run(args, cancel); }));
+	}
+
+	std::pair<int, std::string> result{0, ""};
+	for (auto i = 0U; i < jobs.size(); ++i) {
+		auto [status, err] = jobs[i].get();
+		if (status != 0 && result.first == 0) {
+			result = {status, fmt::format("segment {} failed: {}", i, err)};
 		}
 	}
+	if (result.first != 0) { return result; }
 
-	auto player_aargs = convertArgs(player_args);
+	// Names relative to the list pass concat's safe mode, which workers
+	// insist on
+	const auto list = tempDir / "segments.txt";
+	{
+		std::ofstream o(list, std::ios_base::binary);
+		for (const auto& p : parts) {
+			o << "file '" << escapeConcatPath(p.filename()) << "'\n";
+		}
+	}
 
-	SPDLOG_DEBUG("player args: {}", player_args);
+	return run(
+		{"-hide_banner", "-v", "error", "-f", "concat", "-i", list.string(),
+		 "-map", "0", "-c", "copy", "-y", dest.string()},
+		cancel);
+}
 
-	Process player_process{};
+std::pair<int, std::string> Runner::thumbnails(
+	const Command& cmd, double time, size_t bytes,
+	std::vector<std::vector<std::uint8_t>>& images,
+	const std::atomic_bool* cancel) const {
+	namespace fs = std::filesystem;
+	images.assign(cmd.outputs.size(), {});
+	if (cmd.outputs.empty()) { return {0, ""}; }
 
-	if (!player_process.start(
-			player_args, subprocess_option_search_user_path |
-							 subprocess_option_inherit_environment)) {
-		return {player_process.returnCode(), player_process.getStdErr()};
+	std::vector<bool> seekable;
+	seekable.reserve(cmd.inputs.size());
+	for (const auto& i : cmd.inputs) {
+		seekable.push_back(getInfo(i).duration > 0);
 	}
 
-	player_process.finish();
+	const auto tempDir = tempDirectory() /
+						 fmt::format("thumbnails-{}-{}", PID, ++filename_index);
+	fs::create_directories(tempDir);
+	defer tempDirDefer([&]() {
+		std::error_code err;
+		fs::remove_all(tempDir, err);
+	});
+
+	// Every output is an ffmpeg output of its own, so all of them come
+	// from a single decode of the inputs. Generated sources can only be
+	// cut on the output side, which would apply to one output, so their
+	// thumbnails are of the start.
+	auto graph = cmd;
+	graph.outputs.clear();
+	graph.encoder.clear();
+	const auto window = cmd.inputs.empty() ? Segment{0, 0}
+										   : Segment{time, THUMBNAIL_WINDOW};
+	auto args = commandArgs(graph, seekable, window, time > 0);
+	for (auto i = 0U; i < cmd.outputs.size(); ++i) {
+		args.insert(
+			args.end(),
+			{"-map", cmd.outputs[i], "-frames:v", "1", "-f", "rawvideo", "-y",
+			 (tempDir / fmt::format("{}.rgba", i)).string()});
+	}
+	auto result = run(args, cancel);
 
-	return {player_process.returnCode(), player_process.getStdErr()};
+	for (auto i = 0U; i < cmd.outputs.size(); ++i) {
+		const auto file = tempDir / fmt::format("{}.rgba", i);
+		std::error_code err;
+		if (fs::file_size(file, err) != bytes || err) { continue; }
+		std::ifstream in(file, std::ios_base::binary);
+		images[i].resize(bytes);
+		if (!in.read(reinterpret_cast<char*>(images[i].data()), bytes)) {
+			images[i].clear();
+		}
+	}
+	return result;
 }
 
-bool try_ffprobe(MediaInfo& info, const std::filesystem::path& p) {
+// False only if ffprobe couldn't be started, a file it can't read has no
+// streams
+bool try_ffprobe(
+	RunnerBackend& backend, MediaInfo& info, const std::filesystem::path& p) {
 	std::vector<std::string> args{"ffprobe",	   "-v",
 								  "quiet",		   "-print_format",
 								  "json",		   "-show_format",
@@ -221,23 +904,24 @@ bool try_ffprobe(MediaInfo& info, const std::filesystem::path& p) {
 								  "json",		   p};
 	SPDLOG_DEBUG("ffprobe args: \"{}\"", fmt::join(args, " "));
 
-	Process ffprobe{};
+	auto ffprobe = backend.start(args);
+	if (ffprobe == nullptr) { return false; }
 
-	if (!ffprobe.start(args, subprocess_option_search_user_path)) {
-		return false;
-	}
-
-	ffprobe.finish();
-
-	auto output = ffprobe.getStdOut();
-	SPDLOG_DEBUG("ffprobe output:\n{}", output);
+	auto output = ffprobe->readStdOut();
+	(void)ffprobe->finish();
+	SPDLOG_DEBUG("ffprobe output: {} bytes", output.size());
 
 	nlohmann::json json;
 	try {
 		json = nlohmann::json::parse(output);
-	} catch (nlohmann::json::exception&) { return false; }
+	} catch (nlohmann::json::exception&) { return true; }
+	if (auto& format = json["format"];
+		format.is_object() && format["duration"].is_string()) {
+		(void)str::stod(
+			format["duration"].get<std::string>(), info.duration);
+	}
 	auto& streams = json["streams"];
-	if (streams.is_null()) { return {}; }
+	if (streams.is_null()) { return true; }
 	int index = 0;
 	for (auto& elem : streams) {
 		info.streams.emplace_back();
@@ -249,6 +933,33 @@ bool try_ffprobe(MediaInfo& info, const std::filesystem::path& p) {
 		if (!elem["tags"].is_null() && elem["tags"]["title"].is_string()) {
 			info.streams.back().name = elem["tags"]["title"].get<std::string>();
 		}
+		if (elem["width"].is_number() && elem["height"].is_number()) {
+			info.streams.back().width = elem["width"].get<int>();
+			info.streams.back().height = elem["height"].get<int>();
+		}
+		auto& stream = info.streams.back();
+		if (elem["pix_fmt"].is_string()) {
+			stream.pixelFormat = elem["pix_fmt"].get<std::string>();
+		}
+		if (elem["sample_rate"].is_string()) {
+			(void)str::stoi(
+				elem["sample_rate"].get<std::string>(), stream.sampleRate);
+		}
+		if (elem["channels"].is_number()) {
+			stream.channels = elem["channels"].get<int>();
+		}
+		if (elem["channel_layout"].is_string()) {
+			stream.channelLayout = elem["channel_layout"].get<std::string>();
+		}
+		if (elem["r_frame_rate"].is_string()) {
+			auto rate = elem["r_frame_rate"].get<std::string>();
+			auto parts = str::split(rate, '/');
+			double num = 0, den = 0;
+			if (parts.size() == 2 && str::stod(parts[0], num) &&
+				str::stod(parts[1], den) && den > 0) {
+				info.streams.back().fps = num / den;
+			}
+		}
 	}
 
 	return true;
@@ -257,10 +968,11 @@ bool try_ffprobe(MediaInfo& info, const std::filesystem::path& p) {
 MediaInfo Runner::getInfo(const std::filesystem::path& p) const {
 	MediaInfo info;
 	if (p.empty()) { return info; }
-	static bool can_try_ffprobe = true;
-	if (can_try_ffprobe) {
-		if (try_ffprobe(info, p)) { return info; }
-		can_try_ffprobe = false;
+	// Only a missing ffprobe turns to parsing the ffmpeg banner for good
+	static std::atomic_bool has_ffprobe = true;
+	if (has_ffprobe) {
+		if (try_ffprobe(*backend, info, p)) { return info; }
+		has_ffprobe = false;
 	}
 	info.streams.clear();
 
@@ -289,3 +1001,43 @@ MediaInfo Runner::getInfo(const std::filesystem::path& p) const {
 		true);
 	return info;
 }
+
+std::vector<double> Runner::getKeyframes(const std::filesystem::path& p) const {
+	// Only demuxes, so this stays cheap even for long files
+	std::vector<std::string> args{
+		"ffprobe",
+		"-v",
+		"error",
+		"-select_streams",
+		"v:0",
+		"-show_entries",
+		"packet=pts_time,flags:format=start_time",
+		"-of",
+		"csv=p=0",
+		p.string()};
+	SPDLOG_DEBUG("ffprobe args: \"{}\"", fmt::join(args, " "));
+
+	auto ffprobe = backend->start(args);
+	if (ffprobe == nullptr) { return {}; }
+
+	auto output = ffprobe->readStdOut();
+	(void)ffprobe->finish();
+
+	std::vector<double> keyframes;
+	double startTime = 0;
+	for (const auto& line : str::split(output, '\n')) {
+		auto parts = str::split(str::strip(line), ',');
+		double time = 0;
+		if (parts.empty() || !str::stod(parts[0], time)) { continue; }
+		if (parts.size() == 1) {
+			startTime = time;
+		} else if (str::contains(parts[1], "K")) {
+			keyframes.push_back(time);
+		}
+	}
+
+	// -ss is relative to the start of the file, so are the keyframes
+	for (auto& k : keyframes) { k -= startTime; }
+	std::sort(keyframes.begin(), keyframes.end());
+	return keyframes;
+}
@@ -2,7 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "frame_ring.hpp"
 #include "string_utils.hpp"
+#include "util.hpp"
 
 TEST(Runner, Simple) {
 	Runner runner;
@@ -16,12 +22,70 @@ TEST(Runner, play_success) {
 	EXPECT_EQ(val.second, "");
 }
 
+TEST(Runner, play_in_memory) {
+	Runner runner;
+	PlayOptions options;
+	options.memoryBudget = 64 * 1024 * 1024;
+	auto val = runner.play(
+		{{}, "testsrc=d=1", {}}, "file\n%f", {0, 1}, options);
+	EXPECT_EQ(val.first, 0);
+	EXPECT_EQ(val.second, "");
+}
+
+TEST(Runner, play_in_memory_cut) {
+#if !defined(APP_OS_LINUX)
+	GTEST_SKIP() << "RAM previews are Linux only";
+#endif
+	Runner runner;
+	PlayOptions options;
+	options.memoryBudget = 64 * 1024 * 1024;
+	// Estimated at a few bytes, so ffmpeg stops at the limit
+	options.sizeFactor = 4.0 / (1024 * 1024);
+	auto val = runner.play(
+		{{}, "testsrc=d=1", {}}, "file\n%f", {0, 1}, options);
+	EXPECT_NE(val.first, 0);
+	EXPECT_TRUE(str::contains(val.second, "RAM budget"));
+}
+
 TEST(Runner, play_fail) {
 	Runner runner;
 	auto val = runner.play({}, "tessrc", {}, "file\n%f");
 	EXPECT_NE(val.first, 0);
 }
 
+TEST(Runner, stream) {
+	Runner runner;
+	FrameRing ring(64, 36);
+	std::atomic_bool done = false;
+	auto frames = 0;
+	std::thread consumer([&] {
+		while (!done) {
+			if (ring.consume([](const std::uint8_t*) {})) { frames++; }
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	});
+	auto val = runner.stream({{}, "testsrc=d=1:r=10[out]", {"[out]"}}, ring);
+	done = true;
+	consumer.join();
+	EXPECT_EQ(val.first, 0);
+	EXPECT_TRUE(ring.isClosed());
+	EXPECT_EQ(ring.getPublished(), 10);
+	EXPECT_GT(frames, 0);
+}
+
+TEST(Runner, readAudio) {
+	Runner runner;
+	size_t samples = 0;
+	auto val = runner.readAudio(
+		{{}, "sine=d=1[out]", {"[out]"}}, 16000, 1,
+		[&](const float*, size_t count) {
+			samples += count;
+			return true;
+		});
+	EXPECT_EQ(val.first, 0);
+	EXPECT_EQ(samples, 16000);
+}
+
 TEST(Runner, getInfo) {
 	Runner runner;
 	auto val = runner.getInfo("./test/temp427506003.mkv");
@@ -30,3 +94,51 @@ TEST(Runner, getInfo) {
 	EXPECT_EQ(val.streams[1].type, "audio");
 	EXPECT_EQ(val.streams[2].type, "audio");
 }
+
+TEST(Runner, render_segments) {
+	Runner runner;
+	const auto dest = std::filesystem::temp_directory_path() /
+					  "ffmpeg_node_editor_render_test.mkv";
+	auto val = runner.render(
+		{{"./test/temp427506003.mkv"}, "", {"0:v"}}, {{0, 1}, {1, 1}}, dest);
+	EXPECT_EQ(val.first, 0);
+	EXPECT_NEAR(runner.getInfo(dest).duration, 2, 0.1);
+	std::filesystem::remove(dest);
+}
+
+TEST(Runner, encode_threads) {
+	Runner runner;
+	Command cmd{{"./test/temp427506003.mkv"}, "", {"0:v"}};
+	cmd.encoder = {"-t", "1", "-f", "null"};
+	cmd.threads = {1, 2, 2};
+	auto val = runner.encode(cmd, "-");
+	EXPECT_EQ(val.first, 0);
+}
+
+TEST(Runner, timeout) {
+	Runner runner;
+	runner.setLimits({1, 0});
+	Command cmd{{}, "nullsrc,realtime", {}};
+	cmd.encoder = {"-f", "null"};
+	const auto start = std::chrono::steady_clock::now();
+	auto val = runner.encode(cmd, "-");
+	EXPECT_NE(val.first, 0);
+	EXPECT_TRUE(str::contains(val.second, "timed out"));
+	EXPECT_LT(
+		std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+}
+
+TEST(Runner, cancel) {
+	Runner runner;
+	Command cmd{{}, "nullsrc,realtime", {}};
+	cmd.encoder = {"-f", "null"};
+	std::atomic_bool cancel = false;
+	std::thread canceller([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		cancel = true;
+	});
+	auto val = runner.encode(cmd, "-", &cancel);
+	canceller.join();
+	EXPECT_NE(val.first, 0);
+	EXPECT_TRUE(str::starts_with(val.second, "cancelled"));
+}
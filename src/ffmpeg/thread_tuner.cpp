@@ -0,0 +1,107 @@
+#include "ffmpeg/thread_tuner.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <vector>
+
+#include "util.hpp"
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+	ThreadConfig, threads, filterThreads, filterComplexThreads);
+
+namespace {
+	unsigned cores() {
+		return std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	std::string tuningKey(std::uint64_t fingerprint) {
+		return fmt::format("{:016x}-{}", fingerprint, cores());
+	}
+
+	// ffmpeg defaults first, so it wins any tie
+	std::vector<ThreadConfig> candidates() {
+		const int n = static_cast<int>(cores());
+		std::vector<int> counts{1, std::max(1, n / 2), n};
+		counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+
+		std::vector<ThreadConfig> result{{}};
+		for (const auto& c : counts) {
+			result.push_back({0, c, c});
+			result.push_back({c, c, c});
+		}
+		return result;
+	}
+}  // namespace
+
+ThreadTuner::ThreadTuner(std::filesystem::path storage)
+	: file(std::move(storage)) {
+	load();
+}
+
+std::optional<ThreadConfig> ThreadTuner::find(std::uint64_t fingerprint) const {
+	std::lock_guard lock(mutex);
+	auto itr = best.find(tuningKey(fingerprint));
+	if (itr == best.end()) { return std::nullopt; }
+	return itr->second;
+}
+
+std::pair<int, std::string> ThreadTuner::tune(
+	const Runner& runner, Command cmd, std::uint64_t fingerprint,
+	const std::atomic_bool* cancel) {
+	using clock = std::chrono::steady_clock;
+
+	cmd.encoder = {"-t", std::to_string(SAMPLE_DURATION), "-f", "null"};
+
+	ThreadConfig fastest;
+	auto fastestTime = std::numeric_limits<double>::max();
+	for (const auto& config : candidates()) {
+		cmd.threads = config;
+		// Best of a few runs, the first one also warms the file cache
+		auto time = std::numeric_limits<double>::max();
+		for (auto i = 0; i < RUNS; ++i) {
+			const auto start = clock::now();
+			auto [status, err] = runner.encode(cmd, "-", cancel);
+			if (status != 0) { return {status, err}; }
+			time = std::min(
+				time,
+				std::chrono::duration<double>(clock::now() - start).count());
+		}
+		SPDLOG_INFO(
+			"threads={} filter_threads={} filter_complex_threads={}: {:.3f}s",
+			config.threads, config.filterThreads, config.filterComplexThreads,
+			time);
+		if (time < fastestTime) {
+			fastestTime = time;
+			fastest = config;
+		}
+	}
+
+	{
+		std::lock_guard lock(mutex);
+		best[tuningKey(fingerprint)] = fastest;
+	}
+	save();
+	return {0, ""};
+}
+
+bool ThreadTuner::load() {
+	try {
+		auto json = nlohmann::json::parse(std::ifstream(file));
+		std::lock_guard lock(mutex);
+		best = json.template get<std::map<std::string, ThreadConfig>>();
+	} catch (nlohmann::json::exception&) { return false; }
+	return true;
+}
+
+bool ThreadTuner::save() const {
+	std::ofstream o(file, std::ios_base::binary);
+	std::lock_guard lock(mutex);
+	o << std::setw(4) << nlohmann::json(best);
+	return o.good();
+}
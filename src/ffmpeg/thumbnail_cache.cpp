@@ -0,0 +1,32 @@
+#include "ffmpeg/thumbnail_cache.hpp"
+
+#include <iterator>
+#include <utility>
+
+bool ThumbnailCache::contains(std::uint64_t key) const {
+	std::lock_guard lock(mutex);
+	return images.find(key) != images.end();
+}
+
+std::optional<ThumbnailCache::Image> ThumbnailCache::find(
+	std::uint64_t key) const {
+	std::lock_guard lock(mutex);
+	auto itr = images.find(key);
+	if (itr == images.end()) { return std::nullopt; }
+	return itr->second.image;
+}
+
+void ThumbnailCache::insert(std::uint64_t key, Image image) {
+	if (!image.empty() && image.size() != BYTES) { image.clear(); }
+	std::lock_guard lock(mutex);
+	if (auto itr = images.find(key); itr != images.end()) {
+		order.erase(itr->second.position);
+		images.erase(itr);
+	}
+	while (images.size() >= CAPACITY) {
+		images.erase(order.front());
+		order.pop_front();
+	}
+	order.push_back(key);
+	images[key] = {std::move(image), std::prev(order.end())};
+}
@@ -0,0 +1,138 @@
+#include "ffmpeg/validator.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "string_utils.hpp"
+
+namespace {
+	// Long enough for filters that wait for a few frames, eg to fill
+	// their queues, finite for those that wait for the end of input
+	constexpr auto SOURCE_DURATION = 1;
+}  // namespace
+
+std::string nullSource(const MediaInfo& info) {
+	std::string graph;
+	for (const auto& s : info.streams) {
+		if (!graph.empty()) { graph += ';'; }
+		auto out = std::back_inserter(graph);
+		if (s.type == "video" && s.width > 0 && s.height > 0) {
+			fmt::format_to(
+				out, "color=c=black:s={}x{}:d={}", s.width, s.height,
+				SOURCE_DURATION);
+			if (s.fps > 0) { fmt::format_to(out, ":r={}", s.fps); }
+			if (!s.pixelFormat.empty()) {
+				fmt::format_to(out, ",format={}", s.pixelFormat);
+			}
+		} else if (s.type == "audio") {
+			graph += "anullsrc";
+			// Filters like channelmap depend on the layout
+			std::vector<std::string> options;
+			if (!s.channelLayout.empty()) {
+				options.push_back("cl=" + s.channelLayout);
+			} else if (s.channels > 0) {
+				options.push_back(fmt::format("cl={}c", s.channels));
+			}
+			if (s.sampleRate > 0) {
+				options.push_back(fmt::format("r={}", s.sampleRate));
+			}
+			if (!options.empty()) {
+				fmt::format_to(out, "={}", fmt::join(options, ":"));
+			}
+			// anullsrc has no duration option in older ffmpeg
+			fmt::format_to(out, ",atrim=end={}", SOURCE_DURATION);
+		} else {
+			return {};
+		}
+		fmt::format_to(std::back_inserter(graph), "[out{}]", s.index);
+	}
+	return graph;
+}
+
+int blamedInstance(std::string_view log) {
+	for (auto line : str::split(log, '\n')) {
+		if (!str::starts_with(line, "[")) { continue; }
+		auto end = line.find(" @ ");
+		if (end == std::string_view::npos) { continue; }
+		auto label = line.substr(1, end - 1);
+		auto at = label.find('@');
+		if (at == std::string_view::npos) { continue; }
+		auto name = label.substr(0, at);
+		auto instance = label.substr(at + 1);
+		int n = 0;
+		if (!str::starts_with(instance, name) ||
+			!str::stoi(instance.substr(name.size()), n)) {
+			continue;
+		}
+		return n;
+	}
+	return 0;
+}
+
+std::vector<int> labelInstances(std::string_view filter) {
+	std::vector<int> instances;
+	for (auto at = filter.find('@'); at != std::string_view::npos;
+		 at = filter.find('@', at + 1)) {
+		auto label = filter.substr(at + 1);
+		label = label.substr(0, label.find_first_of("=;,[ "));
+		auto digits = label.find_last_not_of("0123456789") + 1;
+		int n = 0;
+		if (!str::stoi(label.substr(digits), n)) { n = 0; }
+		instances.push_back(n);
+	}
+	return instances;
+}
+
+Validation Validator::validate(
+	const Runner& runner, const Command& cmd, std::uint64_t fingerprint) {
+	{
+		std::lock_guard lock(mutex);
+		if (auto itr = results.find(fingerprint); itr != results.end()) {
+			// Stored as the position of the label, ids may have changed
+			auto result = itr->second;
+			const auto instances = labelInstances(cmd.filter);
+			result.instance = result.instance < int(instances.size())
+								  ? instances[result.instance]
+								  : 0;
+			return result;
+		}
+	}
+	Validation result;
+	if (cmd.filter.empty()) { return result; }
+
+	std::vector<std::string> args{"-hide_banner", "-v", "error"};
+	for (const auto& input : cmd.inputs) {
+		// Streams that can't be generated are read from the file itself
+		if (auto source = nullSource(runner.getInfo(input)); !source.empty()) {
+			args.insert(args.end(), {"-f", "lavfi", "-i", source});
+		} else {
+			args.insert(args.end(), {"-i", input});
+		}
+	}
+	args.insert(args.end(), {"-filter_complex", cmd.filter});
+	for (const auto& o : cmd.outputs) { args.insert(args.end(), {"-map", o}); }
+	args.insert(args.end(), {"-frames", "1", "-f", "null", "-"});
+
+	std::tie(result.status, result.message) = runner.run(args);
+	// ffmpeg failed to start or was stopped, that says nothing of the graph
+	if (result.status == -1) { return result; }
+	if (result.status != 0) {
+		result.instance = blamedInstance(result.message);
+	}
+
+	auto stored = result;
+	const auto instances = labelInstances(cmd.filter);
+	const auto position = std::find(
+		instances.begin(), instances.end(), result.instance);
+	stored.instance = result.instance > 0 && position != instances.end()
+						  ? int(position - instances.begin())
+						  : int(instances.size());
+
+	std::lock_guard lock(mutex);
+	if (results.size() >= CACHE_SIZE) { results.clear(); }
+	results[fingerprint] = stored;
+	return result;
+}
@@ -0,0 +1,55 @@
+#include "ffmpeg/validator.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(Validator, null_source) {
+	MediaInfo info;
+	info.streams.push_back({0, "", "video", 640, 360, 25});
+	info.streams.push_back({1, "", "audio"});
+	EXPECT_EQ(
+		nullSource(info),
+		"color=c=black:s=640x360:d=1:r=25[out0];"
+		"anullsrc,atrim=end=1[out1]");
+
+	// Formats and layouts carry over, filters may depend on them
+	info.streams[0].pixelFormat = "yuv422p10le";
+	info.streams[1].sampleRate = 48000;
+	info.streams[1].channelLayout = "5.1(side)";
+	EXPECT_EQ(
+		nullSource(info),
+		"color=c=black:s=640x360:d=1:r=25,format=yuv422p10le[out0];"
+		"anullsrc=cl=5.1(side):r=48000,atrim=end=1[out1]");
+	info.streams[1].channelLayout.clear();
+	info.streams[1].channels = 3;
+	EXPECT_EQ(
+		nullSource(info),
+		"color=c=black:s=640x360:d=1:r=25,format=yuv422p10le[out0];"
+		"anullsrc=cl=3c:r=48000,atrim=end=1[out1]");
+
+	// Without a size the source would not match what filters expect
+	info.streams[0].width = 0;
+	EXPECT_EQ(nullSource(info), "");
+
+	info.streams = {{0, "", "subtitle"}};
+	EXPECT_EQ(nullSource(info), "");
+}
+
+TEST(Validator, blamed_instance) {
+	EXPECT_EQ(
+		blamedInstance(
+			"[in#0 @ 0x5581] Error opening input\n"
+			"[scale@scale12 @ 0x55a1] Option 'wdth' not found\n"
+			"[overlay@overlay3 @ 0x55b2] Failed to configure\n"),
+		12);
+	EXPECT_EQ(blamedInstance("[scale@crop4 @ 0x55a1] mismatch\n"), 0);
+	EXPECT_EQ(blamedInstance("[scale@scale @ 0x55a1] no number\n"), 0);
+	EXPECT_EQ(blamedInstance("No such filter: 'scal'\n"), 0);
+}
+
+TEST(Validator, label_instances) {
+	EXPECT_EQ(
+		labelInstances("[0:v]scale@scale12=w=2[s12];[s12]crop@crop3[out]"),
+		std::vector<int>({12, 3}));
+	EXPECT_EQ(labelInstances("null@null"), std::vector<int>({0}));
+	EXPECT_TRUE(labelInstances("testsrc").empty());
+}
@@ -0,0 +1,168 @@
+#include "ffmpeg/waveform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAVEFORM_SSE2
+#endif
+
+namespace {
+	struct Sums {
+		float min, max;
+		double squares;
+	};
+
+	// Min, max and sum of squares of n > 0 samples, four at a time where
+	// SSE2 is around
+	Sums reduce(const float* s, size_t n) {
+		size_t i = 0;
+		Sums r{s[0], s[0], 0};
+#if defined(WAVEFORM_SSE2)
+		if (n >= 4) {
+			auto lo = _mm_loadu_ps(s);
+			auto hi = lo;
+			auto sq = _mm_setzero_ps();
+			for (; i + 4 <= n; i += 4) {
+				const auto v = _mm_loadu_ps(s + i);
+				lo = _mm_min_ps(lo, v);
+				hi = _mm_max_ps(hi, v);
+				sq = _mm_add_ps(sq, _mm_mul_ps(v, v));
+			}
+			alignas(16) float l[4], h[4], q[4];
+			_mm_store_ps(l, lo);
+			_mm_store_ps(h, hi);
+			_mm_store_ps(q, sq);
+			r.min = std::min({l[0], l[1], l[2], l[3]});
+			r.max = std::max({h[0], h[1], h[2], h[3]});
+			r.squares = double(q[0]) + q[1] + q[2] + q[3];
+		}
+#endif
+		for (; i < n; ++i) {
+			r.min = std::min(r.min, s[i]);
+			r.max = std::max(r.max, s[i]);
+			r.squares += double(s[i]) * s[i];
+		}
+		return r;
+	}
+
+	// Peaks of equal sized blocks combined
+	Peak merge(const Peak* p, size_t n) {
+		Peak r = p[0];
+		double squares = 0;
+		for (size_t i = 0; i < n; ++i) {
+			r.min = std::min(r.min, p[i].min);
+			r.max = std::max(r.max, p[i].max);
+			squares += double(p[i].rms) * p[i].rms;
+		}
+		r.rms = float(std::sqrt(squares / double(n)));
+		return r;
+	}
+
+	// Pairs of peaks into one, a trailing odd one is kept as is
+	void halve(const std::vector<Peak>& from, std::vector<Peak>& to) {
+		to.clear();
+		to.reserve((from.size() + 1) / 2);
+		for (size_t i = 0; i < from.size(); i += 2) {
+			to.push_back(merge(&from[i], std::min<size_t>(2, from.size() - i)));
+		}
+	}
+}  // namespace
+
+void Waveform::push(const Peak& p) {
+	auto& base = levels[0];
+	base.push_back(p);
+	if (base.size() < MAX_PEAKS) { return; }
+	// In place, each peak only reads ones at or after it
+	for (size_t i = 0; i < base.size() / 2; ++i) {
+		base[i] = merge(&base[2 * i], 2);
+	}
+	base.resize(base.size() / 2);
+	block *= 2;
+}
+
+void Waveform::append(const float* data, size_t count) {
+	samples += count;
+	while (count > 0) {
+		const auto n = std::min(count, block - partialCount);
+		const auto s = reduce(data, n);
+		if (partialCount == 0) {
+			partialMin = s.min;
+			partialMax = s.max;
+		} else {
+			partialMin = std::min(partialMin, s.min);
+			partialMax = std::max(partialMax, s.max);
+		}
+		partialSquares += s.squares;
+		partialCount += n;
+		data += n;
+		count -= n;
+		if (partialCount == block) {
+			push({partialMin, partialMax,
+				  float(std::sqrt(partialSquares / double(block)))});
+			partialSquares = 0;
+			partialCount = 0;
+		}
+	}
+}
+
+void Waveform::finish() {
+	if (partialCount > 0) {
+		push({partialMin, partialMax,
+			  float(std::sqrt(partialSquares / double(partialCount)))});
+		partialSquares = 0;
+		partialCount = 0;
+	}
+	levels.resize(1);
+	while (levels.back().size() > 1) {
+		std::vector<Peak> next;
+		halve(levels.back(), next);
+		levels.push_back(std::move(next));
+	}
+}
+
+std::vector<Peak> Waveform::columns(size_t count) const {
+	std::vector<Peak> result;
+	if (count == 0 || levels[0].empty()) { return result; }
+	auto l = levels.size() - 1;
+	while (l > 0 && levels[l].size() < count) { --l; }
+	const auto& peaks = levels[l];
+	const auto n = peaks.size();
+	result.reserve(count);
+	for (size_t c = 0; c < count; ++c) {
+		const auto begin = std::min(n - 1, c * n / count);
+		const auto end = std::max(begin + 1, (c + 1) * n / count);
+		result.push_back(merge(&peaks[begin], end - begin));
+	}
+	return result;
+}
+
+bool WaveformCache::contains(std::uint64_t key) const {
+	std::lock_guard lock(mutex);
+	return waveforms.find(key) != waveforms.end();
+}
+
+std::shared_ptr<const Waveform> WaveformCache::find(std::uint64_t key) const {
+	std::lock_guard lock(mutex);
+	auto itr = waveforms.find(key);
+	if (itr == waveforms.end()) { return nullptr; }
+	return itr->second.waveform;
+}
+
+void WaveformCache::insert(std::uint64_t key, Waveform waveform) {
+	auto w = std::make_shared<const Waveform>(std::move(waveform));
+	std::lock_guard lock(mutex);
+	if (auto itr = waveforms.find(key); itr != waveforms.end()) {
+		order.erase(itr->second.position);
+		waveforms.erase(itr);
+	}
+	while (waveforms.size() >= CAPACITY) {
+		waveforms.erase(order.front());
+		order.pop_front();
+	}
+	order.push_back(key);
+	waveforms[key] = {std::move(w), std::prev(order.end())};
+}
@@ -0,0 +1,69 @@
+#include "ffmpeg/waveform.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+TEST(Waveform, peaks) {
+	// Odd sized pieces, so blocks and SIMD lanes are cut at random spots
+	std::vector<float> samples(10007, 0.5f);
+	samples[123] = -0.75f;
+	samples[9001] = 0.9f;
+	Waveform w;
+	for (size_t i = 0; i < samples.size(); i += 333) {
+		w.append(&samples[i], std::min<size_t>(333, samples.size() - i));
+	}
+	w.finish();
+	EXPECT_EQ(w.getSamples(), samples.size());
+	EXPECT_EQ(w.level(0).size(), (samples.size() + 255) / 256);
+	EXPECT_EQ(w.level(w.getLevels() - 1).size(), 1);
+
+	auto all = w.columns(1);
+	ASSERT_EQ(all.size(), 1);
+	EXPECT_FLOAT_EQ(all[0].min, -0.75f);
+	EXPECT_FLOAT_EQ(all[0].max, 0.9f);
+	EXPECT_NEAR(all[0].rms, 0.5f, 0.01f);
+
+	auto columns = w.columns(4);
+	ASSERT_EQ(columns.size(), 4);
+	EXPECT_FLOAT_EQ(columns[0].min, -0.75f);
+	EXPECT_FLOAT_EQ(columns[1].min, 0.5f);
+	EXPECT_FLOAT_EQ(columns[3].max, 0.9f);
+	// More columns than peaks repeat them
+	EXPECT_EQ(w.columns(100).size(), 100);
+}
+
+TEST(Waveform, fixed_budget) {
+	std::vector<float> chunk(4096);
+	for (size_t i = 0; i < chunk.size(); ++i) {
+		chunk[i] = std::sin(float(i) * 0.01f);
+	}
+	Waveform w;
+	const auto total = Waveform::MAX_PEAKS * Waveform::MIN_BLOCK * 8;
+	for (size_t i = 0; i < total; i += chunk.size()) {
+		w.append(chunk.data(), chunk.size());
+	}
+	w.finish();
+	EXPECT_EQ(w.getSamples(), total);
+	EXPECT_LE(w.level(0).size(), Waveform::MAX_PEAKS);
+	EXPECT_EQ(w.getBlock(), Waveform::MIN_BLOCK * 16);
+	size_t peaks = 0;
+	for (size_t l = 0; l < w.getLevels(); ++l) { peaks += w.level(l).size(); }
+	EXPECT_LE(peaks, 2 * Waveform::MAX_PEAKS);
+}
+
+TEST(WaveformCache, insert) {
+	WaveformCache cache;
+	EXPECT_FALSE(cache.contains(1));
+	cache.insert(1, {});
+	EXPECT_TRUE(cache.contains(1));
+	auto w = cache.find(1);
+	ASSERT_NE(w, nullptr);
+	EXPECT_EQ(w->getSamples(), 0);
+	for (auto i = 0U; i < WaveformCache::CAPACITY; ++i) {
+		cache.insert(i + 2, {});
+	}
+	EXPECT_FALSE(cache.contains(1));
+	EXPECT_NE(w, nullptr);	// still held by whoever found it
+}
@@ -0,0 +1,332 @@
+#include "ffmpeg/worker.hpp"
+
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace {
+	// Newline separated JSON, output of ffmpeg isn't always valid UTF-8
+	std::string message(const nlohmann::json& msg) {
+		const auto text = msg.dump(
+			-1, ' ', false, nlohmann::json::error_handler_t::replace);
+		return text + "\n";
+	}
+
+	// ffmpeg options without a value, booleans also with a "no" prefix.
+	// Every other option takes one, as codec and format options all do.
+	const std::set<std::string_view> FFMPEG_FLAGS{
+		"-accurate_seek", "-an",		"-autorotate",	 "-autoscale",
+		"-benchmark",	  "-bitexact",	"-copyinkf",	 "-copy_unknown",
+		"-copyts",		  "-debug_ts",	"-dn",			 "-filters",
+		"-fix_sub_duration",			"-hide_banner",	 "-ignore_unknown",
+		"-intra",		  "-n",			"-re",			 "-recast_media",
+		"-seek_timestamp",				"-shortest",	 "-sn",
+		"-start_at_zero", "-stats",		"-stdin",		 "-version",
+		"-vn",			  "-xerror",	"-y"};
+
+	// ffprobe options the editor uses, and whether they take a value
+	const std::map<std::string_view, bool> PROBE_OPTIONS{
+		{"-v", true},			 {"-hide_banner", false},
+		{"-print_format", true}, {"-of", true},
+		{"-show_format", false}, {"-show_streams", false},
+		{"-show_entries", true}, {"-select_streams", true}};
+
+	// Options naming files ffmpeg writes or loads, by part of their name.
+	// Without safe, concat lists could name any file.
+	constexpr std::string_view FILE_OPTIONS[] = {
+		"file", "script", "list", "attach", "dump", "report", "vstats",
+		"passlog", "sdp", "safe"};
+
+	// Filters, and their options, that read or write files by path or
+	// load code from one
+	const std::set<std::string_view> FILE_FILTERS{
+		"ametadata",  "amovie",		   "asendcmd", "ass",		"azmq",
+		"file",		  "filename",	   "frei0r",   "frei0r_src", "ladspa",
+		"libvmaf",	  "lut1d",		   "lut3d",	   "lv2",		"metadata",
+		"movie",	  "psfile",		   "psnr",	   "sendcmd",	"signature",
+		"ssim",		  "subtitles",	   "textfile", "vidstabdetect",
+		"vmafmotion", "zmq"};
+
+	// Muxers that write to more files than their output
+	const std::set<std::string_view> MULTI_FILE_FORMATS{
+		"dash", "fifo", "hls", "segment", "ssegment", "stream_segment", "tee"};
+
+	// Takes as long whatever prefix the tokens share, so timing gives
+	// away no more than the length
+	bool sameToken(std::string_view sent, std::string_view expected) {
+		if (sent.size() != expected.size()) { return false; }
+		unsigned diff = 0;
+		for (size_t i = 0; i < sent.size(); ++i) {
+			diff |= unsigned(sent[i] ^ expected[i]);
+		}
+		return diff == 0;
+	}
+
+	bool isFlag(std::string_view option) {
+		if (FFMPEG_FLAGS.contains(option)) { return true; }
+		return str::starts_with(option, "-no") &&
+			   FFMPEG_FLAGS.contains("-" + std::string(option.substr(3)));
+	}
+
+	std::string refuseGraph(std::string_view graph) {
+		std::string name;
+		auto check = [&] {
+			if (FILE_FILTERS.contains(name)) {
+				return fmt::format("filter not allowed: {}\n", name);
+			}
+			name.clear();
+			return std::string();
+		};
+		for (const auto ch : graph) {
+			if (std::isalnum(static_cast<unsigned char>(ch)) || ch == '_') {
+				name.push_back(ch);
+			} else if (auto err = check(); !err.empty()) {
+				return err;
+			}
+		}
+		return check();
+	}
+
+	// Whether path is absolute and inside one of dirs
+	bool within(
+		const std::string& path,
+		const std::vector<std::filesystem::path>& dirs) {
+		const auto p = std::filesystem::path(path).lexically_normal();
+		if (!p.is_absolute()) { return false; }
+		return std::any_of(dirs.begin(), dirs.end(), [&](const auto& d) {
+			const auto rel = p.lexically_relative(d.lexically_normal());
+			return !rel.empty() && *rel.begin() != "..";
+		});
+	}
+
+	// Why a job is refused, empty if it has one of the shapes the editor
+	// sends: probes of an input, or graphs reading from the input or
+	// output dirs and writing to stdout or the output dirs
+	std::string refuseJob(
+		const std::vector<std::string>& args, const WorkerOptions& options) {
+		namespace fs = std::filesystem;
+		auto readable = options.inputDirs;
+		readable.insert(
+			readable.end(), options.outputDirs.begin(),
+			options.outputDirs.end());
+		const auto program = fs::path(args[0]).stem().string();
+		if (program == "ffprobe") {
+			auto inputs = 0;
+			for (auto i = 1U; i < args.size(); ++i) {
+				if (!str::starts_with(args[i], "-")) {
+					if (!within(args[i], readable)) {
+						return fmt::format("input not allowed: {}\n", args[i]);
+					}
+					inputs++;
+					continue;
+				}
+				auto itr = PROBE_OPTIONS.find(args[i]);
+				if (itr == PROBE_OPTIONS.end()) {
+					return fmt::format("option not allowed: {}\n", args[i]);
+				}
+				if (itr->second) { ++i; }
+			}
+			return inputs == 1 ? "" : "probe one input at a time\n";
+		}
+
+		auto writable = [&](const std::string& output) {
+			if (output == "-" || output == "pipe:" || output == "pipe:1") {
+				return true;
+			}
+			return within(output, options.outputDirs);
+		};
+		std::string format;
+		for (auto i = 1U; i < args.size(); ++i) {
+			const auto& arg = args[i];
+			if (arg == "-" || !str::starts_with(arg, "-")) {
+				if (!writable(arg)) {
+					return fmt::format("output not allowed: {}\n", arg);
+				}
+				if (MULTI_FILE_FORMATS.contains(format)) {
+					return fmt::format("format not allowed: {}\n", format);
+				}
+				format.clear();
+				continue;
+			}
+			if (isFlag(arg)) { continue; }
+			if (i + 1 == args.size()) {
+				return fmt::format("missing value: {}\n", arg);
+			}
+			const auto& value = args[++i];
+			if (arg == "-progress") {
+				if (value == "pipe:1" || value == "pipe:2") { continue; }
+				return "progress goes to a pipe\n";
+			}
+			for (const auto part : FILE_OPTIONS) {
+				if (str::contains(arg, part)) {
+					return fmt::format("option not allowed: {}\n", arg);
+				}
+			}
+			auto err = std::string();
+			if (arg == "-f") {
+				format = value;
+			} else if (arg == "-i") {
+				if (format == "lavfi") {
+					err = refuseGraph(value);
+				} else if (!within(value, readable)) {
+					err = fmt::format("input not allowed: {}\n", value);
+				}
+				format.clear();
+			} else if (
+				arg == "-vf" || arg == "-af" || arg == "-lavfi" ||
+				str::starts_with(arg, "-filter")) {
+				err = refuseGraph(value);
+			}
+			if (!err.empty()) { return err; }
+		}
+		return "";
+	}
+}  // namespace
+
+bool Worker::listen(std::string_view address) {
+	if (str::starts_with(str::strip_prefix(address, "tcp:"), "*:") &&
+		options.token.empty()) {
+		SPDLOG_ERROR("listening on every interface needs a token");
+		return false;
+	}
+	listener = StreamSocket::listen(address);
+	if (!listener.valid()) {
+		SPDLOG_ERROR("unable to listen on {}", address);
+		return false;
+	}
+	return true;
+}
+
+void Worker::serve() {
+	for (;;) {
+		auto client = std::make_shared<StreamSocket>(listener.accept());
+		std::lock_guard lock(mutex);
+		if (stopped || !client->valid()) { break; }
+		reap();
+		clients.push_back(client);
+		threads.emplace_back([this, client] {
+			handle(client);
+			std::lock_guard lock(mutex);
+			erase(clients, client);
+			finished.push_back(std::this_thread::get_id());
+		});
+	}
+
+	std::list<std::thread> running;
+	{
+		std::lock_guard lock(mutex);
+		running.swap(threads);
+	}
+	for (auto& t : running) { t.join(); }
+}
+
+void Worker::reap() {
+	for (auto itr = threads.begin(); itr != threads.end();) {
+		if (contains(finished, itr->get_id())) {
+			itr->join();
+			itr = threads.erase(itr);
+		} else {
+			++itr;
+		}
+	}
+	finished.clear();
+}
+
+void Worker::stop() {
+	std::lock_guard lock(mutex);
+	stopped = true;
+	listener.shutdown();
+	for (const auto& c : clients) { c->shutdown(); }
+}
+
+void Worker::handle(const std::shared_ptr<StreamSocket>& client) {
+	std::mutex sendMutex;
+	auto send = [&](const nlohmann::json& msg) {
+		std::lock_guard lock(sendMutex);
+		return client->send(message(msg));
+	};
+
+	std::vector<std::string> args;
+	std::string token;
+	bool lowPriority = false;
+	try {
+		std::string line;
+		if (!client->readLine(line)) { return; }
+		auto request = nlohmann::json::parse(line);
+		token = request.value("token", "");
+		args = request.at("args").get<std::vector<std::string>>();
+		lowPriority = request.value("low_priority", false);
+	} catch (nlohmann::json::exception& e) {
+		send({{"stderr", fmt::format("bad request: {}\n", e.what())}});
+		send({{"exit", -1}});
+		return;
+	}
+
+	if (!options.token.empty() && !sameToken(token, options.token)) {
+		SPDLOG_WARN("refused a client with a wrong token");
+		send({{"stderr", "wrong token\n"}});
+		send({{"exit", -1}});
+		return;
+	}
+	if (args.empty() || !contains(options.programs, args[0])) {
+		send({{"stderr", "program not allowed\n"}});
+		send({{"exit", -1}});
+		return;
+	}
+	if (auto refused = refuseJob(args, options); !refused.empty()) {
+		SPDLOG_WARN("refused job: \"{}\"", fmt::join(args, " "));
+		send({{"stderr", refused}});
+		send({{"exit", -1}});
+		return;
+	}
+
+	SPDLOG_INFO("job: \"{}\"", fmt::join(args, " "));
+	auto job = backend->start(args, lowPriority);
+	if (job == nullptr) {
+		send({{"stderr", fmt::format("failed to start {}\n", args[0])}});
+		send({{"exit", -1}});
+		return;
+	}
+
+	// Both pipes are drained at once, a full one would stall the job
+	auto forward = [&](bool readStdErr, const char* key) {
+		return std::thread([&, readStdErr, key] {
+			job->readLines(
+				[&](std::string_view line) {
+					return send({{key, std::string(line) + "\n"}});
+				},
+				readStdErr);
+		});
+	};
+	auto out = forward(false, "stdout");
+	auto err = forward(true, "stderr");
+	auto waiter = std::thread([&] {
+		out.join();
+		err.join();
+		send({{"exit", job->finish()}});
+		client->shutdown();
+	});
+
+	// The client may ask to stop the job gently, its end of the connection
+	// closing means either the exit code arrived or the job is cancelled
+	std::string line;
+	while (client->readLine(line)) {
+		try {
+			auto level = nlohmann::json::parse(line).at("stop").get<int>();
+			if (level >= 0 && level <= static_cast<int>(StopLevel::Kill)) {
+				job->stop(static_cast<StopLevel>(level));
+			}
+		} catch (nlohmann::json::exception&) {}
+	}
+	job->terminate();
+	waiter.join();
+}
@@ -0,0 +1,163 @@
+#include "ffmpeg/worker.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "ffmpeg/runner.hpp"
+#include "string_utils.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+	// Worker serving on a socket in the temp directory
+	struct TestWorker {
+		std::string address;
+		Worker worker;
+		std::thread thread;
+
+		explicit TestWorker(std::string_view name, WorkerOptions options = {})
+			: address(
+				  "unix:" +
+				  (std::filesystem::temp_directory_path() / name).string()),
+			  worker(std::make_shared<LocalBackend>(), std::move(options)) {
+			EXPECT_TRUE(worker.listen(address));
+			thread = std::thread([this] { worker.serve(); });
+		}
+		TestWorker(const TestWorker&) = delete;
+		TestWorker& operator=(const TestWorker&) = delete;
+		~TestWorker() {
+			worker.stop();
+			thread.join();
+		}
+	};
+}  // namespace
+
+TEST(Worker, runs_jobs) {
+	TestWorker w("ffmpeg_node_editor_worker_test.sock");
+	Runner runner("ffmpeg", std::make_shared<RemoteBackend>(w.address));
+	auto lines = 0;
+	EXPECT_EQ(
+		runner.lineScanner(
+			{"-version"},
+			[&](std::string_view line) {
+				if (str::starts_with(line, "ffmpeg version")) { lines++; }
+				return true;
+			}),
+		0);
+	EXPECT_EQ(lines, 1);
+}
+
+TEST(Worker, refuses_programs) {
+	TestWorker w("ffmpeg_node_editor_worker_test.sock");
+	Runner runner("rm", std::make_shared<RemoteBackend>(w.address));
+	auto [status, err] = runner.run({"-version"});
+	EXPECT_NE(status, 0);
+	EXPECT_EQ(err, "program not allowed\n");
+}
+
+TEST(Worker, refuses_job_shapes) {
+	TestWorker w("ffmpeg_node_editor_worker_test.sock");
+	Runner runner("ffmpeg", std::make_shared<RemoteBackend>(w.address));
+	auto refused = [&](std::vector<std::string> args) {
+		args.insert(args.begin(), {"-f", "lavfi", "-i", "testsrc"});
+		return runner.run(args).second;
+	};
+	EXPECT_EQ(
+		refused({"-y", "/etc/out.mkv"}), "output not allowed: /etc/out.mkv\n");
+	EXPECT_EQ(refused({"out.mkv"}), "output not allowed: out.mkv\n");
+	const auto escaped = (tempDirectory() / "../out.mkv").string();
+	EXPECT_EQ(refused({escaped}), "output not allowed: " + escaped + "\n");
+	EXPECT_EQ(
+		refused({"-vf", "metadata=print:file=x", "-f", "null", "-"}),
+		"filter not allowed: metadata\n");
+	EXPECT_EQ(
+		refused({"-vstats_file", "x", "-f", "null", "-"}),
+		"option not allowed: -vstats_file\n");
+	EXPECT_EQ(
+		refused({"-f", "tee", (tempDirectory() / "a.mkv").string()}),
+		"format not allowed: tee\n");
+
+	RemoteBackend backend(w.address);
+	auto probe = backend.start({"ffprobe", "-show_streams", "-o", "x", "in"});
+	ASSERT_NE(probe, nullptr);
+	EXPECT_EQ(probe->readStdErr(), "option not allowed: -o\n");
+	EXPECT_NE(probe->finish(), 0);
+}
+
+TEST(Worker, refuses_inputs) {
+	WorkerOptions options;
+	options.inputDirs = {"/media"};
+	TestWorker w("ffmpeg_node_editor_worker_test.sock", options);
+	Runner runner("ffmpeg", std::make_shared<RemoteBackend>(w.address));
+	auto refused = [&](std::vector<std::string> args) {
+		args.insert(args.end(), {"-f", "null", "-"});
+		return runner.run(args).second;
+	};
+	EXPECT_EQ(
+		refused({"-i", "/etc/passwd"}), "input not allowed: /etc/passwd\n");
+	EXPECT_EQ(
+		refused({"-i", "/media/../etc/passwd"}),
+		"input not allowed: /media/../etc/passwd\n");
+	EXPECT_EQ(
+		refused({"-i", "http://example.com/a.mkv"}),
+		"input not allowed: http://example.com/a.mkv\n");
+	EXPECT_EQ(
+		refused({"-f", "lavfi", "-i", "movie=/etc/passwd"}),
+		"filter not allowed: movie\n");
+	EXPECT_EQ(
+		refused({"-f", "concat", "-safe", "0", "-i", "/media/list.txt"}),
+		"option not allowed: -safe\n");
+
+	RemoteBackend backend(w.address);
+	auto probe = backend.start({"ffprobe", "-show_streams", "/root/a.mkv"});
+	ASSERT_NE(probe, nullptr);
+	EXPECT_EQ(probe->readStdErr(), "input not allowed: /root/a.mkv\n");
+}
+
+TEST(Worker, token) {
+	WorkerOptions options;
+	options.token = "secret";
+	TestWorker w("ffmpeg_node_editor_worker_test.sock", options);
+	Runner wrong(
+		"ffmpeg", std::make_shared<RemoteBackend>(w.address, "guess"));
+	EXPECT_EQ(wrong.run({"-version"}).second, "wrong token\n");
+	Runner right(
+		"ffmpeg", std::make_shared<RemoteBackend>(w.address, "secret"));
+	EXPECT_EQ(right.run({"-version"}).first, 0);
+
+	// Every interface only with a token
+	Worker open(std::make_shared<LocalBackend>());
+	EXPECT_FALSE(open.listen("*:0"));
+	Worker locked(std::make_shared<LocalBackend>(), options);
+	EXPECT_TRUE(locked.listen("*:0"));
+}
+
+TEST(Worker, cancel) {
+	TestWorker w("ffmpeg_node_editor_worker_test.sock");
+	Runner runner("ffmpeg", std::make_shared<RemoteBackend>(w.address));
+	std::atomic_bool cancel = false;
+	auto job = std::thread([&] {
+		std::this_thread::sleep_for(500ms);
+		cancel = true;
+	});
+	auto [status, err] = runner.run(
+		{"-v", "error", "-f", "lavfi", "-i", "nullsrc", "-f", "null", "-"},
+		&cancel);
+	job.join();
+	EXPECT_EQ(status, -1);
+	EXPECT_EQ(err, "cancelled");
+}
+
+TEST(Worker, unreachable) {
+	Runner runner(
+		"ffmpeg", std::make_shared<RemoteBackend>(
+					  "unix:/nonexistent/ffmpeg_node_editor_worker.sock"));
+	EXPECT_NE(runner.lineScanner({"-version"}, nullptr), 0);
+	EXPECT_TRUE(runner.getInfo("./test/temp427506003.mkv").streams.empty());
+}
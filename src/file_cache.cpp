@@ -0,0 +1,110 @@
+#include "file_cache.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "string_utils.hpp"
+#include "util.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+	struct Entry {
+		fs::path path;
+		std::uintmax_t size;
+		fs::file_time_type lastUse;
+	};
+
+	std::vector<Entry> entries(const fs::path& dir) {
+		std::vector<Entry> result;
+		std::error_code err;
+		for (const auto& file : fs::directory_iterator(dir, err)) {
+			if (!file.is_regular_file(err)) { continue; }
+			if (str::ends_with(file.path().filename().string(), ".part")) {
+				continue;
+			}
+			result.push_back(
+				{file.path(), file.file_size(err), file.last_write_time(err)});
+		}
+		return result;
+	}
+}  // namespace
+
+FileCache::FileCache(fs::path directory, std::uintmax_t budget)
+	: dir(std::move(directory)), budget(budget) {
+	std::error_code err;
+	fs::create_directories(dir, err);
+	if (err) {
+		SPDLOG_ERROR(
+			"Unable to create cache {}: {}", dir.string(), err.message());
+	}
+}
+
+bool FileCache::contains(std::string_view key) const {
+	std::error_code err;
+	return fs::is_regular_file(path(key), err);
+}
+
+std::optional<fs::path> FileCache::find(std::string_view key) const {
+	auto p = path(key);
+	std::error_code err;
+	fs::last_write_time(p, fs::file_time_type::clock::now(), err);
+	if (err) { return {}; }
+	return p;
+}
+
+bool FileCache::insert(std::string_view key, const fs::path& file) {
+	std::error_code err;
+	if (const auto size = fs::file_size(file, err); !err && !fits(size)) {
+		SPDLOG_WARN(
+			"{} is {} bytes, over the cache budget of {}", file.string(),
+			size, budget);
+		fs::remove(file, err);
+		return false;
+	}
+	fs::rename(file, path(key), err);
+	if (err) {
+		SPDLOG_ERROR(
+			"Unable to add {} to cache: {}", file.string(), err.message());
+		fs::remove(file, err);
+		return false;
+	}
+	fs::last_write_time(path(key), fs::file_time_type::clock::now(), err);
+	evict(path(key));
+	return true;
+}
+
+void FileCache::setBudget(std::uintmax_t bytes) {
+	if (bytes == budget) { return; }
+	budget = bytes;
+	evict();
+}
+
+void FileCache::evict() { evict({}); }
+
+void FileCache::evict(const fs::path& keep) {
+	auto files = entries(dir);
+	std::uintmax_t total = 0;
+	for (const auto& e : files) { total += e.size; }
+	if (total <= budget) { return; }
+
+	std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+		return a.lastUse < b.lastUse;
+	});
+	for (const auto& e : files) {
+		if (total <= budget) { break; }
+		if (e.path == keep) { continue; }
+		std::error_code err;
+		if (fs::remove(e.path, err)) {
+			SPDLOG_DEBUG("Evicted {} from cache", e.path.string());
+			total -= e.size;
+		}
+	}
+}
+
+std::uintmax_t FileCache::size() const {
+	std::uintmax_t total = 0;
+	for (const auto& e : entries(dir)) { total += e.size; }
+	return total;
+}
@@ -0,0 +1,84 @@
+#include "file_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+class FileCacheTest : public ::testing::Test {
+   protected:
+	fs::path dir = fs::temp_directory_path() / "ffmpeg_node_editor_cache_test";
+
+	void SetUp() override { fs::remove_all(dir); }
+	void TearDown() override { fs::remove_all(dir); }
+
+	fs::path write(std::string_view name, size_t size) {
+		auto p = fs::temp_directory_path() / name;
+		std::ofstream(p, std::ios_base::binary) << std::string(size, 'x');
+		return p;
+	}
+
+	// Make key look used `age` ago
+	void age(const FileCache& cache, std::string_view key, auto age) {
+		fs::last_write_time(
+			cache.path(key), fs::file_time_type::clock::now() - age);
+	}
+};
+
+TEST_F(FileCacheTest, insert) {
+	FileCache cache(dir, 100);
+	EXPECT_FALSE(cache.contains("a"));
+	EXPECT_TRUE(cache.insert("a", write("a", 10)));
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_EQ(cache.size(), 10);
+	EXPECT_EQ(cache.find("a"), cache.path("a"));
+	EXPECT_EQ(cache.find("b"), std::nullopt);
+}
+
+TEST_F(FileCacheTest, evict_least_recently_used) {
+	FileCache cache(dir, 100);
+	EXPECT_TRUE(cache.insert("a", write("a", 40)));
+	EXPECT_TRUE(cache.insert("b", write("b", 40)));
+	age(cache, "a", 2h);
+	age(cache, "b", 1h);
+	(void)cache.find("a");
+
+	EXPECT_TRUE(cache.insert("c", write("c", 40)));
+	EXPECT_TRUE(cache.contains("a"));
+	EXPECT_FALSE(cache.contains("b"));
+	EXPECT_TRUE(cache.contains("c"));
+
+	cache.setBudget(50);
+	EXPECT_FALSE(cache.contains("a"));
+	EXPECT_TRUE(cache.contains("c"));
+}
+
+TEST_F(FileCacheTest, keeps_inserted_file) {
+	FileCache cache(dir, 100);
+	EXPECT_TRUE(cache.insert("a", write("a", 40)));
+	// A clock set back must not make the new file look oldest
+	age(cache, "a", -1h);
+	EXPECT_TRUE(cache.insert("b", write("b", 70)));
+	EXPECT_FALSE(cache.contains("a"));
+	EXPECT_TRUE(cache.contains("b"));
+
+	// Files over the whole budget are refused, leaving the rest alone
+	const auto big = write("c", 101);
+	EXPECT_FALSE(cache.insert("c", big));
+	EXPECT_FALSE(cache.contains("c"));
+	EXPECT_FALSE(fs::exists(big));
+	EXPECT_TRUE(cache.contains("b"));
+}
+
+TEST_F(FileCacheTest, ignores_partial_files) {
+	FileCache cache(dir, 10);
+	std::ofstream(cache.path("x.part"), std::ios_base::binary)
+		<< std::string(100, 'x');
+	cache.evict();
+	EXPECT_TRUE(cache.contains("x.part"));
+	EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,80 @@
+#include "frame_ring.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+FrameRing::FrameRing(int w, int h, size_t s)
+	: width(w),
+	  height(h),
+	  frameBytes(size_t(w) * size_t(h) * 4),
+	  slots(std::max<size_t>(s, 2)),
+	  storage(frameBytes * slots) {}
+
+void FrameRing::reset() {
+	std::lock_guard lock(mutex);
+	read = count = 0;
+	closed = false;
+	published = dropped = 0;
+}
+
+std::uint8_t* FrameRing::acquire(const std::atomic_bool* cancel) {
+	using namespace std::chrono_literals;
+	std::unique_lock lock(mutex);
+	// cancel can't wake the wait, so it is polled
+	while (!closed && count == slots) {
+		if (cancel != nullptr && cancel->load()) { return nullptr; }
+		space.wait_for(lock, 100ms);
+	}
+	if (closed || (cancel != nullptr && cancel->load())) { return nullptr; }
+	// Consuming keeps read + count in place, so the slot stays ours
+	return storage.data() + (read + count) % slots * frameBytes;
+}
+
+void FrameRing::publish() {
+	std::lock_guard lock(mutex);
+	count++;
+	published++;
+}
+
+void FrameRing::close() {
+	{
+		std::lock_guard lock(mutex);
+		closed = true;
+	}
+	space.notify_all();
+}
+
+bool FrameRing::consume(const std::function<void(const std::uint8_t*)>& cb) {
+	size_t slot = 0;
+	{
+		std::lock_guard lock(mutex);
+		if (count == 0) { return false; }
+		dropped += count - 1;
+		read = (read + count - 1) % slots;
+		count = 1;
+		slot = read;
+	}
+	cb(storage.data() + slot * frameBytes);
+	{
+		std::lock_guard lock(mutex);
+		read = (read + 1) % slots;
+		count--;
+	}
+	space.notify_all();
+	return true;
+}
+
+bool FrameRing::isClosed() const {
+	std::lock_guard lock(mutex);
+	return closed;
+}
+
+std::uint64_t FrameRing::getPublished() const {
+	std::lock_guard lock(mutex);
+	return published;
+}
+
+std::uint64_t FrameRing::getDropped() const {
+	std::lock_guard lock(mutex);
+	return dropped;
+}
@@ -0,0 +1,70 @@
+#include "frame_ring.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+	void fill(FrameRing& ring, std::uint8_t value) {
+		auto* frame = ring.acquire();
+		ASSERT_NE(frame, nullptr);
+		std::memset(frame, value, ring.getFrameBytes());
+		ring.publish();
+	}
+}  // namespace
+
+TEST(FrameRing, consumes_newest) {
+	FrameRing ring(2, 2, 3);
+	EXPECT_FALSE(ring.consume([](const std::uint8_t*) {}));
+
+	fill(ring, 1);
+	fill(ring, 2);
+	fill(ring, 3);
+	std::uint8_t seen = 0;
+	EXPECT_TRUE(ring.consume([&](const std::uint8_t* f) { seen = f[15]; }));
+	EXPECT_EQ(seen, 3);
+	EXPECT_EQ(ring.getPublished(), 3);
+	EXPECT_EQ(ring.getDropped(), 2);
+	EXPECT_FALSE(ring.consume([](const std::uint8_t*) {}));
+
+	// Slots wrap around
+	fill(ring, 4);
+	fill(ring, 5);
+	EXPECT_TRUE(ring.consume([&](const std::uint8_t* f) { seen = f[0]; }));
+	EXPECT_EQ(seen, 5);
+}
+
+TEST(FrameRing, full_ring_waits) {
+	using namespace std::chrono_literals;
+	FrameRing ring(2, 2, 2);
+	fill(ring, 1);
+	fill(ring, 2);
+
+	std::atomic_bool acquired = false;
+	std::thread producer([&] {
+		acquired = ring.acquire() != nullptr;
+		if (acquired) { ring.publish(); }
+	});
+	std::this_thread::sleep_for(50ms);
+	EXPECT_FALSE(acquired);
+	EXPECT_TRUE(ring.consume([](const std::uint8_t*) {}));
+	producer.join();
+	EXPECT_TRUE(acquired);
+
+	// Closing wakes a waiting producer empty handed
+	fill(ring, 3);
+	std::thread closed([&] { EXPECT_EQ(ring.acquire(), nullptr); });
+	std::this_thread::sleep_for(50ms);
+	ring.close();
+	closed.join();
+	EXPECT_TRUE(ring.consume([](const std::uint8_t*) {}));
+
+	ring.reset();
+	EXPECT_FALSE(ring.isClosed());
+	EXPECT_EQ(ring.getPublished(), 0);
+	std::atomic_bool cancel = true;
+	EXPECT_EQ(ring.acquire(&cancel), nullptr);
+}
@@ -0,0 +1,99 @@
+#include "job_list.hpp"
+
+#include <fmt/format.h>
+#include <imgui.h>
+
+#include <utility>
+
+#include "imgui_extras.hpp"
+#include "util.hpp"
+
+JobList::~JobList() {
+	cancelAll();
+	// Futures of std::async wait for their thread when destroyed
+	jobs.clear();
+}
+
+void JobList::start(
+	std::string name, const NodeId& node, Task task, bool report) {
+	auto& job = jobs.emplace_back();
+	job.name = std::move(name);
+	job.node = node;
+	job.report = report;
+	job.started = std::chrono::steady_clock::now();
+	job.result = std::async(
+		std::launch::async, [task = std::move(task), cancel = &job.cancel] {
+			return task(cancel);
+		});
+}
+
+void JobList::cancel(const NodeId& node) {
+	for (auto& job : jobs) {
+		if (job.node == node) { job.cancel = true; }
+	}
+}
+
+void JobList::cancelAll() {
+	for (auto& job : jobs) { job.cancel = true; }
+}
+
+void JobList::remap(const std::map<int, NodeId>& ids) {
+	for (auto& job : jobs) {
+		const auto itr = ids.find(job.node.val);
+		job.node = itr == ids.end() ? INVALID_NODE : itr->second;
+	}
+}
+
+const std::string* JobList::running(const NodeId& node) const {
+	for (const auto& job : jobs) {
+		if (job.node == node) { return &job.name; }
+	}
+	return nullptr;
+}
+
+void JobList::collect(
+	const std::function<void(const FilterGraphError&)>& report) {
+	using namespace std::chrono_literals;
+	for (auto itr = jobs.begin(); itr != jobs.end();) {
+		if (itr->result.wait_for(0s) != std::future_status::ready) {
+			++itr;
+			continue;
+		}
+		auto err = itr->result.get();
+		// Whatever failed after a cancel is expected
+		if (itr->report && !itr->cancel) { report(err); }
+		itr = jobs.erase(itr);
+	}
+}
+
+void JobList::draw() {
+	using namespace ImGui;
+	if (jobs.empty()) { return; }
+	if (!CollapsingHeader(
+			fmt::format("Jobs ({})###jobs", jobs.size()).c_str(),
+			ImGuiTreeNodeFlags_DefaultOpen)) {
+		return;
+	}
+	if (!BeginTable("jobs", 3, ImGuiTableFlags_RowBg)) { return; }
+	TableSetupColumn("Job", ImGuiTableColumnFlags_WidthStretch);
+	TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed);
+	TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed);
+	for (auto& job : jobs) {
+		PushID(&job);
+		TableNextRow();
+		TableNextColumn();
+		Text(job.name);
+		TableNextColumn();
+		const std::chrono::duration<double> elapsed =
+			std::chrono::steady_clock::now() - job.started;
+		Text(fmt::format("{:.0f}s", elapsed.count()));
+		TableNextColumn();
+		if (job.cancel) {
+			TextDisabled("Stopping...");
+		} else if (SmallButton("Cancel")) {
+			job.cancel = true;
+		}
+		PopID();
+	}
+	EndTable();
+}
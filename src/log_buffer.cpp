@@ -0,0 +1,117 @@
+#include "log_buffer.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "string_utils.hpp"
+
+namespace {
+	bool isError(std::string_view line) {
+		for (auto word : {"error", "invalid", "failed", "unable", "no such"}) {
+			if (str::contains(line, word, true)) { return true; }
+		}
+		return false;
+	}
+}  // namespace
+
+LogBuffer::LogBuffer(size_t capacity) : ring(std::max<size_t>(capacity, 1)) {}
+
+void LogBuffer::scanLines(std::string_view data) {
+	for (auto idx = data.find('\n'); idx != std::string_view::npos;
+		 idx = data.find('\n')) {
+		const auto end = total + idx + 1;
+		if (line.size() < LINE_LIMIT) {
+			line += data.substr(0, std::min(idx, LINE_LIMIT - line.size()));
+		}
+		if (errors.size() < ERROR_LINES && isError(line)) {
+			errors.emplace_back(end, line + "\n");
+		}
+		line.clear();
+		total = end;
+		data.remove_prefix(idx + 1);
+	}
+	if (line.size() < LINE_LIMIT) {
+		line += data.substr(0, std::min(data.size(), LINE_LIMIT - line.size()));
+	}
+	total += data.size();
+}
+
+void LogBuffer::append(std::string_view data) {
+	std::lock_guard lock(mutex);
+	scanLines(data);
+
+	const auto capacity = ring.size();
+	if (data.size() >= capacity) {
+		dropped += size + data.size() - capacity;
+		data.remove_prefix(data.size() - capacity);
+		std::memcpy(ring.data(), data.data(), capacity);
+		begin = 0;
+		size = capacity;
+		return;
+	}
+
+	const auto overflow = (size + data.size() > capacity)
+							  ? size + data.size() - capacity
+							  : 0;
+	begin = (begin + overflow) % capacity;
+	size -= overflow;
+	dropped += overflow;
+
+	// Up to two copies, the second one wraps around to the start
+	const auto end = (begin + size) % capacity;
+	const auto first = std::min(data.size(), capacity - end);
+	std::memcpy(ring.data() + end, data.data(), first);
+	std::memcpy(ring.data(), data.data() + first, data.size() - first);
+	size += data.size();
+}
+
+void LogBuffer::clear() {
+	std::lock_guard lock(mutex);
+	begin = size = 0;
+	total = dropped = 0;
+	errors.clear();
+	line.clear();
+}
+
+bool LogBuffer::empty() const {
+	std::lock_guard lock(mutex);
+	return size == 0;
+}
+
+void LogBuffer::read(const std::function<void(std::string_view)>& cb) const {
+	std::lock_guard lock(mutex);
+	if (dropped > 0) {
+		for (const auto& [end, text] : errors) {
+			if (end <= dropped) { cb(text); }
+		}
+		cb(fmt::format("[... {} bytes skipped ...]\n", dropped));
+	}
+	const auto first = std::min(size, ring.size() - begin);
+	if (first > 0) { cb({ring.data() + begin, first}); }
+	if (size > first) { cb({ring.data(), size - first}); }
+}
+
+std::string LogBuffer::str() const {
+	std::string result;
+	read([&](std::string_view piece) { result += piece; });
+	return result;
+}
+
+LogBuffer& processLog() {
+	constexpr size_t CAPACITY = 256 * 1024;
+	static LogBuffer log(CAPACITY);
+	return log;
+}
+
+void logProcess(const std::vector<std::string>& args, std::string_view output) {
+	constexpr size_t COMMAND_LIMIT = 256;
+	auto command = fmt::format("{}", fmt::join(args, " "));
+	if (command.size() > COMMAND_LIMIT) {
+		command.resize(COMMAND_LIMIT);
+		command += "...";
+	}
+	processLog().append(fmt::format("$ {}\n{}", command, output));
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "log_buffer.hpp"
+
+TEST(LogBuffer, keeps_everything_below_capacity) {
+	LogBuffer log(16);
+	EXPECT_TRUE(log.empty());
+	log.append("abc\n");
+	log.append("def\n");
+	EXPECT_EQ(log.str(), "abc\ndef\n");
+	log.clear();
+	EXPECT_TRUE(log.empty());
+	EXPECT_EQ(log.str(), "");
+}
+
+TEST(LogBuffer, wraps_around) {
+	LogBuffer log(8);
+	log.append("0123456");
+	log.append("789");
+	EXPECT_EQ(log.str(), "[... 2 bytes skipped ...]\n23456789");
+
+	// Read hands out the wrapped ring in two pieces
+	auto pieces = 0;
+	std::string text;
+	log.read([&](std::string_view piece) {
+		pieces++;
+		text += piece;
+	});
+	EXPECT_EQ(pieces, 3);
+	EXPECT_EQ(text, log.str());
+
+	log.append("a longer chunk than the ring");
+	EXPECT_EQ(log.str(), "[... 30 bytes skipped ...]\nthe ring");
+}
+
+TEST(LogBuffer, keeps_error_lines) {
+	LogBuffer log(64);
+	log.append("frame=1\nInvalid argument\nframe=2\n");
+	// Errors still in the ring are not repeated
+	EXPECT_EQ(log.str(), "frame=1\nInvalid argument\nframe=2\n");
+
+	for (auto i = 0; i < 10; ++i) { log.append("frame=3\n"); }
+	const auto text = log.str();
+	EXPECT_EQ(text.find("Invalid argument\n[... "), 0);
+	EXPECT_EQ(text.find("frame=1"), std::string::npos);
+	EXPECT_TRUE(text.ends_with("frame=3\nframe=3\nframe=3\nframe=3\n"));
+}
@@ -0,0 +1,27 @@
+#include "log_window.hpp"
+
+#include <imgui.h>
+
+#include <string_view>
+
+#include "log_buffer.hpp"
+
+void LogWindow::draw() {
+	if (!isOpen) { return; }
+	using namespace ImGui;
+	if (Begin("ffmpeg Log", &isOpen)) {
+		if (Button("Clear")) { log->clear(); }
+		SameLine();
+		if (Button("Copy")) { SetClipboardText(log->str().c_str()); }
+
+		BeginChild(
+			"log", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
+		// Pieces point into the ring, drawn while it is locked
+		log->read([](std::string_view piece) {
+			TextUnformatted(piece.data(), piece.data() + piece.size());
+		});
+		if (GetScrollY() >= GetScrollMaxY()) { SetScrollHereY(1.0f); }
+		EndChild();
+	}
+	End();
+}
@@ -3,15 +3,24 @@
 
 #include <algorithm>
 #include <backward.hpp>
+#include <csignal>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <tuple>
 #include <vector>
 
 #include "backend.hpp"
+#include "batch_window.hpp"
 #include "ffmpeg/profile.hpp"
 #include "file_utils.hpp"
+#include "log_buffer.hpp"
+#include "log_window.hpp"
 #include "node_editor.hpp"
 #include "pref.hpp"
+#include "preview_panel.hpp"
+#include "thumbnail_atlas.hpp"
 #include "util.hpp"
 
 enum MenuAction {
@@ -20,11 +29,19 @@ enum MenuAction {
 	MenuActionOpen,
 	MenuActionSave,
 	MenuActionPreference,
+	MenuActionBatch,
+	MenuActionLog,
+	MenuActionCompact,
 };
 
 class Application {
 	Preference pref;
 	Profile profile;
+	BatchWindow batch;
+	LogWindow log{processLog()};
+	// Need the window backend, so they are made after setting that up
+	std::unique_ptr<ThumbnailAtlas> atlas;
+	std::unique_ptr<PreviewPanel> preview;
 
 	ImNodesContext* ctx;
 	std::vector<NodeEditor> editors;
@@ -41,7 +58,7 @@ class Application {
 				});
 			if (itr == editors.end()) {
 				NodeEditor e(profile, "");
-				if (e.load(path.value())) { editors.push_back(e); }
+				if (e.load(path.value())) { editors.push_back(std::move(e)); }
 			} else {
 				ImGui::SetWindowFocus(itr->getName().c_str());
 			}
@@ -79,15 +96,70 @@ class Application {
 				pref.isOpen = !pref.isOpen;
 				return;
 
+			case MenuActionCompact:
+				if (focusedEditor != -1) { editors[focusedEditor].compact(); }
+				return;
+
+			case MenuActionBatch:
+				if (focusedEditor != -1) {
+					batch.suggestGraph(editors[focusedEditor].getPath());
+				}
+				batch.isOpen = !batch.isOpen;
+				return;
+
+			case MenuActionLog:
+				log.isOpen = !log.isOpen;
+				return;
+
 			case MenuActionNone: {
 			}
 		}
 	}
 
-   public:
-	Application() : profile(GetProfile()) {
+	static Profile loadProfile(Preference& pref) {
 		pref.load();
+		const JobLimits limits{
+			double(pref.jobTimeout), double(pref.stallTimeout)};
+		auto local = std::make_shared<LocalBackend>();
+		if (pref.workers.empty()) { return GetProfile(local, limits); }
+		auto remote = std::make_shared<RemoteBackend>(pref.workers);
+		const Runner runner("ffmpeg", remote);
+		if (runner.lineScanner({"-version"}, nullptr) == 0) {
+			return GetProfile(remote, limits);
+		}
+		SPDLOG_ERROR(
+			"workers {} are not reachable, using local ffmpeg", pref.workers);
+		return GetProfile(local, limits);
+	}
+
+	// Cache preferences last applied, they only change in the preferences
+	// window
+	std::optional<std::tuple<bool, int, bool, int, int>> cacheSettings;
+
+	void configureCaches() {
+		constexpr std::uintmax_t MIB = 1024 * 1024;
+		const std::tuple settings{
+			pref.useProxies, pref.proxyCacheSize, pref.cacheIntermediates,
+			pref.renderCacheSize, pref.previewCacheSize};
+		if (settings == cacheSettings) { return; }
+		cacheSettings = settings;
+		if (profile.proxies) {
+			profile.proxies->configure(
+				pref.useProxies, std::uintmax_t(pref.proxyCacheSize) * MIB);
+		}
+		if (profile.renders) {
+			profile.renders->configure(
+				pref.cacheIntermediates,
+				std::uintmax_t(pref.renderCacheSize) * MIB);
+		}
+		if (profile.previews) {
+			profile.previews->setBudget(
+				std::uintmax_t(pref.previewCacheSize) * MIB);
+		}
+	}
 
+   public:
+	Application() : profile(loadProfile(pref)), batch(profile) {
 		if (!Window::InitWindow(ImGuiConfigFlags_NavEnableKeyboard, pref)) {
 			throw std::runtime_error("Unable to initialize window");
 		}
@@ -96,18 +168,29 @@ class Application {
 
 		// Setup Platform/Renderer backends
 		Window::Setup();
+		const TextureFunctions textures{
+			Window::CreateTexture, Window::UpdateTexture,
+			Window::DestroyTexture};
+		atlas = std::make_unique<ThumbnailAtlas>(
+			profile.thumbnails.get(), textures);
+		preview = std::make_unique<PreviewPanel>(textures);
 		Window::AddMenu(
 			"File",
 			{
 				{"New", MenuActionNew, ImGuiKey_N, true},
 				{"Open..", MenuActionOpen, ImGuiKey_O, true},
 				{"Save", MenuActionSave, ImGuiKey_S, true},
+				{"Compact Graph", MenuActionCompact, ImGuiKey_K, true},
+				{"Batch..", MenuActionBatch, ImGuiKey_B, true},
+				{"ffmpeg Log", MenuActionLog, ImGuiKey_L, true},
 				{"Preferences", MenuActionPreference, ImGuiKey_Comma, true},
 			});
 
 		ctx = ImNodes::CreateContext();
 
 		pref.setOptions();
+		// Before any graph is loaded, so its inputs get proxies
+		configureCaches();
 	}
 
 	Application(const Application&) = delete;
@@ -116,6 +199,8 @@ class Application {
 	Application& operator=(Application&&) = delete;
 
 	~Application() {
+		atlas.reset();
+		preview.reset();
 		ImNodes::DestroyContext(ctx);
 		Window::Shutdown();
 	}
@@ -127,7 +212,7 @@ class Application {
 			focusedEditor = -1;
 			for (auto i = 0; i < editors.size(); ++i) {
 				auto focused = false;
-				editors[i].draw(pref, focused);
+				editors[i].draw(pref, *atlas, *preview, focused);
 				if (focused) { focusedEditor = i; }
 				if (editors[i].isClosed()) {
 					std::swap(editors[i], editors.back());
@@ -136,11 +221,18 @@ class Application {
 			}
 
 			pref.draw();
+			batch.draw();
+			log.draw();
+			preview->draw();
+			configureCaches();
 
 			constexpr ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 			Window::Render(clear_color);
 		}
 
+		// Jobs left running are killed, stopping them gently could keep
+		// the window up for seconds
+		Runner::shutdown();
 		while (!editors.empty()) {
 			editors.back().close();
 			editors.pop_back();
@@ -155,6 +247,11 @@ namespace backward {
 
 int main() {
 	spdlog::set_level(spdlog::level::trace);
+#if !defined(APP_OS_WINDOWS)
+	// Writes to the pipes of finished ffmpeg runs fail instead of ending
+	// the editor
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
 	Application app;
 	app.main();
 	return 0;
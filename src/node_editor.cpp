@@ -4,22 +4,23 @@
 #include <imgui_stdlib.h>
 
 #include <algorithm>
-#include <fstream>
 #include <iterator>
-#include <nlohmann/json.hpp>
+#include <optional>
 #include <utility>
 
 #include "ffmpeg/filter.hpp"
 #include "ffmpeg/filter_graph.hpp"
 #include "ffmpeg/filter_node.hpp"
 #include "ffmpeg/profile.hpp"
+#include "ffmpeg/waveform.hpp"
 #include "file_utils.hpp"
+#include "frame_ring.hpp"
 #include "imgui_extras.hpp"
 #include "string_utils.hpp"
 #include "util.hpp"
 
 NodeEditor::NodeEditor(const Profile& p, std::string n)
-	: g(p), name(std::move(n)) {
+	: g(p), waveformCache(p.waveforms), name(std::move(n)) {
 	context = std::shared_ptr<ImNodesEditorContext>(
 		ImNodes::EditorContextCreate(), ImNodes::EditorContextFree);
 }
@@ -134,12 +135,56 @@ void drawAttribute(
 	ImNodes::PopColorStyle();
 }
 
+constexpr float WAVEFORM_HEIGHT = 24;
+
+// Peaks as lines from min to max, with the rms band over them brighter
+void drawWaveform(const Waveform& waveform, ImU32 color) {
+	const ImVec2 size(ThumbnailCache::WIDTH, WAVEFORM_HEIGHT);
+	const auto pos = ImGui::GetCursorScreenPos();
+	ImGui::Dummy(size);
+	auto* drawList = ImGui::GetWindowDrawList();
+	const auto mid = pos.y + WAVEFORM_HEIGHT / 2;
+	auto y = [&](float v) {
+		return mid - std::clamp(v, -1.0f, 1.0f) * WAVEFORM_HEIGHT / 2;
+	};
+	const auto peaks = waveform.columns(ThumbnailCache::WIDTH);
+	const auto dim = (color & ~IM_COL32_A_MASK) | IM_COL32(0, 0, 0, 128);
+	for (auto i = 0U; i < peaks.size(); ++i) {
+		const auto x = pos.x + float(i) + 0.5f;
+		const auto& p = peaks[i];
+		drawList->AddLine(ImVec2(x, y(p.max)), ImVec2(x, y(p.min)), dim);
+		drawList->AddLine(ImVec2(x, y(p.rms)), ImVec2(x, y(-p.rms)), color);
+	}
+}
+
 void NodeEditor::drawNode(
-	const Style& style, const FilterNode& node, const NodeId& id) {
+	const Preference& pref, const FilterNode& node, const NodeId& id,
+	ThumbnailAtlas* atlas) {
+	const auto& style = pref.style;
 	using namespace ImGui;
 
 	PushID(&node);
 
+	// Heatmap of the last profileCosts, green to red by cpu
+	// Copied as option edits below drop the costs
+	const auto* found = g.cost(id);
+	const auto cost = found ? std::optional<NodeCost>(*found) : std::nullopt;
+	if (cost.has_value()) {
+		const auto maxCost = g.maxCost();
+		const auto t = maxCost > 0 ? float(cost->cpu / maxCost) : 0.0f;
+		const ImColor col(0.2f + 0.6f * t, 0.6f - 0.45f * t, 0.2f - 0.1f * t);
+		const ImColor active(col.Value.x, col.Value.y, col.Value.z, 0.85f);
+		ImNodes::PushColorStyle(ImNodesCol_TitleBar, col);
+		ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, active);
+		ImNodes::PushColorStyle(ImNodesCol_TitleBarSelected, active);
+	}
+
+	const auto failed = id == failedNodeId;
+	if (failed) {
+		ImNodes::PushColorStyle(
+			ImNodesCol_NodeOutline, ImColor(0.85f, 0.2f, 0.2f));
+	}
+
 	const auto nodeId = id.val;
 	ImNodes::BeginNode(nodeId);
 
@@ -154,6 +199,11 @@ void NodeEditor::drawNode(
 		BeginHorizontal(&nodeId);
 		Spring();
 		Text(node.name);
+		if (cost.has_value() && IsItemHovered()) {
+			SetTooltip(
+				"%.3fs cpu added, %.3fs till here\n%.1f fps, %.1f fps lost",
+				cost->cpu, cost->prefixCpu, cost->fps, cost->fpsDrop);
+		}
 		Spring();
 		EndHorizontal();
 		SuspendLayout();
@@ -161,6 +211,35 @@ void NodeEditor::drawNode(
 		ResumeLayout();
 	}
 
+	if (auto key = thumbnailKeys.find(id.val);
+		atlas != nullptr && key != thumbnailKeys.end()) {
+		if (auto r = atlas->find(key->second)) {
+			const ImVec2 size(ThumbnailCache::WIDTH, ThumbnailCache::HEIGHT);
+			BeginHorizontal("thumbnail");
+			Spring();
+			Image(r->texture, size, r->uv0, r->uv1);
+			Spring();
+			EndHorizontal();
+		}
+	}
+
+	if (auto key = waveformKeys.find(id.val);
+		pref.showWaveforms && waveformCache != nullptr &&
+		key != waveformKeys.end()) {
+		// Only nodes in view get their waveform read
+		if (IsRectVisible(ImVec2(ThumbnailCache::WIDTH, WAVEFORM_HEIGHT))) {
+			visibleWaveforms.insert(id.val);
+		}
+		if (auto w = waveformCache->find(key->second);
+			w != nullptr && w->getSamples() > 0) {
+			BeginHorizontal("waveform");
+			Spring();
+			drawWaveform(*w, style.colors.at(StyleColor::AudioSocket));
+			Spring();
+			EndHorizontal();
+		}
+	}
+
 	std::vector<std::pair<ImVec2, ImColor>> pins;
 
 	{
@@ -214,8 +293,37 @@ void NodeEditor::drawNode(
 		PopID();
 	}
 
+	if (const auto* job = jobs.running(id)) {
+		BeginHorizontal(&jobs);
+		TextDisabled("%s", job->c_str());
+		Spring();
+		if (SmallButton("Cancel")) { jobs.cancel(id); }
+		EndHorizontal();
+	}
+
+	switch (g.proxyState(id)) {
+		case ProxyState::Pending:
+			TextDisabled("Generating proxy...");
+			break;
+		case ProxyState::Ready:
+			TextDisabled("Proxy ready");
+			break;
+		case ProxyState::Failed:
+			TextDisabled("Proxy failed");
+			break;
+		case ProxyState::TooLarge:
+			TextDisabled("Proxy too large for the cache");
+			break;
+		case ProxyState::None:
+			break;
+	}
+
 	EndVertical();
 	ImNodes::EndNode();
+	if (failed) { ImNodes::PopColorStyle(); }
+	if (cost.has_value()) {
+		for (auto i = 0; i < 3; ++i) { ImNodes::PopColorStyle(); }
+	}
 
 	PopID();
 }
@@ -315,8 +423,27 @@ void drawNodeOptions(
 	}
 }
 
+void reportError(const FilterGraphError& err) {
+	switch (err.code) {
+		case FilterGraphErrorCode::PLAYER_MISSING_INPUT:
+			showErrorMessage("Missing Input", err.message);
+			break;
+		case FilterGraphErrorCode::PLAYER_RUNTIME:
+			showErrorMessage("ffmpeg Error", err.message);
+			break;
+		case FilterGraphErrorCode::PLAYER_UNSUPPORTED:
+			showErrorMessage("Unsupported", err.message);
+			break;
+		case FilterGraphErrorCode::PLAYER_NO_ERROR:
+			return;
+	}
+	SPDLOG_ERROR("Error while playing: {}", err.message);
+}
+
 void handleNodeOptions(
-	FilterGraph& g, NodeId& selectedNodeId, const Preference& pref,
+	FilterGraph& g, JobList& jobs,
+	std::vector<std::shared_ptr<JobOutcome>>& outcomes, NodeId& selectedNodeId,
+	const Preference& pref, PreviewPanel& panel, const Segment& window,
 	bool& searchStarted, ImGuiTextFilter& searchFilter) {
 	constexpr auto POPUP_NODE_OPTIONS = "Node Options";
 	int hoveredId = INVALID_NODE.val;
@@ -329,18 +456,117 @@ void handleNodeOptions(
 
 	if (ImGui::BeginPopup(POPUP_NODE_OPTIONS)) {
 		auto& node = g.getNode(selectedNodeId);
+		// Jobs run on a copy, the graph stays editable meanwhile
 		if (ImGui::Selectable("Play till this node")) {
 			ImGui::CloseCurrentPopup();
-			auto err = g.play(pref, selectedNodeId);
-			if (err.code == FilterGraphErrorCode::PLAYER_MISSING_INPUT) {
-				showErrorMessage("Missing Input", err.message);
-				SPDLOG_ERROR("Error while playing: {}", err.message);
-			} else if (err.code == FilterGraphErrorCode::PLAYER_RUNTIME) {
-				showErrorMessage("ffmpeg Error", err.message);
-				SPDLOG_ERROR("Error while playing: {}", err.message);
+			// Workers can't stream back, their previews go to the player
+			if (pref.playInEditor && g.canStream()) {
+				jobs.start(
+					"Playing " + node.name, selectedNodeId,
+					[g, pref, id = selectedNodeId, window,
+					 ring = panel.open(node.name)](
+						const std::atomic_bool* cancel) mutable {
+						return g.stream(pref, *ring, id, window, cancel);
+					});
+			} else {
+				jobs.start(
+					"Playing " + node.name, selectedNodeId,
+					[g, pref, id = selectedNodeId,
+					 window](const std::atomic_bool* cancel) mutable {
+						return g.play(pref, id, window, cancel);
+					});
+			}
+		}
+
+		// Shared upstream nodes are decoded and filtered once for all
+		if (ImNodes::NumSelectedNodes() > 1 &&
+			ImGui::Selectable("Play selected nodes together")) {
+			ImGui::CloseCurrentPopup();
+			std::vector<int> selected(ImNodes::NumSelectedNodes());
+			ImNodes::GetSelectedNodes(selected.data());
+			std::vector<NodeId> ids;
+			for (auto id : selected) {
+				ids.push_back({static_cast<IdBaseType>(id)});
+			}
+			const auto name = fmt::format("{} nodes", ids.size());
+			if (pref.playInEditor && g.canStream()) {
+				jobs.start(
+					"Playing " + name, selectedNodeId,
+					[g, pref, ids, window, ring = panel.open(name)](
+						const std::atomic_bool* cancel) mutable {
+						return g.streamTogether(
+							pref, *ring, ids, window, cancel);
+					});
+			} else {
+				jobs.start(
+					"Playing " + name, selectedNodeId,
+					[g, pref, ids,
+					 window](const std::atomic_bool* cancel) mutable {
+						return g.playTogether(pref, ids, window, cancel);
+					});
 			}
 		}
 
+		if (ImGui::Selectable("Render till this node")) {
+			ImGui::CloseCurrentPopup();
+			if (auto dest = saveFile("*.mkv"); dest.has_value()) {
+				jobs.start(
+					"Rendering " + dest->filename().string(), selectedNodeId,
+					[g, dest = dest.value(),
+					 id = selectedNodeId](const std::atomic_bool* cancel) {
+						return g.render(dest, id, 0, cancel);
+					});
+			}
+		}
+
+		if (ImGui::Selectable("Tune threads till this node")) {
+			ImGui::CloseCurrentPopup();
+			jobs.start(
+				"Tuning " + node.name, selectedNodeId,
+				[g, id = selectedNodeId](const std::atomic_bool* cancel) {
+					return g.tune(id, cancel);
+				});
+		}
+
+		// Results are shown and kept by draw, on this thread
+		if (ImGui::Selectable("Benchmark this node")) {
+			ImGui::CloseCurrentPopup();
+			auto outcome = outcomes.emplace_back(std::make_shared<JobOutcome>());
+			jobs.start(
+				"Benchmarking " + node.name, selectedNodeId,
+				[g, id = selectedNodeId,
+				 outcome](const std::atomic_bool* cancel) {
+					BenchmarkResult result;
+					auto err =
+						g.benchmark(id, BENCHMARK_REPETITIONS, result, cancel);
+					if (err.code == FilterGraphErrorCode::PLAYER_NO_ERROR) {
+						outcome->apply = [text = formatBenchmark(result)](
+											 FilterGraph&) {
+							showInfoMessage("Benchmark", text);
+						};
+					}
+					outcome->done = true;
+					return err;
+				});
+		}
+
+		if (ImGui::Selectable("Profile cost till this node")) {
+			ImGui::CloseCurrentPopup();
+			auto outcome = outcomes.emplace_back(std::make_shared<JobOutcome>());
+			jobs.start(
+				"Profiling " + node.name, selectedNodeId,
+				[copy = std::make_shared<FilterGraph>(g), id = selectedNodeId,
+				 outcome](const std::atomic_bool* cancel) {
+					auto err = copy->profileCosts(id, cancel);
+					// Runs finished before a failure or cancel are kept too
+					outcome->apply = [copy](FilterGraph& g) {
+						g.takeCosts(*copy);
+					};
+					outcome->done = true;
+					return err;
+				});
+		}
+
 		if (node.option.size() < node.base().options.size()) {
 			drawNodeOptions(
 				g, node, searchStarted, searchFilter, selectedNodeId);
@@ -367,24 +593,177 @@ void handleLinks(FilterGraph& g) {
 	}
 }
 
-void NodeEditor::handleEdits(const Preference& pref) {
+void NodeEditor::handleEdits(const Preference& pref, PreviewPanel& panel) {
 	handleNodeAddition(g, searchStarted, searchFilter);
 	handleNodeDeletion(g);
-	handleNodeOptions(g, selectedNodeId, pref, searchStarted, searchFilter);
+	handleNodeOptions(
+		g, jobs, outcomes, selectedNodeId, pref, panel, previewWindow(),
+		searchStarted, searchFilter);
 	handleLinks(g);
 }
 
-void NodeEditor::draw(const Preference& pref, bool& focused) {
+void drawPreviewWindow(std::string& start, std::string& duration) {
+	using namespace ImGui;
+	const auto width = CalcTextSize("00:00:00.000").x;
+	auto field = [width](const char* label, const char* hint,
+						 std::string& value) {
+		PushItemWidth(width);
+		InputTextWithHint(label, hint, &value);
+		PopItemWidth();
+		if (double t = 0; !value.empty() && !str::stotime(value, t)) {
+			SetItemTooltip("Expected [[HH:]MM:]SS[.m]");
+		}
+	};
+
+	BeginHorizontal("preview_window");
+	TextUnformatted("Preview from");
+	field("##start", "00:00:00", start);
+	TextUnformatted("for");
+	field("##duration", "till end", duration);
+	EndHorizontal();
+}
+
+Segment NodeEditor::previewWindow() const {
+	Segment window{0, 0};
+	(void)str::stotime(previewStart, window.start);
+	(void)str::stotime(previewDuration, window.duration);
+	return window;
+}
+
+// Thumbnails of every node come from one background job, started again
+// once it is done if the graph or the time changed meanwhile
+void NodeEditor::refreshThumbnails(const Preference& pref) {
+	if (!pref.showThumbnails) { return; }
+	const auto time = previewWindow().start;
+	const std::pair request{g.getRevision(), time};
+	if (request == thumbnailRequest || !thumbnailJobs.empty()) { return; }
+	thumbnailRequest = request;
+	thumbnailKeys = g.thumbnailKeys(time);
+	thumbnailJobs.start(
+		"Thumbnails", INVALID_NODE,
+		[g = g, time](const std::atomic_bool* cancel) {
+			return g.thumbnails(time, cancel);
+		},
+		false);
+}
+
+// Reading hours of audio takes a while, so the job reads only the nodes
+// in view that have no waveform yet, and an edit cancels it only if it
+// changed one of them. Finished waveforms stay cached.
+void NodeEditor::refreshWaveforms(const Preference& pref) {
+	if (!pref.showWaveforms || waveformCache == nullptr) { return; }
+	if (g.getRevision() != waveformRevision) {
+		waveformRevision = g.getRevision();
+		waveformKeys = g.waveformKeys();
+	}
+	if (!waveformJobs.empty()) {
+		for (const auto& [id, key] : waveformsQueued) {
+			const auto itr = waveformKeys.find(id);
+			if (itr != waveformKeys.end() && itr->second == key) { continue; }
+			waveformJobs.cancelAll();
+			// Whatever the job doesn't finish is asked for again
+			for (const auto& [_, queued] : waveformsQueued) {
+				waveformsAsked.erase(queued);
+			}
+			break;
+		}
+		return;
+	}
+
+	waveformsQueued.clear();
+	for (auto id : visibleWaveforms) {
+		const auto itr = waveformKeys.find(id);
+		if (itr == waveformKeys.end() ||
+			waveformCache->contains(itr->second) ||
+			!waveformsAsked.insert(itr->second).second) {
+			continue;
+		}
+		waveformsQueued.insert(*itr);
+	}
+	if (waveformsQueued.empty()) { return; }
+	waveformJobs.start(
+		"Waveforms", INVALID_NODE,
+		[g = g, keys = waveformsQueued](const std::atomic_bool* cancel) {
+			return g.waveforms(keys, cancel);
+		},
+		false);
+}
+
+// Everything kept by node id moves along with the graph, the positions
+// and selection of ImNodes included
+void NodeEditor::compactGraph() {
+	compactRequested = false;
+	std::vector<std::pair<int, ImVec2>> positions;
+	g.iterateNodes([&](const FilterNode&, const NodeId& id) {
+		positions.emplace_back(id.val, ImNodes::GetNodeGridSpacePos(id.val));
+	});
+	std::vector<int> selected(ImNodes::NumSelectedNodes());
+	if (!selected.empty()) { ImNodes::GetSelectedNodes(selected.data()); }
+
+	const auto ids = g.compact();
+	auto remap = [&ids](int id) {
+		const auto itr = ids.find(id);
+		return itr == ids.end() ? INVALID_NODE : itr->second;
+	};
+	for (const auto& [id, position] : positions) {
+		ImNodes::SetNodeGridSpacePos(remap(id).val, position);
+	}
+	ImNodes::ClearNodeSelection();
+	ImNodes::ClearLinkSelection();
+	for (auto id : selected) {
+		if (const auto node = remap(id); node != INVALID_NODE) {
+			ImNodes::SelectNode(node.val);
+		}
+	}
+
+	selectedNodeId = remap(selectedNodeId.val);
+	failedNodeId = remap(failedNodeId.val);
+	for (auto* keys : {&thumbnailKeys, &waveformKeys, &waveformsQueued}) {
+		std::map<IdBaseType, std::uint64_t> moved;
+		for (const auto& [id, key] : *keys) {
+			if (const auto node = remap(id); node != INVALID_NODE) {
+				moved[node.val] = key;
+			}
+		}
+		*keys = std::move(moved);
+	}
+	visibleWaveforms.clear();
+	jobs.remap(ids);
+}
+
+void NodeEditor::draw(
+	const Preference& pref, ThumbnailAtlas& atlas, PreviewPanel& panel,
+	bool& focused) {
 	constexpr auto minimapFraction = 0.2f;
+	jobs.collect([&](const FilterGraphError& err) {
+		failedNodeId = err.node;
+		reportError(err);
+	});
+	thumbnailJobs.collect(reportError);
+	waveformJobs.collect(reportError);
+	for (auto itr = outcomes.begin(); itr != outcomes.end();) {
+		if (!(*itr)->done) {
+			++itr;
+			continue;
+		}
+		if ((*itr)->apply) { (*itr)->apply(g); }
+		itr = outcomes.erase(itr);
+	}
+	refreshThumbnails(pref);
+	refreshWaveforms(pref);
+	visibleWaveforms.clear();
 	if (ImGui::Begin(
 			getName().c_str(), &isOpen,
 			ImGui::UnsavedDocumentFlag(g.changed()))) {
 		focused = ImGui::IsWindowFocused(ImGuiFocusedFlags_ChildWindows);
+		drawPreviewWindow(previewStart, previewDuration);
+		jobs.draw();
 		ImNodes::EditorContextSet(context.get());
 		ImNodes::BeginNodeEditor();
 
+		auto* thumbnails = pref.showThumbnails ? &atlas : nullptr;
 		g.iterateNodes([&](const FilterNode& node, const NodeId& id) {
-			drawNode(pref.style, node, id);
+			drawNode(pref, node, id, thumbnails);
 		});
 
 		g.iterateLinks([](const LinkId& id, const NodeId& s, const NodeId& d) {
@@ -394,7 +773,8 @@ void NodeEditor::draw(const Preference& pref, bool& focused) {
 		ImNodes::MiniMap(minimapFraction, ImNodesMiniMapLocation_BottomRight);
 		ImNodes::EndNodeEditor();
 
-		if (focused) { handleEdits(pref); }
+		if (compactRequested) { compactGraph(); }
+		if (focused) { handleEdits(pref, panel); }
 
 		ImNodes::EditorContextSet(nullptr);
 	}
@@ -421,100 +801,20 @@ void NodeEditor::close() {
 		case UnsavedDocumentAction::NO_OP:
 			break;
 	}
+	if (!isOpen) { jobs.cancelAll(); }
 }
 
-namespace nlohmann {
-	template <> struct adl_serializer<NodeId> {
-		static void to_json(nlohmann::json& j, const NodeId& id) { j = id.val; }
-	};
-}  // namespace nlohmann
-
 bool NodeEditor::save() {
 	if (getPath().empty()) {
 		auto path = saveFile("*.json");
 		if (!path.has_value()) { return false; }
 		setPath(path.value());
 	}
-	nlohmann::json obj;
-	obj["nodes"] = nlohmann::json::array();
-	g.iterateNodes(
-		[&](const FilterNode& node, const NodeId& id) {
-			nlohmann::json elem;
-			elem["id"] = id;
-			elem["name"] = node.name;
-			const auto& options = node.base().options;
-			for (const auto& [optIdx, optValue] : node.option) {
-				nlohmann::json opt;
-				opt["key"] = options[optIdx].name;
-				opt["value"] = optValue;
-				elem["option"].push_back(opt);
-			}
-			elem["inputs"] = node.inputSocketIds;
-			elem["outputs"] = node.outputSocketIds;
-			g.inputSockets(
-				id, [&](const Socket&, const NodeId& dest, const NodeId& src) {
-					elem["edges"].push_back({{"src", src}, {"dest", dest}});
-				});
-			obj["nodes"].push_back(elem);
-		},
-		NodeIterOrder::Topological);
-	std::ofstream o(path, std::ios_base::binary);
-	g.resetChanged();
-	o << std::setw(4) << obj;
-	return true;
+	return g.save(path);
 }
 
 bool NodeEditor::load(const std::filesystem::path& path) {
-	nlohmann::json json;
-	try {
-		json = nlohmann::json::parse(std::ifstream(path));
-	} catch (nlohmann::json::exception&) { return false; }
-	g.clear();
-	std::map<int, NodeId> mapping;
-	for (const auto& elem : json["nodes"]) {
-		auto id = elem["id"].template get<int>();
-		auto name = elem["name"].template get<std::string>();
-		const auto& base = std::find_if(
-			g.allFilters().begin(), g.allFilters().end(),
-			[&](const Filter& filter) { return filter.name == name; });
-		auto nId = g.addNode(*base);
-		mapping[id] = nId;
-
-		if (elem.contains("option")) {
-			for (const auto& opt : elem["option"]) {
-				auto name = opt["key"].template get<std::string>();
-				auto value = opt["value"].template get<std::string>();
-				const auto& optionBase = std::find_if(
-					base->options.begin(), base->options.end(),
-					[&](const Option& option) { return option.name == name; });
-
-				auto optId = std::distance(base->options.begin(), optionBase);
-				g.getNode(nId).option[optId] = value;
-				g.optHook(nId, optId, value);
-			}
-		}
-
-		{
-			const auto& sockets = g.getNode(nId).inputSocketIds;
-			const auto& ints = elem["inputs"].template get<std::vector<int>>();
-			const auto limit = std::min(sockets.size(), ints.size());
-			for (auto i = 0u; i < limit; ++i) { mapping[ints[i]] = sockets[i]; }
-		}
-		{
-			const auto& sockets = g.getNode(nId).outputSocketIds;
-			const auto& ints = elem["outputs"].template get<std::vector<int>>();
-			const auto limit = std::min(sockets.size(), ints.size());
-			for (auto i = 0u; i < limit; ++i) { mapping[ints[i]] = sockets[i]; }
-		}
-		if (elem.find("edges") != elem.end()) {
-			for (const auto& edge : elem["edges"]) {
-				const auto& src = edge["src"].template get<int>();
-				const auto& dest = edge["dest"].template get<int>();
-				g.addLink(mapping[src], mapping[dest]);
-			}
-		}
-	}
-	g.resetChanged();
+	if (!g.load(path)) { return false; }
 	this->path = std::filesystem::absolute(path);
 	name = path.filename().string();
 	return true;
@@ -0,0 +1,29 @@
+#include "paths.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "util.hpp"
+
+Paths::Paths() {
+#if defined(APP_OS_WINDOWS)
+	char* p = nullptr;
+	size_t len = 0;
+	if (_dupenv_s(&p, &len, "APPDATA") == 0) { appDir = p; }
+#elif defined(APP_OS_LINUX)
+	auto* p = std::getenv("HOME");
+	if (p != nullptr) {
+		appDir = std::filesystem::path(p) / ".local" / "share";
+	}
+#endif
+	if (appDir.empty()) {
+		SPDLOG_ERROR("Unable to find appdata folder");
+		throw std::invalid_argument("Unable to find appdata folder");
+	}
+
+	appDir = appDir / "ffmpeg-node-editor";
+	std::filesystem::create_directories(appDir);
+
+	prefs = appDir / "prefs.json";
+	iniFile = (appDir / "imgui.ini").string();
+}
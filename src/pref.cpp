@@ -4,11 +4,9 @@
 #include <imgui_stdlib.h>
 #include <imnodes.h>
 
-#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <nlohmann/json.hpp>
-#include <stdexcept>
 #include <string>
 
 #include "imgui_extras.hpp"
@@ -38,30 +36,12 @@ Preference::Preference()
 	  font(R"(/usr/share/fonts/abattis-cantarell-fonts/Cantarell-Regular.otf)"),
 #endif
 	  fontSize(24),
-	  player("vlc\n%f") {
-}
-
-Paths::Paths() {
-#if defined(APP_OS_WINDOWS)
-	char* p = nullptr;
-	size_t len = 0;
-	if (_dupenv_s(&p, &len, "APPDATA") == 0) { appDir = p; }
-#elif defined(APP_OS_LINUX)
-	auto* p = std::getenv("HOME");
-	if (p != nullptr) {
-		appDir = std::filesystem::path(p) / ".local" / "share";
-	}
-#endif
-	if (appDir.empty()) {
-		SPDLOG_ERROR("Unable to find appdata folder");
-		throw std::invalid_argument("Unable to find appdata folder");
-	}
-
-	appDir = appDir / "ffmpeg-node-editor";
-	std::filesystem::create_directories(appDir);
-
-	prefs = appDir / "prefs.json";
-	iniFile = (appDir / "imgui.ini").string();
+	  player("vlc\n%f"),
+	  previewHeight(540),
+	  previewFps(0),
+	  proxyCacheSize(4096),
+	  renderCacheSize(8192),
+	  previewCacheSize(2048) {
 }
 
 std::string_view StyleColorName(StyleColor val) {
@@ -110,6 +90,23 @@ bool Preference::load() {
 	getNull(json, "font_size", fontSize);
 	getNull(json, "color_picker", style.colorPicker);
 	getNull(json, "player", player);
+	getNull(json, "play_in_editor", playInEditor);
+	getNull(json, "preview_mosaic", previewMosaic);
+	getNull(json, "preview_quality", previewQuality);
+	getNull(json, "preview_encoding", previewEncoding);
+	getNull(json, "preview_height", previewHeight);
+	getNull(json, "preview_fps", previewFps);
+	getNull(json, "use_proxies", useProxies);
+	getNull(json, "proxy_cache_size", proxyCacheSize);
+	getNull(json, "cache_intermediates", cacheIntermediates);
+	getNull(json, "render_cache_size", renderCacheSize);
+	getNull(json, "preview_cache_size", previewCacheSize);
+	getNull(json, "preview_memory", previewMemory);
+	getNull(json, "show_thumbnails", showThumbnails);
+	getNull(json, "show_waveforms", showWaveforms);
+	getNull(json, "workers", workers);
+	getNull(json, "job_timeout", jobTimeout);
+	getNull(json, "stall_timeout", stallTimeout);
 	unsaved = false;
 	return false;
 }
@@ -125,6 +122,23 @@ bool Preference::save() {
 	obj["font"] = font.string();
 	obj["font_size"] = fontSize;
 	obj["player"] = player;
+	obj["play_in_editor"] = playInEditor;
+	obj["preview_mosaic"] = previewMosaic;
+	obj["preview_quality"] = previewQuality;
+	obj["preview_encoding"] = previewEncoding;
+	obj["preview_height"] = previewHeight;
+	obj["preview_fps"] = previewFps;
+	obj["use_proxies"] = useProxies;
+	obj["proxy_cache_size"] = proxyCacheSize;
+	obj["cache_intermediates"] = cacheIntermediates;
+	obj["render_cache_size"] = renderCacheSize;
+	obj["preview_cache_size"] = previewCacheSize;
+	obj["preview_memory"] = previewMemory;
+	obj["show_thumbnails"] = showThumbnails;
+	obj["show_waveforms"] = showWaveforms;
+	obj["workers"] = workers;
+	obj["job_timeout"] = jobTimeout;
+	obj["stall_timeout"] = stallTimeout;
 
 	std::filesystem::create_directories(path.prefs.parent_path());
 
@@ -185,6 +199,36 @@ void Preference::draw() {
 				DragInt("##fonstsize", &fontSize, 1.0f, 12, 1000);
 				EndHorizontal();
 			}
+			{
+				BeginHorizontal(&playInEditor);
+				TextUnformatted("Play In Editor");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted("previews play in a panel of the editor");
+					TextUnformatted("video only, needs ffmpeg on this machine");
+					TextUnformatted("the player is used otherwise");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##playineditor", &playInEditor)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&previewMosaic);
+				TextUnformatted("Mosaic");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted("nodes played together are tiled into one");
+					TextUnformatted("video, or the player gets a stream each");
+					TextUnformatted("the panel of the editor always tiles");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##previewmosaic", &previewMosaic)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
 			{
 				BeginHorizontal(&player);
 				TextUnformatted("Player");
@@ -212,6 +256,231 @@ void Preference::draw() {
 				}
 				EndHorizontal();
 			}
+			{
+				BeginHorizontal(&workers);
+				TextUnformatted("Workers");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"addresses of ffmpeg_node_editor_worker daemons, "
+						"separated by commas");
+					TextUnformatted("Eg\n\tunix:/tmp/w1.sock,localhost:7000");
+					TextUnformatted(
+						"files must be at the same paths for the workers");
+					TextUnformatted("leave empty to run ffmpeg here");
+					TextUnformatted("applied on restart");
+					EndTooltip();
+				}
+				Spring();
+				if (InputText("##workers", &workers)) { changed = true; }
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&jobTimeout);
+				TextUnformatted("Job Timeout (s)");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"ffmpeg jobs running longer are stopped, 0 is no "
+						"limit");
+					TextUnformatted("applied on restart");
+					EndTooltip();
+				}
+				Spring();
+				if (DragInt("##jobtimeout", &jobTimeout, 1.0f, 0, 24 * 3600)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&stallTimeout);
+				TextUnformatted("Stall Timeout (s)");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"ffmpeg jobs without a new frame for this long are "
+						"stopped, 0 is no limit");
+					TextUnformatted("applied on restart");
+					EndTooltip();
+				}
+				Spring();
+				if (DragInt("##stalltimeout", &stallTimeout, 1.0f, 0, 3600)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+		}
+		if (CollapsingHeader("Preview", ImGuiTreeNodeFlags_DefaultOpen)) {
+			{
+				BeginHorizontal(&previewQuality);
+				TextUnformatted("Quality");
+				Spring();
+				if (Combo(
+						"##quality", &previewQuality,
+						"Full\0001/2\0001/4\0Custom\0")) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&previewEncoding);
+				TextUnformatted("Encoding");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted("codec of previews opened in the player");
+					TextUnformatted(
+						"Auto measures which gives the first frame soonest");
+					EndTooltip();
+				}
+				Spring();
+				if (Combo(
+						"##encoding", &previewEncoding,
+						"Auto\0Lossless (utvideo)\0Intra only (MJPEG)\0"
+						"x264 ultrafast\0ffmpeg default\0")) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			if (previewQuality == PreviewCustom) {
+				BeginHorizontal(&previewHeight);
+				TextUnformatted("Max Height");
+				Spring();
+				if (DragInt(
+						"##previewheight", &previewHeight, 1.0f, 16, 8640)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&previewFps);
+				TextUnformatted("Max FPS");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted("0 keeps the frame rate of the source");
+					EndTooltip();
+				}
+				Spring();
+				if (DragFloat("##previewfps", &previewFps, 0.5f, 0, 240)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&previewCacheSize);
+				TextUnformatted("Preview Cache Size (MiB)");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"finished previews are kept, replaying an unchanged "
+						"graph opens the kept file");
+					EndTooltip();
+				}
+				Spring();
+				if (DragInt(
+						"##previewcachesize", &previewCacheSize, 16.0f, 0,
+						1024 * 1024)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+#if defined(APP_OS_LINUX)
+			{
+				BeginHorizontal(&previewMemory);
+				TextUnformatted("Preview RAM (MiB)");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"previews expected to fit are written to memory "
+						"instead of the disk");
+					TextUnformatted("they are not kept for replays");
+					TextUnformatted("0 always uses the disk");
+					EndTooltip();
+				}
+				Spring();
+				if (DragInt(
+						"##previewmemory", &previewMemory, 16.0f, 0,
+						64 * 1024)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+#endif
+			{
+				BeginHorizontal(&showThumbnails);
+				TextUnformatted("Node Thumbnails");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"every node shows its output at the preview start");
+					TextUnformatted("refreshed by one ffmpeg run per edit");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##showthumbnails", &showThumbnails)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&showWaveforms);
+				TextUnformatted("Audio Waveforms");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"nodes with an audio output show its whole waveform");
+					TextUnformatted("needs ffmpeg on this machine");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##showwaveforms", &showWaveforms)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&useProxies);
+				TextUnformatted("Use Proxies");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"inputs are transcoded to small proxies in the "
+						"background");
+					TextUnformatted("renders always use the original files");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##useproxies", &useProxies)) { changed = true; }
+				EndHorizontal();
+			}
+			if (useProxies) {
+				BeginHorizontal(&proxyCacheSize);
+				TextUnformatted("Proxy Cache Size (MiB)");
+				Spring();
+				if (DragInt(
+						"##proxycachesize", &proxyCacheSize, 16.0f, 256,
+						1024 * 1024)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			{
+				BeginHorizontal(&cacheIntermediates);
+				TextUnformatted("Cache Intermediates");
+				if (ImGui::BeginItemTooltip()) {
+					TextUnformatted(
+						"outputs of upstream filters are rendered losslessly "
+						"in the background");
+					TextUnformatted(
+						"later previews only run the filters that changed");
+					EndTooltip();
+				}
+				Spring();
+				if (Checkbox("##cacheintermediates", &cacheIntermediates)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
+			if (cacheIntermediates) {
+				BeginHorizontal(&renderCacheSize);
+				TextUnformatted("Intermediate Cache Size (MiB)");
+				Spring();
+				if (DragInt(
+						"##rendercachesize", &renderCacheSize, 16.0f, 256,
+						1024 * 1024)) {
+					changed = true;
+				}
+				EndHorizontal();
+			}
 		}
 		{
 			BeginHorizontal(this);
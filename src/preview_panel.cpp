@@ -0,0 +1,82 @@
+#include "preview_panel.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "frame_ring.hpp"
+#include "imgui_extras.hpp"
+
+PreviewPanel::PreviewPanel(TextureFunctions f)
+	: functions(f), scopes(std::move(f)) {}
+
+PreviewPanel::~PreviewPanel() {
+	stop();
+	if (created) { functions.destroy(texture); }
+}
+
+void PreviewPanel::stop() {
+	if (current != nullptr) { current->close(); }
+	current.reset();
+}
+
+std::shared_ptr<FrameRing> PreviewPanel::open(std::string name) {
+	stop();
+	title = std::move(name);
+	hasFrame = false;
+	isOpen = true;
+	// Only the pool holds rings no stream writes to anymore
+	auto itr = std::find_if(pool.begin(), pool.end(), [](const auto& r) {
+		return r.use_count() == 1;
+	});
+	if (itr == pool.end()) {
+		pool.push_back(std::make_shared<FrameRing>(WIDTH, HEIGHT));
+		itr = std::prev(pool.end());
+	}
+	(*itr)->reset();
+	current = *itr;
+	return current;
+}
+
+void PreviewPanel::draw() {
+	// Stays up with the last frame once the preview is gone
+	scopes.draw();
+	if (current == nullptr) { return; }
+	if (!isOpen) {
+		stop();
+		return;
+	}
+	current->consume([&](const std::uint8_t* frame) {
+		if (!created) {
+			texture = functions.create(WIDTH, HEIGHT);
+			created = true;
+		}
+		functions.update(texture, 0, 0, WIDTH, HEIGHT, frame);
+		scopes.submit(frame, WIDTH, HEIGHT);
+		hasFrame = true;
+	});
+
+	using namespace ImGui;
+	if (Begin(fmt::format("{}###preview", title).c_str(), &isOpen)) {
+		if (current->isClosed()) {
+			TextDisabled("Ended");
+		} else {
+			Text(fmt::format(
+				"{} frames, {} dropped", current->getPublished(),
+				current->getDropped()));
+		}
+		SameLine();
+		Checkbox("Scopes", &scopes.isOpen);
+		// Fit in the window, keeping the aspect ratio
+		const auto avail = GetContentRegionAvail();
+		const auto scale = std::max(
+			0.0f, std::min(avail.x / WIDTH, avail.y / HEIGHT));
+		if (hasFrame) {
+			Image(texture, ImVec2(WIDTH * scale, HEIGHT * scale));
+		} else {
+			TextDisabled("Waiting for ffmpeg...");
+		}
+	}
+	End();
+}
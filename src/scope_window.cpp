@@ -0,0 +1,113 @@
+#include "scope_window.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+
+ScopeWindow::ScopeWindow(TextureFunctions f) : functions(std::move(f)) {}
+
+ScopeWindow::~ScopeWindow() {
+	if (!created) { return; }
+	functions.destroy(waveformTexture);
+	functions.destroy(vectorTexture);
+}
+
+void ScopeWindow::submit(const std::uint8_t* rgba, int width, int height) {
+	if (isOpen) { worker.submit(rgba, width, height); }
+}
+
+void ScopeWindow::upload() {
+	if (!created) {
+		waveformTexture = functions.create(
+			ScopeData::WAVEFORM_COLUMNS, ScopeData::LEVELS);
+		vectorTexture = functions.create(
+			ScopeData::VECTOR_SIZE, ScopeData::VECTOR_SIZE);
+		created = true;
+	}
+	// The worker only makes the image of the open tab
+	if (!data.waveformImage.empty()) {
+		functions.update(
+			waveformTexture, 0, 0, ScopeData::WAVEFORM_COLUMNS,
+			ScopeData::LEVELS, data.waveformImage.data());
+	}
+	if (!data.vectorImage.empty()) {
+		functions.update(
+			vectorTexture, 0, 0, ScopeData::VECTOR_SIZE,
+			ScopeData::VECTOR_SIZE, data.vectorImage.data());
+	}
+	hasData = true;
+}
+
+void ScopeWindow::drawHistogram() {
+	using namespace ImGui;
+	const auto size = GetContentRegionAvail();
+	if (size.x <= 0 || size.y <= 0) { return; }
+	const auto pos = GetCursorScreenPos();
+	Dummy(size);
+
+	std::uint32_t peak = 1;
+	for (const auto& h : data.histogram) {
+		peak = std::max(peak, *std::max_element(h.begin(), h.end()));
+	}
+	constexpr ImU32 COLORS[ScopeData::CHANNELS] = {
+		IM_COL32(220, 220, 220, 255), IM_COL32(230, 60, 60, 200),
+		IM_COL32(60, 200, 60, 200), IM_COL32(70, 110, 240, 200)};
+	auto* drawList = GetWindowDrawList();
+	drawList->AddRectFilled(
+		pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(0, 0, 0, 255));
+	auto point = [&](int level, std::uint32_t count) {
+		return ImVec2(
+			pos.x + size.x * float(level) / (ScopeData::LEVELS - 1),
+			pos.y + size.y * (1 - float(count) / float(peak)));
+	};
+	// Luma last, so it stays on top of the colors
+	for (int channel = ScopeData::CHANNELS; channel-- > 0;) {
+		const auto& h = data.histogram[channel];
+		for (auto i = 1; i < ScopeData::LEVELS; ++i) {
+			drawList->AddLine(
+				point(i - 1, h[i - 1]), point(i, h[i]), COLORS[channel]);
+		}
+	}
+}
+
+void ScopeWindow::draw() {
+	if (!isOpen) { return; }
+	if (worker.take(data)) { upload(); }
+
+	using namespace ImGui;
+	if (Begin("Scopes###scopes", &isOpen)) {
+		if (!hasData) {
+			TextDisabled("Scopes follow the preview playing in the editor");
+		} else {
+			// Large frames are sampled to keep up, see ScopeData
+			auto size = fmt::format("{}x{}", data.width, data.height);
+			if (data.rowStep > 1) {
+				size += fmt::format(", one row in {}", data.rowStep);
+			}
+			TextDisabled("%s", size.c_str());
+		}
+		if (hasData && BeginTabBar("scopes")) {
+			const auto avail = GetContentRegionAvail();
+			const auto side = std::max(0.0f, std::min(avail.x, avail.y));
+			auto images = unsigned(ScopeData::NoImages);
+			if (BeginTabItem("Histogram")) {
+				drawHistogram();
+				EndTabItem();
+			}
+			if (BeginTabItem("Waveform")) {
+				images = ScopeData::WaveformImage;
+				Image(waveformTexture, ImVec2(avail.x, side));
+				EndTabItem();
+			}
+			if (BeginTabItem("Vectorscope")) {
+				images = ScopeData::VectorImage;
+				Image(vectorTexture, ImVec2(side, side));
+				EndTabItem();
+			}
+			EndTabBar();
+			worker.show(images);
+		}
+	}
+	End();
+}
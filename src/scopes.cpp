@@ -0,0 +1,276 @@
+#include "scopes.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCOPES_SSE2
+#endif
+
+namespace {
+	// BT.709 coefficients scaled by 256. Luma ones sum to 256 and chroma
+	// ones to 0, so none of the sums below leave 16 bits.
+	constexpr int KR = 54, KG = 183, KB = 19;
+	constexpr int CB_R = -29, CB_G = -99, CB_B = 128;
+	constexpr int CR_R = 128, CR_G = -116, CR_B = -12;
+
+	// Y, Cb and Cr of n RGBA pixels, eight at a time where SSE2 is around
+	void convertRow(
+		const std::uint8_t* p, int n, std::uint8_t* y, std::uint8_t* cb,
+		std::uint8_t* cr) {
+		int i = 0;
+#if defined(SCOPES_SSE2)
+		const auto mask = _mm_set1_epi32(0xFF);
+		const auto half = _mm_set1_epi16(128);
+		auto mul = [](__m128i v, short k) {
+			return _mm_mullo_epi16(v, _mm_set1_epi16(k));
+		};
+		for (; i + 8 <= n; i += 8) {
+			const auto lo = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(p + i * 4));
+			const auto hi = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(p + i * 4 + 16));
+			// Pixels are little endian words, red in the lowest byte
+			const auto r = _mm_packs_epi32(
+				_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+			const auto g = _mm_packs_epi32(
+				_mm_and_si128(_mm_srli_epi32(lo, 8), mask),
+				_mm_and_si128(_mm_srli_epi32(hi, 8), mask));
+			const auto b = _mm_packs_epi32(
+				_mm_and_si128(_mm_srli_epi32(lo, 16), mask),
+				_mm_and_si128(_mm_srli_epi32(hi, 16), mask));
+
+			// Luma wraps past 32767, so it is shifted as unsigned
+			const auto luma = _mm_srli_epi16(
+				_mm_add_epi16(
+					_mm_add_epi16(mul(r, KR), mul(g, KG)),
+					_mm_add_epi16(mul(b, KB), half)),
+				8);
+			const auto u = _mm_add_epi16(
+				_mm_srai_epi16(
+					_mm_add_epi16(
+						_mm_add_epi16(mul(r, CB_R), mul(g, CB_G)),
+						mul(b, CB_B)),
+					8),
+				half);
+			const auto v = _mm_add_epi16(
+				_mm_srai_epi16(
+					_mm_add_epi16(
+						_mm_add_epi16(mul(r, CR_R), mul(g, CR_G)),
+						mul(b, CR_B)),
+					8),
+				half);
+			_mm_storel_epi64(
+				reinterpret_cast<__m128i*>(y + i),
+				_mm_packus_epi16(luma, luma));
+			_mm_storel_epi64(
+				reinterpret_cast<__m128i*>(cb + i), _mm_packus_epi16(u, u));
+			_mm_storel_epi64(
+				reinterpret_cast<__m128i*>(cr + i), _mm_packus_epi16(v, v));
+		}
+#endif
+		for (; i < n; ++i) {
+			const int r = p[i * 4], g = p[i * 4 + 1], b = p[i * 4 + 2];
+			y[i] = std::uint8_t((KR * r + KG * g + KB * b + 128) >> 8);
+			cb[i] = std::uint8_t(((CB_R * r + CB_G * g + CB_B * b) >> 8) + 128);
+			cr[i] = std::uint8_t(((CR_R * r + CR_G * g + CR_B * b) >> 8) + 128);
+		}
+	}
+
+	struct Area {
+		int left, top, width, height;
+	};
+
+	// Smallest area holding every pixel that isn't fully transparent, the
+	// whole frame if there is none
+	Area activeArea(const std::uint8_t* rgba, int width, int height) {
+		auto opaque = [&](int x, int y) {
+			return rgba[(size_t(y) * width + x) * 4 + 3] != 0;
+		};
+		auto rowOpaque = [&](int y) {
+			for (auto x = 0; x < width; ++x) {
+				if (opaque(x, y)) { return true; }
+			}
+			return false;
+		};
+		auto top = 0, bottom = height;
+		while (top < bottom && !rowOpaque(top)) { ++top; }
+		if (top == bottom) { return {0, 0, width, height}; }
+		while (!rowOpaque(bottom - 1)) { --bottom; }
+		auto columnOpaque = [&](int x) {
+			for (auto y = top; y < bottom; ++y) {
+				if (opaque(x, y)) { return true; }
+			}
+			return false;
+		};
+		auto left = 0, right = width;
+		while (!columnOpaque(left)) { ++left; }
+		while (!columnOpaque(right - 1)) { --right; }
+		return {left, top, right - left, bottom - top};
+	}
+
+	// Square root of counts relative to the largest, so sparse traces
+	// still show up next to a flat area. Looked up, as there are a lot
+	// more counts than steps of brightness.
+	template <typename T>
+	void toImage(
+		const std::vector<T>& counts, std::vector<std::uint8_t>& image) {
+		constexpr int STEPS = 1024;
+		static const auto table = [] {
+			std::array<std::uint8_t, STEPS + 1> t{};
+			for (auto i = 0; i <= STEPS; ++i) {
+				t[i] = std::uint8_t(32 + 223 * std::sqrt(float(i) / STEPS));
+			}
+			return t;
+		}();
+		image.resize(counts.size() * 4);
+		const std::uint64_t peak = std::max<T>(
+			1, *std::max_element(counts.begin(), counts.end()));
+		// counts * STEPS / peak in 32.32 fixed point, counts fit 32 bits
+		const auto scale = (std::uint64_t(STEPS) << 32) / peak;
+		auto* pixel = image.data();
+		for (const auto count : counts) {
+			const std::uint32_t v =
+				count == 0 ? 0 : table[(count * scale) >> 32];
+			// Grey and opaque, one store a pixel whatever the byte order
+			const std::array<std::uint8_t, 4> grey{
+				std::uint8_t(v), std::uint8_t(v), std::uint8_t(v), 255};
+			std::memcpy(pixel, grey.data(), grey.size());
+			pixel += 4;
+		}
+	}
+}  // namespace
+
+void computeScopes(
+	const std::uint8_t* rgba, int width, int height, ScopeData& out,
+	unsigned images) {
+	using S = ScopeData;
+	out.width = 0;
+	out.height = 0;
+	out.rowStep = 1;
+	out.samples = 0;
+	for (auto& h : out.histogram) { h.fill(0); }
+	out.waveform.assign(size_t(S::WAVEFORM_COLUMNS) * S::LEVELS, 0);
+	out.vectorscope.assign(size_t(S::VECTOR_SIZE) * S::VECTOR_SIZE, 0);
+	out.waveformImage.clear();
+	out.vectorImage.clear();
+	if (width <= 0 || height <= 0) { return; }
+
+	const auto area = activeArea(rgba, width, height);
+	const auto stride = size_t(width) * 4;
+	rgba += size_t(area.top) * stride + size_t(area.left) * 4;
+	width = area.width;
+	height = area.height;
+	out.width = width;
+	out.height = height;
+
+	const auto pixels = size_t(width) * size_t(height);
+	const auto step = int((pixels + S::MAX_SAMPLES - 1) / S::MAX_SAMPLES);
+	out.rowStep = step;
+	std::vector<std::uint16_t> columns(width);
+	for (auto x = 0; x < width; ++x) {
+		columns[x] = std::uint16_t(size_t(x) * S::WAVEFORM_COLUMNS / width);
+	}
+	std::vector<std::uint8_t> y(width), cb(width), cr(width);
+	auto& red = out.histogram[S::Red];
+	auto& green = out.histogram[S::Green];
+	auto& blue = out.histogram[S::Blue];
+	auto* waveform = out.waveform.data();
+	auto* vectorscope = out.vectorscope.data();
+	// Rows are spread evenly, the middle of each step is looked at
+	for (auto row = step / 2; row < height; row += step) {
+		const auto* p = rgba + size_t(row) * stride;
+		convertRow(p, width, y.data(), cb.data(), cr.data());
+		for (auto x = 0; x < width; ++x) {
+			red[p[x * 4]]++;
+			green[p[x * 4 + 1]]++;
+			blue[p[x * 4 + 2]]++;
+			waveform[(255 - y[x]) * S::WAVEFORM_COLUMNS + columns[x]]++;
+			vectorscope[(127 - cr[x] / 2) * S::VECTOR_SIZE + cb[x] / 2]++;
+		}
+		out.samples += width;
+	}
+	// Rows of the waveform add up to the luma histogram
+	for (auto level = 0; level < S::LEVELS; ++level) {
+		const auto* counts = waveform + (255 - level) * S::WAVEFORM_COLUMNS;
+		out.histogram[S::Luma][level] =
+			std::accumulate(counts, counts + S::WAVEFORM_COLUMNS, 0U);
+	}
+	if ((images & S::WaveformImage) != 0) {
+		toImage(out.waveform, out.waveformImage);
+	}
+	if ((images & S::VectorImage) != 0) {
+		toImage(out.vectorscope, out.vectorImage);
+	}
+}
+
+ScopeWorker::ScopeWorker() : thread([this] { run(); }) {}
+
+ScopeWorker::~ScopeWorker() {
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+}
+
+void ScopeWorker::submit(const std::uint8_t* rgba, int w, int h) {
+	{
+		std::lock_guard lock(mutex);
+		frame.assign(rgba, rgba + size_t(w) * size_t(h) * 4);
+		width = w;
+		height = h;
+		pending = true;
+	}
+	wake.notify_one();
+}
+
+void ScopeWorker::show(unsigned wanted) {
+	{
+		std::lock_guard lock(mutex);
+		if (wanted == images) { return; }
+		images = wanted;
+		redo = true;
+	}
+	wake.notify_one();
+}
+
+bool ScopeWorker::take(ScopeData& out) {
+	std::lock_guard lock(mutex);
+	if (!ready) { return false; }
+	std::swap(out, computed);
+	ready = false;
+	return true;
+}
+
+void ScopeWorker::run() {
+	std::vector<std::uint8_t> local;
+	int w = 0, h = 0;
+	ScopeData data;
+	std::unique_lock lock(mutex);
+	while (true) {
+		wake.wait(lock, [&] { return pending || redo || stopping; });
+		if (stopping) { return; }
+		if (pending) {
+			std::swap(local, frame);
+			w = width;
+			h = height;
+		}
+		const auto wanted = images;
+		pending = false;
+		redo = false;
+		if (local.empty()) { continue; }
+
+		lock.unlock();
+		computeScopes(local.data(), w, h, data, wanted);
+		lock.lock();
+		std::swap(computed, data);
+		ready = true;
+	}
+}
@@ -0,0 +1,193 @@
+#include "scopes.hpp"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace {
+	std::vector<std::uint8_t> solid(int w, int h, int r, int g, int b) {
+		std::vector<std::uint8_t> frame(size_t(w) * h * 4);
+		for (size_t i = 0; i < frame.size(); i += 4) {
+			frame[i] = std::uint8_t(r);
+			frame[i + 1] = std::uint8_t(g);
+			frame[i + 2] = std::uint8_t(b);
+			frame[i + 3] = 255;
+		}
+		return frame;
+	}
+
+	// Every byte differs from its neighbours, so each SIMD lane sees
+	// something else
+	std::vector<std::uint8_t> noise(int w, int h) {
+		std::vector<std::uint8_t> frame(size_t(w) * h * 4);
+		std::uint32_t seed = 1;
+		for (auto& v : frame) {
+			seed = seed * 1664525 + 1013904223;
+			v = std::uint8_t(seed >> 24);
+		}
+		return frame;
+	}
+}  // namespace
+
+TEST(Scopes, solid_colors) {
+	// Odd width, so the scalar tail runs after the vector loop
+	constexpr int W = 13, H = 3;
+	ScopeData data;
+	auto white = solid(W, H, 255, 255, 255);
+	computeScopes(white.data(), W, H, data);
+	EXPECT_EQ(data.samples, W * H);
+	EXPECT_EQ(data.histogram[ScopeData::Luma][255], W * H);
+	EXPECT_EQ(data.histogram[ScopeData::Red][255], W * H);
+	// Neutral colors sit in the middle of the vectorscope
+	EXPECT_EQ(data.vectorscope[63 * ScopeData::VECTOR_SIZE + 64], W * H);
+	// The top row of the waveform, spread over its columns
+	const auto top = std::accumulate(
+		data.waveform.begin(),
+		data.waveform.begin() + ScopeData::WAVEFORM_COLUMNS, 0U);
+	EXPECT_EQ(top, W * H);
+
+	auto red = solid(W, H, 255, 0, 0);
+	computeScopes(red.data(), W, H, data);
+	EXPECT_EQ(data.histogram[ScopeData::Luma][54], W * H);
+	EXPECT_EQ(data.histogram[ScopeData::Green][0], W * H);
+	// Cb 99 and Cr 255
+	EXPECT_EQ(data.vectorscope[49], W * H);
+	EXPECT_EQ(
+		data.waveformImage.size(),
+		size_t(ScopeData::WAVEFORM_COLUMNS) * ScopeData::LEVELS * 4);
+	EXPECT_EQ(
+		data.vectorImage.size(),
+		size_t(ScopeData::VECTOR_SIZE) * ScopeData::VECTOR_SIZE * 4);
+
+	// Only the images asked for are made, the counts are all there
+	computeScopes(red.data(), W, H, data, ScopeData::VectorImage);
+	EXPECT_TRUE(data.waveformImage.empty());
+	EXPECT_FALSE(data.vectorImage.empty());
+	EXPECT_EQ(data.histogram[ScopeData::Luma][54], W * H);
+}
+
+TEST(Scopes, matches_scalar) {
+	constexpr int W = 37, H = 5;
+	auto frame = noise(W, H);
+	ScopeData data;
+	computeScopes(frame.data(), W, H, data);
+
+	std::array<std::uint32_t, ScopeData::LEVELS> luma{}, cb{};
+	for (size_t i = 0; i < frame.size(); i += 4) {
+		const int r = frame[i], g = frame[i + 1], b = frame[i + 2];
+		luma[(54 * r + 183 * g + 19 * b + 128) >> 8]++;
+		cb[((-29 * r - 99 * g + 128 * b) >> 8) + 128]++;
+	}
+	EXPECT_EQ(data.histogram[ScopeData::Luma], luma);
+	for (auto u = 0; u < ScopeData::LEVELS; u += 2) {
+		std::uint32_t column = 0;
+		for (auto v = 0; v < ScopeData::VECTOR_SIZE; ++v) {
+			column += data.vectorscope[v * ScopeData::VECTOR_SIZE + u / 2];
+		}
+		EXPECT_EQ(column, cb[u] + cb[u + 1]) << "cb " << u;
+	}
+}
+
+TEST(Scopes, large_frames_sampled) {
+	constexpr int W = 1920, H = 1080;
+	auto frame = noise(W, H);
+	ScopeData data;
+	computeScopes(frame.data(), W, H, data);
+	EXPECT_LE(data.samples, ScopeData::MAX_SAMPLES);
+	EXPECT_GT(data.samples, ScopeData::MAX_SAMPLES / 2);
+	for (const auto& h : data.histogram) {
+		EXPECT_EQ(std::accumulate(h.begin(), h.end(), 0ULL), data.samples);
+	}
+}
+
+TEST(Scopes, letterbox_left_out) {
+	// A 4x2 picture between transparent bars, as previews are streamed
+	constexpr int W = 8, H = 6;
+	auto frame = solid(W, H, 0, 0, 0);
+	for (auto y = 0; y < H; ++y) {
+		for (auto x = 0; x < W; ++x) {
+			const auto i = (size_t(y) * W + x) * 4;
+			const auto inside = x >= 2 && x < 6 && y >= 2 && y < 4;
+			if (inside) { frame[i] = frame[i + 1] = frame[i + 2] = 255; }
+			frame[i + 3] = inside ? 255 : 0;
+		}
+	}
+	ScopeData data;
+	computeScopes(frame.data(), W, H, data);
+	EXPECT_EQ(data.width, 4);
+	EXPECT_EQ(data.height, 2);
+	EXPECT_EQ(data.samples, 8);
+	EXPECT_EQ(data.histogram[ScopeData::Luma][255], 8);
+	EXPECT_EQ(data.histogram[ScopeData::Luma][0], 0);
+
+	// Nothing opaque, so the whole frame counts
+	for (size_t i = 3; i < frame.size(); i += 4) { frame[i] = 0; }
+	computeScopes(frame.data(), W, H, data);
+	EXPECT_EQ(data.samples, W * H);
+}
+
+// Timing only, run with --gtest_also_run_disabled_tests. The frame is
+// smooth with some grain like footage, noise alone scatters every count.
+// The window shows one scope, so one image is made a frame.
+TEST(Scopes, DISABLED_benchmark_1080p) {
+	constexpr int W = 1920, H = 1080, BATCHES = 20, RUNS = 10;
+	auto frame = noise(W, H);
+	for (auto y = 0; y < H; ++y) {
+		for (auto x = 0; x < W; ++x) {
+			auto* p = &frame[(size_t(y) * W + x) * 4];
+			p[0] = std::uint8_t(x * 200 / W + p[0] % 16);
+			p[1] = std::uint8_t(y * 200 / H + p[1] % 16);
+			p[2] = std::uint8_t((x + y) * 200 / (W + H) + p[2] % 16);
+			p[3] = 255;
+		}
+	}
+	ScopeData data;
+	computeScopes(frame.data(), W, H, data);  // warm up
+
+	// Fastest batch, the others were interrupted more
+	auto ms = std::numeric_limits<double>::max();
+	for (auto b = 0; b < BATCHES; ++b) {
+		const auto start = std::chrono::steady_clock::now();
+		for (auto i = 0; i < RUNS; ++i) {
+			computeScopes(
+				frame.data(), W, H, data, ScopeData::WaveformImage);
+		}
+		const std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - start;
+		ms = std::min(ms, elapsed.count() / RUNS);
+	}
+	RecordProperty("ms_per_frame", fmt::format("{:.3f}", ms));
+	fmt::print("computeScopes 1920x1080: {:.3f} ms per frame\n", ms);
+}
+
+TEST(ScopeWorker, newest_frame) {
+	ScopeWorker worker;
+	ScopeData data;
+	EXPECT_FALSE(worker.take(data));
+
+	auto frame = solid(16, 16, 0, 0, 0);
+	worker.submit(frame.data(), 16, 16);
+	frame = solid(16, 16, 255, 255, 255);  // the copy is used
+	using namespace std::chrono_literals;
+	for (auto i = 0; i < 100 && !worker.take(data); ++i) {
+		std::this_thread::sleep_for(10ms);
+	}
+	EXPECT_EQ(data.width, 16);
+	EXPECT_EQ(data.histogram[ScopeData::Luma][0], 16 * 16);
+	EXPECT_FALSE(worker.take(data));
+
+	// Other images make the last frame run again
+	worker.show(ScopeData::VectorImage);
+	for (auto i = 0; i < 100 && !worker.take(data); ++i) {
+		std::this_thread::sleep_for(10ms);
+	}
+	EXPECT_TRUE(data.waveformImage.empty());
+	EXPECT_FALSE(data.vectorImage.empty());
+	EXPECT_EQ(data.histogram[ScopeData::Luma][0], 16 * 16);
+}
@@ -0,0 +1,234 @@
+#include "stream_socket.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "string_utils.hpp"
+#include "util.hpp"
+
+#if defined(APP_OS_WINDOWS)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#include <afunix.h>
+using socklen_t = int;
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	constexpr auto BUFFER_SIZE = 4096U;
+	constexpr auto BACKLOG = 16;
+
+#if defined(APP_OS_WINDOWS)
+	constexpr auto SEND_FLAGS = 0;
+	void initSockets() {
+		static std::once_flag flag;
+		std::call_once(flag, [] {
+			WSADATA data;
+			WSAStartup(MAKEWORD(2, 2), &data);
+		});
+	}
+	void closeHandle(std::intptr_t fd) {
+		closesocket(static_cast<SOCKET>(fd));
+	}
+#else
+	constexpr auto SEND_FLAGS = MSG_NOSIGNAL;
+	void initSockets() {}
+	void closeHandle(std::intptr_t fd) { ::close(static_cast<int>(fd)); }
+#endif
+
+	// Processes started by a worker must not keep its connections open
+	std::intptr_t noInherit(std::intptr_t fd) {
+#if !defined(APP_OS_WINDOWS)
+		if (fd != -1) { fcntl(static_cast<int>(fd), F_SETFD, FD_CLOEXEC); }
+#endif
+		return fd;
+	}
+
+	auto native(std::intptr_t fd) {
+#if defined(APP_OS_WINDOWS)
+		return static_cast<SOCKET>(fd);
+#else
+		return static_cast<int>(fd);
+#endif
+	}
+
+	// Calls f with every address matching address till it returns a handle
+	template <typename F> std::intptr_t resolve(std::string_view address, F f) {
+		initSockets();
+		if (str::starts_with(address, "unix:")) {
+			const auto path = address.substr(5);
+			sockaddr_un addr{};
+			if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+				return -1;
+			}
+			addr.sun_family = AF_UNIX;
+			std::memcpy(addr.sun_path, path.data(), path.size());
+			return f(AF_UNIX, reinterpret_cast<sockaddr*>(&addr),
+					 static_cast<socklen_t>(sizeof(addr)));
+		}
+
+		address = str::strip_prefix(address, "tcp:");
+		const auto colon = address.rfind(':');
+		if (colon == std::string_view::npos) { return -1; }
+		const std::string host(address.substr(0, colon));
+		const std::string port(address.substr(colon + 1));
+
+		// No host is loopback, only * is every interface
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		if (host == "*") { hints.ai_flags = AI_PASSIVE; }
+		addrinfo* list = nullptr;
+		if (getaddrinfo(
+				host.empty() || host == "*" ? nullptr : host.c_str(),
+				port.c_str(), &hints, &list) != 0) {
+			return -1;
+		}
+		std::intptr_t fd = -1;
+		for (auto* a = list; a != nullptr && fd == -1; a = a->ai_next) {
+			fd = f(a->ai_family, a->ai_addr,
+				   static_cast<socklen_t>(a->ai_addrlen));
+		}
+		freeaddrinfo(list);
+		return fd;
+	}
+
+	std::intptr_t openSocket(int family) {
+		auto fd = ::socket(family, SOCK_STREAM, 0);
+#if defined(APP_OS_WINDOWS)
+		if (fd == INVALID_SOCKET) { return -1; }
+#endif
+		return noInherit(static_cast<std::intptr_t>(fd));
+	}
+}  // namespace
+
+StreamSocket::StreamSocket(StreamSocket&& other) noexcept
+	: fd(std::exchange(other.fd, -1)), buffer(std::move(other.buffer)) {}
+
+StreamSocket& StreamSocket::operator=(StreamSocket&& other) noexcept {
+	if (this != &other) {
+		close();
+		fd = std::exchange(other.fd, -1);
+		buffer = std::move(other.buffer);
+	}
+	return *this;
+}
+
+StreamSocket StreamSocket::connect(std::string_view address) {
+	return StreamSocket(resolve(
+		address, [](int family, const sockaddr* addr, socklen_t len) {
+			auto fd = openSocket(family);
+			if (fd == -1) { return fd; }
+			if (::connect(native(fd), addr, len) != 0) {
+				closeHandle(fd);
+				return std::intptr_t{-1};
+			}
+			return fd;
+		}));
+}
+
+StreamSocket StreamSocket::listen(std::string_view address) {
+	namespace fs = std::filesystem;
+	fs::path path;
+	if (str::starts_with(address, "unix:")) {
+		path = std::string(address.substr(5));
+		// A socket left over by an earlier run would fail bind, anything
+		// else at the path is not ours to remove
+		std::error_code err;
+		if (fs::is_socket(fs::symlink_status(path, err))) {
+			fs::remove(path, err);
+		}
+	}
+	return StreamSocket(resolve(
+		address, [&](int family, const sockaddr* addr, socklen_t len) {
+			auto fd = openSocket(family);
+			if (fd == -1) { return fd; }
+			if (family != AF_UNIX) {
+				int yes = 1;
+				setsockopt(
+					native(fd), SOL_SOCKET, SO_REUSEADDR,
+					reinterpret_cast<const char*>(&yes), sizeof(yes));
+			}
+			if (::bind(native(fd), addr, len) != 0) {
+				closeHandle(fd);
+				return std::intptr_t{-1};
+			}
+			// Owner only, set before listen so nobody connects meanwhile
+			std::error_code err;
+			if (family == AF_UNIX) {
+				fs::permissions(
+					path, fs::perms::owner_read | fs::perms::owner_write,
+					err);
+			}
+			if (err || ::listen(native(fd), BACKLOG) != 0) {
+				closeHandle(fd);
+				return std::intptr_t{-1};
+			}
+			return fd;
+		}));
+}
+
+StreamSocket StreamSocket::accept() const {
+	if (!valid()) { return {}; }
+	auto client = ::accept(native(fd), nullptr, nullptr);
+#if defined(APP_OS_WINDOWS)
+	if (client == INVALID_SOCKET) { return {}; }
+#else
+	if (client < 0) { return {}; }
+#endif
+	return StreamSocket(noInherit(static_cast<std::intptr_t>(client)));
+}
+
+bool StreamSocket::send(std::string_view data) const {
+	while (!data.empty()) {
+		auto sent = ::send(
+			native(fd), data.data(), static_cast<int>(data.size()),
+			SEND_FLAGS);
+		if (sent <= 0) { return false; }
+		data.remove_prefix(static_cast<size_t>(sent));
+	}
+	return true;
+}
+
+bool StreamSocket::readLine(std::string& line, size_t limit) {
+	for (;;) {
+		if (auto idx = buffer.find('\n'); idx != std::string::npos) {
+			line = buffer.substr(0, idx);
+			buffer.erase(0, idx + 1);
+			return true;
+		}
+		if (buffer.size() > limit) {
+			SPDLOG_WARN("dropping a peer sending lines over {} bytes", limit);
+			buffer.clear();
+			shutdown();
+			return false;
+		}
+		char data[BUFFER_SIZE];
+		auto read = ::recv(native(fd), data, sizeof(data), 0);
+		if (read <= 0) { return false; }
+		buffer.append(data, static_cast<size_t>(read));
+	}
+}
+
+void StreamSocket::shutdown() const {
+	if (!valid()) { return; }
+#if defined(APP_OS_WINDOWS)
+	::shutdown(native(fd), SD_BOTH);
+#else
+	::shutdown(native(fd), SHUT_RDWR);
+#endif
+}
+
+void StreamSocket::close() {
+	if (!valid()) { return; }
+	closeHandle(std::exchange(fd, -1));
+	buffer.clear();
+}
@@ -0,0 +1,48 @@
+#include "stream_socket.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+	const auto SOCKET_PATH =
+		fs::temp_directory_path() / "ffmpeg_node_editor_socket_test.sock";
+}  // namespace
+
+TEST(StreamSocket, keeps_other_files) {
+	{ std::ofstream file(SOCKET_PATH); }
+	EXPECT_FALSE(StreamSocket::listen("unix:" + SOCKET_PATH.string()).valid());
+	EXPECT_TRUE(fs::is_regular_file(SOCKET_PATH));
+	fs::remove(SOCKET_PATH);
+
+	auto listener = StreamSocket::listen("unix:" + SOCKET_PATH.string());
+	ASSERT_TRUE(listener.valid());
+	EXPECT_EQ(
+		fs::status(SOCKET_PATH).permissions() & fs::perms::all,
+		fs::perms::owner_read | fs::perms::owner_write);
+	listener.close();
+	// A socket left over is replaced
+	EXPECT_TRUE(StreamSocket::listen("unix:" + SOCKET_PATH.string()).valid());
+}
+
+TEST(StreamSocket, long_lines_disconnect) {
+	const auto address = "unix:" + SOCKET_PATH.string();
+	auto listener = StreamSocket::listen(address);
+	ASSERT_TRUE(listener.valid());
+	std::thread client([&] {
+		auto socket = StreamSocket::connect(address);
+		(void)socket.send("short\n");
+		(void)socket.send(std::string(StreamSocket::LINE_LIMIT * 2, 'x'));
+	});
+	auto peer = listener.accept();
+	std::string line;
+	EXPECT_TRUE(peer.readLine(line));
+	EXPECT_EQ(line, "short");
+	EXPECT_FALSE(peer.readLine(line));
+	client.join();
+}
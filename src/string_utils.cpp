@@ -17,6 +17,49 @@ namespace str {
 		return array;
 	}
 
+	bool stotime(std::string_view str, double& seconds) {
+		constexpr auto MAX_PARTS = 3;
+		constexpr auto SEXAGESIMAL = 60;
+		auto parts = split(strip(str), ':');
+		if (parts.empty() || parts.size() > MAX_PARTS) { return false; }
+		double result = 0;
+		for (auto i = 0U; i < parts.size(); ++i) {
+			double value = 0;
+			if (!stod(parts[i], value) || value < 0) { return false; }
+			// Only the seconds can be fractional or go above 59
+			if (i + 1 < parts.size() &&
+				(value != static_cast<long long>(value) ||
+				 (i > 0 && value >= SEXAGESIMAL))) {
+				return false;
+			}
+			result = result * SEXAGESIMAL + value;
+		}
+		seconds = result;
+		return true;
+	}
+
+	bool wildcard(std::string_view pattern, std::string_view txt) {
+		// Greedy with backtracking to the last *, linear for simple patterns
+		size_t p = 0, t = 0, star = std::string_view::npos, mark = 0;
+		while (t < txt.size()) {
+			if (p < pattern.size() &&
+				(pattern[p] == '?' || pattern[p] == txt[t])) {
+				p++;
+				t++;
+			} else if (p < pattern.size() && pattern[p] == '*') {
+				star = p++;
+				mark = t;
+			} else if (star != std::string_view::npos) {
+				p = star + 1;
+				t = ++mark;
+			} else {
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*') { p++; }
+		return p == pattern.size();
+	}
+
 	bool match(
 		std::string_view txt, const std::regex& re,
 		std::initializer_list<std::reference_wrapper<std::string_view>> dest) {
@@ -0,0 +1,65 @@
+#include "thumbnail_atlas.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "ffmpeg/thumbnail_cache.hpp"
+
+namespace {
+	constexpr int COLUMNS = ThumbnailAtlas::SIZE / ThumbnailCache::WIDTH;
+	constexpr int ROWS = ThumbnailAtlas::SIZE / ThumbnailCache::HEIGHT;
+	constexpr size_t CAPACITY = size_t(COLUMNS) * ROWS;
+}  // namespace
+
+ThumbnailAtlas::ThumbnailAtlas(const ThumbnailCache* c, TextureFunctions f)
+	: cache(c), functions(std::move(f)) {}
+
+ThumbnailAtlas::~ThumbnailAtlas() {
+	if (created) { functions.destroy(texture); }
+}
+
+ThumbnailAtlas::Region ThumbnailAtlas::region(size_t slot) const {
+	constexpr auto size = float(SIZE);
+	const auto x = float(int(slot) % COLUMNS * ThumbnailCache::WIDTH);
+	const auto y = float(int(slot) / COLUMNS * ThumbnailCache::HEIGHT);
+	return {
+		texture,
+		{x / size, y / size},
+		{(x + ThumbnailCache::WIDTH) / size,
+		 (y + ThumbnailCache::HEIGHT) / size}};
+}
+
+std::optional<ThumbnailAtlas::Region> ThumbnailAtlas::find(
+	std::uint64_t key) {
+	++tick;
+	if (auto itr = index.find(key); itr != index.end()) {
+		slots[itr->second].used = tick;
+		return region(itr->second);
+	}
+	if (cache == nullptr) { return std::nullopt; }
+	auto image = cache->find(key);
+	if (!image.has_value() || image->empty()) { return std::nullopt; }
+
+	if (!created) {
+		texture = functions.create(SIZE, SIZE);
+		created = true;
+	}
+	size_t slot = slots.size();
+	if (slots.size() < CAPACITY) {
+		slots.emplace_back();
+	} else {
+		auto oldest = std::min_element(
+			slots.begin(), slots.end(),
+			[](const Slot& a, const Slot& b) { return a.used < b.used; });
+		slot = oldest - slots.begin();
+		index.erase(oldest->key);
+	}
+	slots[slot] = {key, tick};
+	index[key] = slot;
+
+	const auto r = region(slot);
+	functions.update(
+		texture, int(r.uv0.x * SIZE), int(r.uv0.y * SIZE),
+		ThumbnailCache::WIDTH, ThumbnailCache::HEIGHT, image->data());
+	return r;
+}
@@ -0,0 +1,52 @@
+#include "thumbnail_atlas.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "ffmpeg/thumbnail_cache.hpp"
+
+TEST(ThumbnailAtlas, uploads_once) {
+	ThumbnailCache cache;
+	cache.insert(1, std::vector<std::uint8_t>(ThumbnailCache::BYTES, 255));
+	cache.insert(2, {});  // node without a frame
+	cache.insert(3, std::vector<std::uint8_t>(ThumbnailCache::BYTES, 128));
+
+	auto creates = 0;
+	std::vector<std::pair<int, int>> updates;
+	{
+		ThumbnailAtlas atlas(
+			&cache,
+			{[&](int w, int h) {
+				 EXPECT_EQ(w, ThumbnailAtlas::SIZE);
+				 EXPECT_EQ(h, ThumbnailAtlas::SIZE);
+				 creates++;
+				 return ImTextureID{};
+			 },
+			 [&](ImTextureID, int x, int y, int w, int h, const void*) {
+				 EXPECT_EQ(w, ThumbnailCache::WIDTH);
+				 EXPECT_EQ(h, ThumbnailCache::HEIGHT);
+				 updates.emplace_back(x, y);
+			 },
+			 [&](ImTextureID) { creates--; }});
+
+		EXPECT_FALSE(atlas.find(2).has_value());
+		EXPECT_FALSE(atlas.find(4).has_value());
+		EXPECT_EQ(creates, 0);
+
+		auto a = atlas.find(1);
+		auto b = atlas.find(3);
+		ASSERT_TRUE(a.has_value());
+		ASSERT_TRUE(b.has_value());
+		EXPECT_EQ(a->uv0.x, 0);
+		EXPECT_GT(b->uv0.x, a->uv0.x);
+		EXPECT_EQ(b->uv0.x, a->uv1.x);
+
+		// Drawn again without another upload
+		EXPECT_EQ(atlas.find(1)->uv0.x, a->uv0.x);
+		EXPECT_EQ(creates, 1);
+		EXPECT_EQ(updates.size(), 2);
+		EXPECT_EQ(updates[1], std::make_pair(ThumbnailCache::WIDTH, 0));
+	}
+	EXPECT_EQ(creates, 0);
+}
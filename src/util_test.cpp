@@ -52,6 +52,16 @@ TEST(str, match) {
 	EXPECT_EQ(are, "are");
 }
 
+TEST(str, wildcard) {
+	EXPECT_TRUE(str::wildcard("*.mkv", "clip.mkv"));
+	EXPECT_TRUE(str::wildcard("*", ""));
+	EXPECT_TRUE(str::wildcard("c?ip*.m*v", "clip01.mkv"));
+	EXPECT_TRUE(str::wildcard("a*b*c", "aXbYbZc"));
+	EXPECT_FALSE(str::wildcard("*.mkv", "clip.mp4"));
+	EXPECT_FALSE(str::wildcard("clip", "clip.mkv"));
+	EXPECT_FALSE(str::wildcard("?", ""));
+}
+
 TEST(str, split) {
 	EXPECT_EQ(
 		str::split("how are you", ' '),
@@ -60,3 +70,21 @@ TEST(str, split) {
 		str::split("how     are     you", ' '),
 		(std::vector<std::string_view>{"how", "are", "you"}));
 }
+
+TEST(str, stotime) {
+	double t = -1;
+	EXPECT_TRUE(str::stotime("42", t));
+	EXPECT_EQ(t, 42);
+	EXPECT_TRUE(str::stotime("1.5", t));
+	EXPECT_EQ(t, 1.5);
+	EXPECT_TRUE(str::stotime("40:00", t));
+	EXPECT_EQ(t, 2400);
+	EXPECT_TRUE(str::stotime("01:02:03.5", t));
+	EXPECT_EQ(t, 3723.5);
+	EXPECT_FALSE(str::stotime("", t));
+	EXPECT_FALSE(str::stotime("1:2:3:4", t));
+	EXPECT_FALSE(str::stotime("1:75:00", t));
+	EXPECT_FALSE(str::stotime("1.5:00", t));
+	EXPECT_FALSE(str::stotime("abc", t));
+	EXPECT_EQ(t, 3723.5);
+}
@@ -0,0 +1,73 @@
+#include <fmt/format.h>
+
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ffmpeg/runner.hpp"
+#include "ffmpeg/runner_backend.hpp"
+#include "ffmpeg/worker.hpp"
+#include "util.hpp"
+
+namespace {
+	constexpr auto USAGE =
+		R"(usage: {} [-i dir]... [-o dir]... <address> [program...]
+
+Runs ffmpeg jobs for ffmpeg_node_editor, set the address in the Workers
+preference or pass it to ffmpeg_node_editor_cli with -w
+
+address is unix:/path/to/socket, tcp:host:port or host:port. Without a
+host it is loopback only, *:port listens on every interface and needs a
+token.
+programs are what clients may run, ffmpeg and ffprobe by default
+-i lets jobs read from dir, besides the output directories
+-o lets jobs write to dir, besides stdout and the temp directory
+
+Clients have to send FFMPEG_NODE_EDITOR_TOKEN from the environment of
+the worker, if it is set. Set the same in the environment of the editor
+or cli.
+)";
+}  // namespace
+
+int main(int argc, char** argv) {
+	WorkerOptions options;
+	options.token = workerToken();
+	auto arg = 1;
+	for (; arg + 1 < argc; arg += 2) {
+		const std::string_view flag = argv[arg];
+		const auto dir = std::filesystem::absolute(argv[arg + 1]);
+		if (flag == "-i") {
+			options.inputDirs.push_back(dir);
+		} else if (flag == "-o") {
+			options.outputDirs.push_back(dir);
+		} else {
+			break;
+		}
+	}
+	if (arg >= argc) {
+		fmt::print(stderr, USAGE, argv[0]);
+		return 1;
+	}
+	const std::string address = argv[arg];
+	spdlog::set_level(spdlog::level::info);
+#if !defined(APP_OS_WINDOWS)
+	// Clients and ffmpeg runs that go away mid write end their job only
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	if (arg + 1 < argc) { options.programs = {argv + arg + 1, argv + argc}; }
+
+	Worker worker(std::make_shared<LocalBackend>(), std::move(options));
+	if (!worker.listen(address)) {
+		fmt::print(stderr, "Unable to listen on {}\n", address);
+		return 1;
+	}
+	SPDLOG_INFO("listening on {}", address);
+	worker.serve();
+	return 0;
+}